@@ -0,0 +1,238 @@
+"""
+本机推理参数自动调优
+
+在当前机器上用一段校准音频 (以及可选的校准视频) 运行短负载:
+- Whisper: 对每个模型依次搜索 compute_type x cpu_threads (beam_size=5)，再在最快组合上搜索 beam_size，
+  只接受与基准设置 (int8 / 默认线程数 / beam_size=5) 转写结果的字符错误率差异在容差内的组合，
+  从中选出耗时最短的一个；
+- x264: 比较各 preset 的编码速度，只接受同 CRF 下码率不超过基准 (fast) 一定比例的 preset。
+
+结果写入本机数据目录的 host_profile.json，transcribe.py (通过 VSG_DATA_DIR) 和主程序启动时加载。
+
+用法:
+  python autotune.py --audio sample.wav [--video sample.mp4] [--models tiny,base,small] [--device cpu]
+"""
+import sys
+import os
+import json
+import time
+import argparse
+import datetime
+import subprocess
+import tempfile
+
+# 复用转写脚本的环境设置、模型仓库和本机配置读写 (导入时不会执行转写)，以及评估工具的 CER 计算
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, SCRIPT_DIR)
+import transcribe
+from evaluate import char_error_rate
+from host_profile import default_data_dir
+
+X264_PRESETS = ["ultrafast", "superfast", "veryfast", "faster", "fast", "medium"]
+X264_BASELINE = "fast"
+
+def load_calibration_audio(path, seconds):
+    audio = transcribe.decode_audio(path, sampling_rate=transcribe.WHISPER_SAMPLE_RATE)
+    return audio[:int(seconds * transcribe.WHISPER_SAMPLE_RATE)]
+
+def run_whisper(model, audio, beam_size):
+    """
+    与 transcribe_whisper_core 相同的解码参数 (不写文件)，返回 (文本, 耗时秒)
+    """
+    start = time.perf_counter()
+    segments, _ = model.transcribe(
+        audio,
+        beam_size=beam_size,
+        word_timestamps=True,
+        language='zh',
+        condition_on_previous_text=False,
+        no_speech_threshold=transcribe.WHISPER_DECODE_DEFAULTS["no_speech_threshold"],
+        repetition_penalty=transcribe.WHISPER_DECODE_DEFAULTS["repetition_penalty"]
+    )
+    text = "".join(segment.text for segment in segments)
+    return text, time.perf_counter() - start
+
+def supported_compute_types(device):
+    preferred = ["int8", "int8_float32", "int16", "float32"] if device == "cpu" \
+        else ["int8_float16", "int8", "float16", "int8_float32"]
+    try:
+        import ctranslate2
+        supported = ctranslate2.get_supported_compute_types(device)
+        return [t for t in preferred if t in supported]
+    except Exception:
+        return ["int8"]
+
+def thread_candidates():
+    n = os.cpu_count() or 1
+    return sorted({max(1, n // 4), max(1, n // 2), n})
+
+def tune_whisper_model(model_size, device, audio, tolerance, repeats, allow_download=False):
+    """
+    返回该模型在本机上的最佳设置 (dict)，模型无法加载时返回 None
+    """
+    model_path = transcribe.model_registry.resolve_whisper(model_size, allow_download)
+    if not model_path:
+        print(f"Warning: model '{model_size}' not available, skipping.")
+        return None
+
+    def measure(compute_type, cpu_threads, beam_size, model=None):
+        if model is None:
+            kwargs = {"device": device, "compute_type": compute_type, "num_workers": 1}
+            if device == "cpu":
+                kwargs["cpu_threads"] = cpu_threads
+            model = transcribe.WhisperModel(model_path, **kwargs)
+        run_whisper(model, audio[:transcribe.WHISPER_SAMPLE_RATE * 5], beam_size)  # 预热
+        best_secs, text = None, ""
+        for _ in range(repeats):
+            text, secs = run_whisper(model, audio, beam_size)
+            best_secs = secs if best_secs is None else min(best_secs, secs)
+        return model, text, best_secs
+
+    audio_secs = len(audio) / transcribe.WHISPER_SAMPLE_RATE
+    print(f"[{model_size}/{device}] baseline: int8, default threads, beam_size=5")
+    sys.stdout.flush()
+    _, reference, baseline_secs = measure("int8", 0, 5)
+    if not reference.strip():
+        print(f"Warning: baseline produced no text for '{model_size}', calibration audio needs speech. Skipping.")
+        return None
+
+    best = {"compute_type": "int8", "cpu_threads": 0, "num_workers": 1, "beam_size": 5,
+            "secs": baseline_secs, "cer_delta": 0.0}
+    best_model = None
+
+    # 1. 精度 x 线程数 (beam_size=5)
+    threads = thread_candidates() if device == "cpu" else [0]
+    for compute_type in supported_compute_types(device):
+        for cpu_threads in threads:
+            try:
+                model, text, secs = measure(compute_type, cpu_threads, 5)
+            except Exception as e:
+                print(f"  {compute_type} threads={cpu_threads}: failed ({e})")
+                continue
+            cer = char_error_rate(reference, text)
+            ok = cer <= tolerance
+            print(f"  {compute_type} threads={cpu_threads}: {secs:.2f}s (RTF {secs / audio_secs:.3f}), CER vs baseline {cer:.3f}{'' if ok else ' (rejected)'}")
+            sys.stdout.flush()
+            if ok and secs < best["secs"]:
+                best.update(compute_type=compute_type, cpu_threads=cpu_threads, secs=secs, cer_delta=cer)
+                best_model = model
+
+    # 2. 在最快组合上缩小 beam_size
+    if best_model is None:
+        best_model, _, _ = measure(best["compute_type"], best["cpu_threads"], 5)
+    for beam_size in (3, 1):
+        _, text, secs = measure(best["compute_type"], best["cpu_threads"], beam_size, best_model)
+        cer = char_error_rate(reference, text)
+        ok = cer <= tolerance
+        print(f"  beam_size={beam_size}: {secs:.2f}s (RTF {secs / audio_secs:.3f}), CER vs baseline {cer:.3f}{'' if ok else ' (rejected)'}")
+        sys.stdout.flush()
+        if ok and secs < best["secs"]:
+            best.update(beam_size=beam_size, secs=secs, cer_delta=cer)
+
+    result = {key: best[key] for key in transcribe.DEFAULT_WHISPER_SETTINGS}
+    result["rtf"] = round(best["secs"] / audio_secs, 4)
+    result["baseline_rtf"] = round(baseline_secs / audio_secs, 4)
+    result["cer_delta"] = round(best["cer_delta"], 4)
+    print(f"[{model_size}/{device}] selected {result} (speedup x{baseline_secs / best['secs']:.2f})")
+    sys.stdout.flush()
+    return result
+
+def tune_x264(video_path, seconds, size_tolerance):
+    """
+    比较各 preset 在同一 CRF 下的编码耗时和输出大小，返回 {"preset", "rtf", ...}，失败时返回 None
+    """
+    results = {}
+    with tempfile.TemporaryDirectory(prefix="vsg_autotune_") as tmp:
+        for preset in X264_PRESETS:
+            output = os.path.join(tmp, f"{preset}.mp4")
+            cmd = ["ffmpeg", "-y", "-v", "error", "-t", str(seconds), "-i", video_path, "-an",
+                   "-c:v", "libx264", "-preset", preset, "-crf", "23", output]
+            start = time.perf_counter()
+            try:
+                code = subprocess.run(cmd).returncode
+            except FileNotFoundError:
+                print("Warning: ffmpeg not found, skipping x264 tuning.")
+                return None
+            secs = time.perf_counter() - start
+            if code != 0 or not os.path.exists(output):
+                print(f"  x264 {preset}: failed")
+                continue
+            results[preset] = (secs, os.path.getsize(output))
+            print(f"  x264 {preset}: {secs:.2f}s, {results[preset][1] // 1024} KB")
+            sys.stdout.flush()
+
+    if X264_BASELINE not in results:
+        return None
+    base_secs, base_size = results[X264_BASELINE]
+    best = X264_BASELINE
+    for preset, (secs, size) in results.items():
+        if size <= base_size * (1 + size_tolerance) and secs < results[best][0]:
+            best = preset
+    secs, size = results[best]
+    return {"preset": best, "rtf": round(secs / seconds, 4),
+            "baseline_rtf": round(base_secs / seconds, 4),
+            "size_ratio": round(size / base_size, 4)}
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-host inference autotuner")
+    parser.add_argument("--audio", required=True, help="Calibration audio containing speech (WAV or any container)")
+    parser.add_argument("--video", help="Calibration video for x264 preset tuning (optional)")
+    parser.add_argument("--models", default="tiny,base,small", help="Comma-separated Whisper models to tune")
+    parser.add_argument("--device", default="cpu", choices=["cpu", "cuda"], help="Device to tune for")
+    parser.add_argument("--seconds", type=float, default=60, help="Length of calibration workload in seconds")
+    parser.add_argument("--repeats", type=int, default=2, help="Timed runs per candidate (fastest is kept)")
+    parser.add_argument("--tolerance", type=float, default=0.02, help="Max character error rate vs. baseline transcript")
+    parser.add_argument("--size-tolerance", type=float, default=0.15, help="Max x264 size increase vs. preset 'fast'")
+    parser.add_argument("--allow-download", action="store_true", help="Download models missing from the local model registry")
+    parser.add_argument("--output", help="Profile path (default: <data dir>/host_profile.json)")
+    args = parser.parse_args()
+
+    output = args.output or os.path.join(default_data_dir(), transcribe.HOST_PROFILE_NAME)
+
+    # 在已有配置上增量更新 (只替换本次调优的部分)
+    profile = {}
+    if os.path.exists(output):
+        try:
+            with open(output, "r", encoding="utf-8") as f:
+                profile = json.load(f)
+        except (OSError, ValueError):
+            profile = {}
+    if profile.get("host") != transcribe.host_fingerprint():
+        profile = {}
+    profile["version"] = 1
+    profile["host"] = transcribe.host_fingerprint()
+    profile["updated"] = datetime.datetime.now().isoformat(timespec="seconds")
+
+    if not transcribe.HAS_WHISPER:
+        print("Error: faster-whisper is not installed.")
+        return 1
+    audio = load_calibration_audio(args.audio, args.seconds)
+    if len(audio) < transcribe.WHISPER_SAMPLE_RATE * 10:
+        print("Error: calibration audio must be at least 10 seconds long.")
+        return 1
+
+    tuned = profile.setdefault("whisper", {}).setdefault(args.device, {})
+    for model_size in [m.strip() for m in args.models.split(",") if m.strip()]:
+        result = tune_whisper_model(model_size, args.device, audio, args.tolerance, max(1, args.repeats), args.allow_download)
+        if result:
+            tuned[model_size] = result
+
+    if args.video:
+        x264 = tune_x264(args.video, min(args.seconds, 20), args.size_tolerance)
+        if x264:
+            profile["x264"] = x264
+            print(f"[x264] selected preset '{x264['preset']}'")
+
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    tmp_path = output + ".tmp"
+    with open(tmp_path, "w", encoding="utf-8") as f:
+        json.dump(profile, f, indent=2, ensure_ascii=False)
+    os.replace(tmp_path, output)
+    print(f"Host profile saved to {output}")
+    return 0
+
+if __name__ == "__main__":
+    code = main()
+    # 与 transcribe.py 相同: 避免 ctranslate2 析构时崩溃导致非零退出码
+    sys.stdout.flush()
+    os._exit(code)
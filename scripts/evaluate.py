@@ -0,0 +1,377 @@
+"""
+转写参数评估工具 (速度 vs 精度)
+
+在本地参考语料 (音频 + 人工校对文本) 上运行 引擎 x 模型 x 解码参数 的网格，
+对每组配置报告 CER/WER、实时率 (RTF，不含模型加载) 和峰值内存，并标出 Pareto 前沿，
+用于根据数据选择生产默认值 (transcribe.py 中的 WHISPER_DECODE_DEFAULTS)。
+
+每组配置在独立子进程中运行 (调用 transcribe.py 的生产转写函数)，峰值内存互不影响。
+
+语料:
+  - 目录: 每个音频文件 (wav/mp3/m4a/flac/...) 旁放同名 .txt 作为参考文本；
+  - 或 JSONL 清单: 每行 {"audio": "a.wav", "text": "参考文本"} (audio 为相对清单的路径)。
+
+用法:
+  python evaluate.py --corpus corpus_dir --engines whisper --models tiny,small --beam-sizes 1,5 --vad off,retry
+  python evaluate.py --corpus corpus.jsonl --grid grid.json --output report.json --csv report.csv
+"""
+import sys
+import os
+import re
+import json
+import time
+import argparse
+import itertools
+import subprocess
+import tempfile
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+AUDIO_SUFFIXES = (".wav", ".mp3", ".m4a", ".flac", ".opus", ".ogg", ".aac", ".mp4", ".mkv", ".mov")
+
+# 与 transcribe.WHISPER_DECODE_DEFAULTS 一致 (父进程不导入 transcribe，避免加载推理库)
+DECODE_KEYS = ["beam_size", "no_speech_threshold", "repetition_penalty", "vad"]
+PRODUCTION_DEFAULTS = {"beam_size": 5, "no_speech_threshold": 0.4, "repetition_penalty": 1.3, "vad": "retry"}
+
+# ---------------------------------------------------------------- 指标
+
+_PUNCT = re.compile(r"[\s　-〿＀-／：-＠［-｀｛-･!-/:-@\[-`{-~]+")
+_TOKEN = re.compile(r"[㐀-鿿]|[A-Za-z0-9']+")
+
+def normalize_text(text):
+    """
+    去掉空白和中英文标点，英文转小写 (CER 基于此比较)
+    """
+    return _PUNCT.sub("", text).lower()
+
+def tokenize_words(text):
+    """
+    WER 的词单位: 每个汉字一个词，连续的字母/数字为一个词 (中文无空格分词)
+    """
+    return _TOKEN.findall(text.lower())
+
+def edit_distance(a, b):
+    """
+    序列编辑距离 (两行滚动数组)
+    """
+    if len(a) < len(b):
+        a, b = b, a
+    prev = list(range(len(b) + 1))
+    for i, ca in enumerate(a, 1):
+        cur = [i]
+        for j, cb in enumerate(b, 1):
+            cur.append(min(prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (ca != cb)))
+        prev = cur
+    return prev[-1]
+
+def char_error_rate(reference, hypothesis):
+    ref = normalize_text(reference)
+    hyp = normalize_text(hypothesis)
+    if not ref:
+        return 0.0 if not hyp else 1.0
+    return edit_distance(ref, hyp) / len(ref)
+
+def srt_text(path):
+    """
+    从 SRT 中取出字幕文本 (与 transcribe.write_transcript_txt 相同的块格式)
+    """
+    if not os.path.exists(path):
+        return ""
+    lines = []
+    with open(path, "r", encoding="utf-8") as f:
+        for block in f.read().split("\n\n"):
+            rows = [row.strip() for row in block.strip().splitlines()]
+            if len(rows) >= 3 and "-->" in rows[1]:
+                lines.append(" ".join(row for row in rows[2:] if row))
+    return " ".join(lines)
+
+def peak_rss_mb():
+    """
+    当前进程的峰值常驻内存 (MB)
+    """
+    try:
+        import resource
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        return peak / (1024 * 1024) if sys.platform == "darwin" else peak / 1024  # macOS 为字节，Linux 为 KB
+    except ImportError:
+        import ctypes
+        from ctypes import wintypes
+
+        class ProcessMemoryCounters(ctypes.Structure):
+            _fields_ = [("cb", wintypes.DWORD), ("PageFaultCount", wintypes.DWORD),
+                        ("PeakWorkingSetSize", ctypes.c_size_t), ("WorkingSetSize", ctypes.c_size_t),
+                        ("QuotaPeakPagedPoolUsage", ctypes.c_size_t), ("QuotaPagedPoolUsage", ctypes.c_size_t),
+                        ("QuotaPeakNonPagedPoolUsage", ctypes.c_size_t), ("QuotaNonPagedPoolUsage", ctypes.c_size_t),
+                        ("PagefileUsage", ctypes.c_size_t), ("PeakPagefileUsage", ctypes.c_size_t)]
+        counters = ProcessMemoryCounters()
+        counters.cb = ctypes.sizeof(counters)
+        ctypes.windll.psapi.GetProcessMemoryInfo(ctypes.windll.kernel32.GetCurrentProcess(),
+                                                 ctypes.byref(counters), counters.cb)
+        return counters.PeakWorkingSetSize / (1024 * 1024)
+
+def media_duration(path):
+    try:
+        out = subprocess.run(["ffprobe", "-v", "error", "-show_entries", "format=duration", "-of", "csv=p=0", path],
+                             capture_output=True, text=True).stdout
+        return float(out.strip())
+    except (OSError, ValueError):
+        return 0.0
+
+# ---------------------------------------------------------------- 语料与网格
+
+def load_corpus(path):
+    """
+    返回 [{"id", "audio", "text"}]
+    """
+    items = []
+    if os.path.isdir(path):
+        for name in sorted(os.listdir(path)):
+            stem, ext = os.path.splitext(name)
+            ref = os.path.join(path, stem + ".txt")
+            if ext.lower() in AUDIO_SUFFIXES and os.path.exists(ref):
+                with open(ref, "r", encoding="utf-8") as f:
+                    items.append({"id": stem, "audio": os.path.join(path, name), "text": f.read()})
+    else:
+        base = os.path.dirname(os.path.abspath(path))
+        with open(path, "r", encoding="utf-8") as f:
+            for line in f:
+                line = line.strip()
+                if not line:
+                    continue
+                entry = json.loads(line)
+                audio = entry["audio"] if os.path.isabs(entry["audio"]) else os.path.join(base, entry["audio"])
+                items.append({"id": entry.get("id", os.path.splitext(os.path.basename(audio))[0]),
+                              "audio": audio, "text": entry["text"]})
+    return items
+
+def split_list(value, cast=str):
+    return [cast(item.strip()) for item in value.split(",") if item.strip()]
+
+def build_grid(args):
+    """
+    展开配置网格。Vosk 没有这些解码参数，每个语料只运行一次。
+    --grid 文件格式: {"engines": [...], "models": [...], "beam_size": [...], "no_speech_threshold": [...],
+                      "repetition_penalty": [...], "vad": [...]} (缺省项使用生产默认值)
+    """
+    if args.grid:
+        with open(args.grid, "r", encoding="utf-8") as f:
+            spec = json.load(f)
+    else:
+        spec = {"engines": split_list(args.engines), "models": split_list(args.models),
+                "beam_size": split_list(args.beam_sizes, int),
+                "no_speech_threshold": split_list(args.no_speech, float),
+                "repetition_penalty": split_list(args.repetition_penalty, float),
+                "vad": split_list(args.vad)}
+
+    configs = []
+    for engine in spec.get("engines", ["whisper"]):
+        if engine == "vosk":
+            configs.append({"engine": "vosk", "model": "vosk"})
+            continue
+        axes = [spec.get(key) or [PRODUCTION_DEFAULTS[key]] for key in DECODE_KEYS]
+        for model in spec.get("models", ["small"]):
+            for values in itertools.product(*axes):
+                config = {"engine": engine, "model": model}
+                config.update(zip(DECODE_KEYS, values))
+                configs.append(config)
+    return configs
+
+def config_label(config):
+    if config["engine"] == "vosk":
+        return "vosk"
+    return (f"whisper/{config['model']} beam={config['beam_size']} nst={config['no_speech_threshold']}"
+            f" rp={config['repetition_penalty']} vad={config['vad']}")
+
+def is_production_default(config):
+    return config["engine"] == "whisper" and all(config[k] == PRODUCTION_DEFAULTS[k] for k in DECODE_KEYS)
+
+# ---------------------------------------------------------------- 子进程: 运行单组配置
+
+def run_worker(config, corpus, device, allow_download, result_path):
+    """
+    在当前进程中加载模型并转写整个语料，结果写入 result_path
+    """
+    sys.path.insert(0, SCRIPT_DIR)
+    import transcribe
+
+    start = time.perf_counter()
+    if config["engine"] == "vosk":
+        model = transcribe.load_vosk_model(allow_download)
+    else:
+        model_path = transcribe.model_registry.resolve_whisper(config["model"], allow_download)
+        if not model_path:
+            sys.exit(1)
+        model = transcribe.create_whisper_model(model_path, config["model"], device)
+    load_secs = time.perf_counter() - start
+
+    items = []
+    with tempfile.TemporaryDirectory(prefix="vsg_eval_") as tmp:
+        for item in corpus:
+            output_srt = os.path.join(tmp, "out.srt")
+            duration = media_duration(item["audio"])
+            start = time.perf_counter()
+            try:
+                if config["engine"] == "vosk":
+                    transcribe.transcribe_vosk_core(model, item["audio"], output_srt, duration or None)
+                else:
+                    transcribe.transcribe_whisper_core(model, item["audio"], output_srt,
+                                                       **{k: config[k] for k in DECODE_KEYS})
+                hypothesis = srt_text(output_srt)
+            except Exception as e:
+                print(f"Error: {item['id']}: {e}")
+                hypothesis = ""
+            items.append({"id": item["id"], "secs": time.perf_counter() - start,
+                          "audio_secs": duration, "hypothesis": hypothesis})
+            if os.path.exists(output_srt):
+                os.remove(output_srt)
+
+    with open(result_path, "w", encoding="utf-8") as f:
+        json.dump({"load_secs": load_secs, "peak_rss_mb": peak_rss_mb(), "items": items}, f, ensure_ascii=False)
+
+# ---------------------------------------------------------------- 汇总
+
+def score(config, corpus, raw):
+    """
+    语料级指标: 编辑距离总和 / 参考长度总和 (长音频权重更大)
+    """
+    references = {item["id"]: item["text"] for item in corpus}
+    char_edits = char_total = word_edits = word_total = 0
+    secs = audio_secs = 0.0
+    for item in raw["items"]:
+        ref = references[item["id"]]
+        ref_chars, hyp_chars = normalize_text(ref), normalize_text(item["hypothesis"])
+        ref_words, hyp_words = tokenize_words(ref), tokenize_words(item["hypothesis"])
+        char_edits += edit_distance(ref_chars, hyp_chars)
+        char_total += len(ref_chars)
+        word_edits += edit_distance(ref_words, hyp_words)
+        word_total += len(ref_words)
+        secs += item["secs"]
+        audio_secs += item["audio_secs"]
+    return {
+        "config": config,
+        "label": config_label(config),
+        "cer": char_edits / max(1, char_total),
+        "wer": word_edits / max(1, word_total),
+        "rtf": secs / audio_secs if audio_secs > 0 else None,
+        "transcribe_secs": secs,
+        "load_secs": raw["load_secs"],
+        "peak_rss_mb": raw["peak_rss_mb"],
+        "default": is_production_default(config),
+    }
+
+def pareto_front(results, objectives):
+    """
+    所有目标都取最小值；返回不被任何其他结果支配的结果
+    """
+    keys = {"cer": "cer", "wer": "wer", "rtf": "rtf", "mem": "peak_rss_mb"}
+    values = [[r[keys[o]] if r[keys[o]] is not None else float("inf") for o in objectives] for r in results]
+    front = []
+    for i, vi in enumerate(values):
+        dominated = any(all(a <= b for a, b in zip(vj, vi)) and any(a < b for a, b in zip(vj, vi))
+                        for j, vj in enumerate(values) if j != i)
+        if not dominated:
+            front.append(results[i])
+    return front
+
+def print_report(results, front):
+    front_ids = {id(r) for r in front}
+    print()
+    print(f"{'':2s}{'configuration':64s} {'CER':>7s} {'WER':>7s} {'RTF':>7s} {'load s':>7s} {'peak MB':>8s}")
+    for r in sorted(results, key=lambda r: (r["cer"], r["rtf"] or float("inf"))):
+        mark = "*" if id(r) in front_ids else " "
+        rtf = f"{r['rtf']:.3f}" if r["rtf"] is not None else "-"
+        label = r["label"] + (" (default)" if r["default"] else "")
+        print(f"{mark} {label:64s} {r['cer']:7.2%} {r['wer']:7.2%} {rtf:>7s} {r['load_secs']:7.1f} {r['peak_rss_mb']:8.0f}")
+    print("\n* = Pareto frontier")
+
+def write_csv(path, results, front):
+    import csv
+    front_ids = {id(r) for r in front}
+    with open(path, "w", encoding="utf-8", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["engine", "model"] + DECODE_KEYS + ["cer", "wer", "rtf", "load_secs", "peak_rss_mb", "pareto", "default"])
+        for r in results:
+            c = r["config"]
+            writer.writerow([c["engine"], c["model"]] + [c.get(k, "") for k in DECODE_KEYS]
+                            + [f"{r['cer']:.4f}", f"{r['wer']:.4f}", "" if r["rtf"] is None else f"{r['rtf']:.4f}",
+                               f"{r['load_secs']:.2f}", f"{r['peak_rss_mb']:.0f}", int(id(r) in front_ids), int(r["default"])])
+
+def main():
+    parser = argparse.ArgumentParser(description="Speed/accuracy evaluation of transcription settings")
+    parser.add_argument("--corpus", required=True, help="Directory of audio + same-name .txt, or a JSONL manifest")
+    parser.add_argument("--grid", help="JSON grid spec (overrides the list options below)")
+    parser.add_argument("--engines", default="whisper", help="Comma-separated engines: whisper,vosk")
+    parser.add_argument("--models", default="small", help="Comma-separated Whisper models")
+    parser.add_argument("--beam-sizes", default="5", help="Comma-separated beam sizes")
+    parser.add_argument("--no-speech", default="0.4", help="Comma-separated no_speech_threshold values")
+    parser.add_argument("--repetition-penalty", default="1.3", help="Comma-separated repetition_penalty values")
+    parser.add_argument("--vad", default="retry", help="Comma-separated VAD modes: off,retry,on")
+    parser.add_argument("--device", default="cpu", choices=["cpu", "cuda"], help="Whisper device")
+    parser.add_argument("--objectives", default="cer,rtf", help="Pareto objectives (minimized): cer,wer,rtf,mem")
+    parser.add_argument("--allow-download", action="store_true", help="Download models missing from the local model registry")
+    parser.add_argument("--output", help="Write full JSON report")
+    parser.add_argument("--csv", help="Write CSV summary")
+    parser.add_argument("--verbose", action="store_true", help="Show transcriber output")
+    # 内部: 子进程模式
+    parser.add_argument("--worker", help=argparse.SUPPRESS)
+    parser.add_argument("--result", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    corpus = load_corpus(args.corpus)
+    if args.worker:
+        run_worker(json.loads(args.worker), corpus, args.device, args.allow_download, args.result)
+        return 0
+
+    if not corpus:
+        print(f"Error: no audio/reference pairs found in {args.corpus}")
+        return 1
+    objectives = split_list(args.objectives)
+    if any(o not in ("cer", "wer", "rtf", "mem") for o in objectives):
+        parser.error("--objectives accepts cer, wer, rtf, mem")
+    configs = build_grid(args)
+    print(f"Corpus: {len(corpus)} files, {len(configs)} configurations")
+
+    results = []
+    with tempfile.TemporaryDirectory(prefix="vsg_eval_") as tmp:
+        for index, config in enumerate(configs, 1):
+            print(f"[{index}/{len(configs)}] {config_label(config)}")
+            sys.stdout.flush()
+            result_path = os.path.join(tmp, f"result_{index}.json")
+            cmd = [sys.executable, os.path.abspath(__file__), "--corpus", args.corpus, "--device", args.device,
+                   "--worker", json.dumps(config), "--result", result_path]
+            if args.allow_download:
+                cmd.append("--allow-download")
+            output = None if args.verbose else subprocess.DEVNULL
+            code = subprocess.run(cmd, stdout=output, stderr=output).returncode
+            if code != 0 or not os.path.exists(result_path):
+                print(f"  failed (exit code {code}), re-run with --verbose for details")
+                continue
+            with open(result_path, "r", encoding="utf-8") as f:
+                raw = json.load(f)
+            result = score(config, corpus, raw)
+            result["items"] = raw["items"]
+            results.append(result)
+
+    if not results:
+        print("Error: no configuration completed")
+        return 1
+
+    front = pareto_front(results, objectives)
+    print_report(results, front)
+
+    if args.output:
+        front_ids = {id(r) for r in front}
+        report = {"corpus": os.path.abspath(args.corpus), "objectives": objectives,
+                  "results": [dict(r, pareto=id(r) in front_ids) for r in results]}
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump(report, f, indent=2, ensure_ascii=False)
+        print(f"Report saved to {args.output}")
+    if args.csv:
+        write_csv(args.csv, results, front)
+        print(f"CSV saved to {args.csv}")
+    return 0
+
+if __name__ == "__main__":
+    code = main()
+    # 与 transcribe.py 相同: 避免 ctranslate2 析构时崩溃导致非零退出码
+    sys.stdout.flush()
+    os._exit(code)
@@ -0,0 +1,71 @@
+"""
+本机推理配置 (host_profile.json)
+
+由 autotune.py 生成，位于本机数据目录 (主程序的 QStandardPaths::AppLocalDataLocation，C++ 端通过 VSG_DATA_DIR 传入)。
+transcribe.py 读取其中的 whisper 推理参数，pipeline_worker.py 读取 x264 preset；两者都不依赖推理库，
+工作节点进程导入时不会加载模型运行时。
+"""
+import sys
+import os
+import json
+import platform
+
+HOST_PROFILE_NAME = "host_profile.json"
+X264_PRESETS = ["ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower", "veryslow"]
+X264_DEFAULT_PRESET = "fast"
+_HOST_PROFILE = None
+
+def default_data_dir():
+    """
+    与主程序的 QStandardPaths::AppLocalDataLocation 一致 (应用名 VideoSubtitleGenerator)
+    """
+    if os.environ.get("VSG_DATA_DIR"):
+        return os.environ["VSG_DATA_DIR"]
+    if sys.platform == "win32":
+        base = os.environ.get("LOCALAPPDATA", os.path.expanduser("~/AppData/Local"))
+    elif sys.platform == "darwin":
+        base = os.path.expanduser("~/Library/Application Support")
+    else:
+        base = os.environ.get("XDG_DATA_HOME", os.path.expanduser("~/.local/share"))
+    return os.path.join(base, "VideoSubtitleGenerator")
+
+def host_profile_path():
+    data_dir = os.environ.get("VSG_DATA_DIR")
+    return os.path.join(data_dir, HOST_PROFILE_NAME) if data_dir else None
+
+def host_fingerprint():
+    """
+    本机标识，配置文件被复制到其他机器时不再适用 (主程序 HostProfile 按相同字段比较)
+    """
+    return {"cpu_count": os.cpu_count() or 1, "machine": platform.machine(), "platform": sys.platform}
+
+def load_host_profile():
+    """
+    加载本机推理配置 (只读取一次)，不存在或不属于本机时返回空字典
+    """
+    global _HOST_PROFILE
+    if _HOST_PROFILE is not None:
+        return _HOST_PROFILE
+    _HOST_PROFILE = {}
+    path = host_profile_path()
+    if not path or not os.path.exists(path):
+        return _HOST_PROFILE
+    try:
+        with open(path, "r", encoding="utf-8") as f:
+            profile = json.load(f)
+    except (OSError, ValueError) as e:
+        print(f"Warning: failed to read host profile {path}: {e}")
+        return _HOST_PROFILE
+    if profile.get("host") != host_fingerprint():
+        print(f"Warning: host profile {path} was generated on a different machine, ignoring it (re-run autotune.py).")
+        return _HOST_PROFILE
+    _HOST_PROFILE = profile
+    print(f"Loaded host profile {path}")
+    return _HOST_PROFILE
+
+def x264_preset():
+    """
+    硬字幕合成使用的 x264 preset: 本机配置中有调优结果时使用，否则为 "fast"
+    """
+    preset = load_host_profile().get("x264", {}).get("preset")
+    return preset if preset in X264_PRESETS else X264_DEFAULT_PRESET
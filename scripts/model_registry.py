@@ -0,0 +1,334 @@
+"""
+本地模型仓库
+
+所有模型存放在仓库目录 (默认 scripts/model，可用 VSG_MODEL_DIR 覆盖) 下:
+  whisper/<size>/          faster-whisper 模型 (model.bin, config.json, tokenizer.json, vocabulary.*)
+  vosk/<name>/             Vosk 模型
+  manifest.json            清单: 每个模型的来源、文件大小与 SHA-256
+
+转写时只按清单核对文件是否存在、大小是否一致 (不计算哈希，不访问网络)，耗时固定。
+未登记的模型默认直接报错 (严格离线)；只有显式允许下载时才会联网获取并登记。
+
+用法:
+  python model_registry.py list
+  python model_registry.py preload --whisper tiny,small [--vosk] [--source DIR]
+  python model_registry.py verify [--whisper small] [--vosk]
+"""
+import sys
+import os
+import json
+import shutil
+import hashlib
+import argparse
+import datetime
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+MANIFEST_NAME = "manifest.json"
+
+VOSK_MODEL_NAME = "vosk-model-small-cn-0.22"
+VOSK_MODEL_BASE_URL = "https://alphacephei.com/vosk/models"
+
+# faster-whisper 加载本地目录时需要的文件 (缺少 tokenizer.json 时它会尝试联网获取分词器)
+WHISPER_REQUIRED_FILES = ["model.bin", "config.json", "tokenizer.json"]
+
+def registry_root():
+    return os.environ.get("VSG_MODEL_DIR") or os.path.join(SCRIPT_DIR, "model")
+
+def model_key(kind, name):
+    return f"{kind}/{name}"
+
+def model_dir(kind, name):
+    return os.path.join(registry_root(), kind, name)
+
+def load_manifest():
+    path = os.path.join(registry_root(), MANIFEST_NAME)
+    if not os.path.exists(path):
+        return {"version": 1, "models": {}}
+    try:
+        with open(path, "r", encoding="utf-8") as f:
+            manifest = json.load(f)
+    except (OSError, ValueError) as e:
+        print(f"Warning: model manifest {path} is unreadable ({e}), treating registry as empty.")
+        return {"version": 1, "models": {}}
+    manifest.setdefault("models", {})
+    return manifest
+
+def save_manifest(manifest):
+    root = registry_root()
+    os.makedirs(root, exist_ok=True)
+    path = os.path.join(root, MANIFEST_NAME)
+    tmp_path = path + ".tmp"
+    with open(tmp_path, "w", encoding="utf-8") as f:
+        json.dump(manifest, f, indent=2, ensure_ascii=False)
+    os.replace(tmp_path, path)
+
+def sha256_file(path):
+    digest = hashlib.sha256()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(4 * 1024 * 1024), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+def scan_files(directory):
+    """
+    目录下所有文件的相对路径 (统一使用 /)
+    """
+    files = []
+    for dirpath, _, filenames in os.walk(directory):
+        for filename in filenames:
+            full = os.path.join(dirpath, filename)
+            files.append(os.path.relpath(full, directory).replace(os.sep, "/"))
+    return sorted(files)
+
+def register(kind, name, source):
+    """
+    计算仓库中模型目录的文件清单并写入 manifest
+    """
+    directory = model_dir(kind, name)
+    files = {}
+    for rel in scan_files(directory):
+        full = os.path.join(directory, rel)
+        files[rel] = {"size": os.path.getsize(full), "sha256": sha256_file(full)}
+    manifest = load_manifest()
+    manifest["models"][model_key(kind, name)] = {
+        "path": f"{kind}/{name}",
+        "source": source,
+        "added": datetime.datetime.now().isoformat(timespec="seconds"),
+        "files": files,
+    }
+    save_manifest(manifest)
+    print(f"Registered {model_key(kind, name)} ({len(files)} files)")
+    sys.stdout.flush()
+
+def quick_check(entry):
+    """
+    热路径检查: 只比较文件是否存在和大小，返回 (ok, 原因)
+    """
+    directory = os.path.join(registry_root(), entry["path"])
+    for rel, meta in entry.get("files", {}).items():
+        full = os.path.join(directory, rel)
+        try:
+            size = os.path.getsize(full)
+        except OSError:
+            return False, f"missing file {rel}"
+        if size != meta.get("size"):
+            return False, f"size mismatch for {rel}"
+    return True, ""
+
+def full_check(entry):
+    """
+    完整校验: 逐个文件计算 SHA-256，返回出错的文件列表
+    """
+    directory = os.path.join(registry_root(), entry["path"])
+    bad = []
+    for rel, meta in entry.get("files", {}).items():
+        full = os.path.join(directory, rel)
+        if not os.path.exists(full) or os.path.getsize(full) != meta.get("size") or sha256_file(full) != meta.get("sha256"):
+            bad.append(rel)
+    return bad
+
+def resolve(kind, name):
+    """
+    按清单解析已登记的模型目录，未登记或文件不完整时返回 None (不访问网络)
+    """
+    entry = load_manifest()["models"].get(model_key(kind, name))
+    if not entry:
+        return None
+    ok, reason = quick_check(entry)
+    if not ok:
+        print(f"Warning: registered model {model_key(kind, name)} is incomplete ({reason}); run 'python model_registry.py verify'.")
+        return None
+    return os.path.join(registry_root(), entry["path"])
+
+def fetch_whisper(size, source=None):
+    """
+    把 Whisper 模型放入仓库: source 为本地目录时复制 (离线导入)，否则从 Hugging Face 下载
+    """
+    target = model_dir("whisper", size)
+    if source:
+        missing = [f for f in WHISPER_REQUIRED_FILES if not os.path.exists(os.path.join(source, f))]
+        if missing:
+            raise RuntimeError(f"{source} is not a faster-whisper model directory (missing {', '.join(missing)})")
+        shutil.copytree(source, target, dirs_exist_ok=True)
+        origin = os.path.abspath(source)
+    else:
+        from faster_whisper import download_model
+        print(f"Downloading Whisper model '{size}'...")
+        sys.stdout.flush()
+        os.makedirs(target, exist_ok=True)
+        download_model(size, output_dir=target, local_files_only=False)
+        origin = f"huggingface:{size}"
+    # 下载到 output_dir 时 huggingface_hub 会留下 .cache 元数据，不属于模型本身
+    shutil.rmtree(os.path.join(target, ".cache"), ignore_errors=True)
+    register("whisper", size, origin)
+    return target
+
+def fetch_vosk(name=VOSK_MODEL_NAME, source=None):
+    """
+    把 Vosk 模型放入仓库: source 为本地目录或 zip 时导入，否则从官方地址下载
+    """
+    import zipfile
+    target = model_dir("vosk", name)
+    parent = os.path.dirname(target)
+    os.makedirs(parent, exist_ok=True)
+
+    if source and os.path.isdir(source):
+        shutil.copytree(source, target, dirs_exist_ok=True)
+        origin = os.path.abspath(source)
+    else:
+        zip_path = source
+        if not zip_path:
+            import requests
+            print(f"Downloading model {name}...")
+            sys.stdout.flush()
+            zip_path = target + ".zip"
+            url = f"{VOSK_MODEL_BASE_URL}/{name}.zip"
+            response = requests.get(url, stream=True, proxies={"http": None, "https": None})
+            response.raise_for_status()
+            total = int(response.headers.get("content-length", 0))
+            done = 0
+            with open(zip_path, "wb") as f:
+                for data in response.iter_content(1024 * 1024):
+                    f.write(data)
+                    done += len(data)
+                    if total > 0:
+                        print(f"DOWNLOAD_PROGRESS: {int(done * 100 / total)}")
+                        sys.stdout.flush()
+        print("Extracting model...")
+        sys.stdout.flush()
+        with zipfile.ZipFile(zip_path, "r") as zip_ref:
+            zip_ref.extractall(parent)
+        origin = os.path.abspath(source) if source else f"{VOSK_MODEL_BASE_URL}/{name}.zip"
+        if not source:
+            os.remove(zip_path)
+    if not os.path.isdir(target):
+        raise RuntimeError(f"archive did not contain {name}/")
+    register("vosk", name, origin)
+    return target
+
+def resolve_whisper(size, allow_download=False):
+    """
+    转写脚本使用的 Whisper 模型解析:
+    1. 仓库中已登记的模型 (只核对大小)；
+    2. 旧版本留下的 Hugging Face 缓存 (local_files_only，不联网)；
+    3. 允许下载时下载并登记。
+    都不满足时返回 None
+    """
+    path = resolve("whisper", size)
+    if path:
+        return path
+    try:
+        from faster_whisper import download_model
+        path = download_model(size, local_files_only=True)
+        if all(os.path.exists(os.path.join(path, f)) for f in WHISPER_REQUIRED_FILES):
+            print(f"Using unregistered Whisper model from Hugging Face cache: {path} (run 'python model_registry.py preload --whisper {size} --source {path}' to register it)")
+            return path
+    except Exception:
+        pass
+    if allow_download:
+        try:
+            return fetch_whisper(size)
+        except Exception as e:
+            print(f"Error: Model download failed: {e}")
+            return None
+    print(f"Error: Whisper model '{size}' is not in the local model registry ({registry_root()}). "
+          f"Run 'python model_registry.py preload --whisper {size}' (or enable model downloads).")
+    return None
+
+def resolve_vosk(name=VOSK_MODEL_NAME, allow_download=False):
+    """
+    转写脚本使用的 Vosk 模型解析: 仓库 -> 旧版本的固定位置 -> 允许时下载并登记
+    """
+    path = resolve("vosk", name)
+    if path:
+        return path
+    for legacy in (os.path.join(registry_root(), name), os.path.join(SCRIPT_DIR, name)):
+        if os.path.isdir(legacy):
+            return legacy
+    if allow_download:
+        try:
+            return fetch_vosk(name)
+        except Exception as e:
+            print(f"Error: Vosk model download failed: {e}")
+            return None
+    print(f"Error: Vosk model '{name}' is not in the local model registry ({registry_root()}). "
+          f"Run 'python model_registry.py preload --vosk' (or enable model downloads).")
+    return None
+
+def split_list(value):
+    return [item.strip() for item in (value or "").split(",") if item.strip()]
+
+def command_list(args):
+    models = load_manifest()["models"]
+    print(f"Registry: {registry_root()}")
+    if not models:
+        print("(empty)")
+    for key, entry in sorted(models.items()):
+        ok, reason = quick_check(entry)
+        size_mb = sum(meta.get("size", 0) for meta in entry.get("files", {}).values()) / (1024 * 1024)
+        print(f"{key:32s} {size_mb:9.1f} MB  {'ok' if ok else reason}  ({entry.get('source', '')})")
+    return 0
+
+def command_preload(args):
+    failed = 0
+    for size in split_list(args.whisper):
+        try:
+            fetch_whisper(size, args.source)
+        except Exception as e:
+            print(f"Error: failed to preload whisper/{size}: {e}")
+            failed += 1
+    if args.vosk:
+        try:
+            fetch_vosk(VOSK_MODEL_NAME, args.source)
+        except Exception as e:
+            print(f"Error: failed to preload vosk/{VOSK_MODEL_NAME}: {e}")
+            failed += 1
+    return 1 if failed else 0
+
+def command_verify(args):
+    models = load_manifest()["models"]
+    keys = [model_key("whisper", size) for size in split_list(args.whisper)]
+    if args.vosk:
+        keys.append(model_key("vosk", VOSK_MODEL_NAME))
+    if not keys:
+        keys = sorted(models)
+    failed = 0
+    for key in keys:
+        entry = models.get(key)
+        if not entry:
+            print(f"{key}: not registered")
+            failed += 1
+            continue
+        bad = full_check(entry)
+        if bad:
+            print(f"{key}: FAILED ({', '.join(bad)})")
+            failed += 1
+        else:
+            print(f"{key}: ok ({len(entry.get('files', {}))} files)")
+        sys.stdout.flush()
+    return 1 if failed else 0
+
+def main():
+    parser = argparse.ArgumentParser(description="Local model registry")
+    parser.add_argument("--root", help="Registry directory (default: VSG_MODEL_DIR or scripts/model)")
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("list", help="List registered models")
+    preload = sub.add_parser("preload", help="Download (or import with --source) models into the registry")
+    preload.add_argument("--whisper", help="Comma-separated Whisper sizes, e.g. tiny,small")
+    preload.add_argument("--vosk", action="store_true", help=f"Also preload {VOSK_MODEL_NAME}")
+    preload.add_argument("--source", help="Import from a local model directory (or Vosk zip) instead of downloading")
+    verify = sub.add_parser("verify", help="Check SHA-256 of registered models")
+    verify.add_argument("--whisper", help="Comma-separated Whisper sizes (default: all registered)")
+    verify.add_argument("--vosk", action="store_true", help=f"Verify {VOSK_MODEL_NAME}")
+    args = parser.parse_args()
+
+    if args.root:
+        os.environ["VSG_MODEL_DIR"] = os.path.abspath(args.root)
+    # 与 transcribe.py 相同的镜像站 (需在导入 huggingface_hub 之前设置)
+    os.environ.setdefault("HF_ENDPOINT", "https://hf-mirror.com")
+    os.environ["HF_HUB_DISABLE_SYMLINKS_WARNING"] = "1"
+    commands = {"list": command_list, "preload": command_preload, "verify": command_verify}
+    return commands[args.command](args)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,387 @@
+"""
+分布式工作节点
+
+连接主程序的任务协调器 (勾选 "分发到工作节点" 后监听，地址见 coordinator.json)，逐个领取任务并执行
+提取音频 -> 转写 -> 硬字幕合成。节点不保存任何状态: 任务消息包含全部参数，输入和输出通过共享存储
+按路径读写 (各机器挂载路径不同时用 --path-map 转换)。转写交给常驻的 transcribe.py --serve 子进程，
+模型在任务之间复用。编码 preset 和推理参数取自本节点自己的 host_profile.json (autotune.py)，不随任务下发。
+
+协议 (TCP，每行一个 JSON):
+  节点 -> 协调器: hello {worker, token} / request / heartbeat {lease, stage, progress} / done {lease, ok, error}
+  协调器 -> 节点: welcome {leaseSecs, heartbeatSecs} / job {lease, task, attempt, spec} / ack / revoked / error
+执行中按 heartbeatSecs 发送心跳；收到 revoked (租约已过期并被重新分配，或任务在主程序中被取消) 时终止当前任务。
+
+用法:
+  python pipeline_worker.py --connect 127.0.0.1:47100 [--token T] [--path-map /mnt/share=D:/share]
+"""
+import sys
+import os
+import json
+import time
+import socket
+import shutil
+import argparse
+import tempfile
+import threading
+import subprocess
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, SCRIPT_DIR)
+from host_profile import default_data_dir, x264_preset
+
+UMASK = os.umask(0)
+os.umask(UMASK)
+
+class JobError(Exception):
+    pass
+
+class Revoked(Exception):
+    pass
+
+class Connection:
+    """
+    JSON 行连接 (发送加锁，心跳线程与主线程共用)
+    """
+    def __init__(self, address, timeout=10):
+        host, port = address.rsplit(":", 1)
+        self.sock = socket.create_connection((host, int(port)), timeout=timeout)
+        self.sock.settimeout(None)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+        self.reader = self.sock.makefile("r", encoding="utf-8")
+        self.lock = threading.Lock()
+
+    def send(self, message):
+        data = (json.dumps(message, ensure_ascii=False) + "\n").encode("utf-8")
+        with self.lock:
+            self.sock.sendall(data)
+
+    def recv(self):
+        line = self.reader.readline()
+        if not line:
+            raise ConnectionError("coordinator closed the connection")
+        return json.loads(line)
+
+    def close(self):
+        try:
+            self.sock.close()
+        except OSError:
+            pass
+
+class Transcriber:
+    """
+    常驻 transcribe.py --serve 子进程 (崩溃或任务被收回时终止，下一个任务重新启动)
+    """
+    def __init__(self):
+        self.proc = None
+        self.next_id = 1
+
+    def start(self):
+        env = dict(os.environ, PYTHONUNBUFFERED="1", PYTHONUTF8="1")
+        self.proc = subprocess.Popen([sys.executable, os.path.join(SCRIPT_DIR, "transcribe.py"), "--serve"],
+                                     stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                     text=True, encoding="utf-8", errors="replace", bufsize=1, env=env)
+        for line in self.proc.stdout:
+            if line.strip() == "WORKER_READY":
+                return
+            print("transcribe: " + line.rstrip())
+        self.proc = None
+        raise JobError("transcribe.py --serve exited during startup")
+
+    def run(self, args, on_line):
+        if self.proc is None or self.proc.poll() is not None:
+            self.start()
+        job_id = self.next_id
+        self.next_id += 1
+        proc = self.proc
+        proc.stdin.write(json.dumps({"id": job_id, "args": args}) + "\n")
+        proc.stdin.flush()
+        for line in proc.stdout:
+            line = line.strip()
+            if line.startswith("JOB_DONE:"):
+                parts = line[9:].split()
+                return int(parts[1]) if len(parts) >= 2 else 1
+            on_line(line)
+        self.proc = None
+        return 1
+
+    def kill(self):
+        proc, self.proc = self.proc, None
+        if proc and proc.poll() is None:
+            proc.kill()
+
+class Job:
+    """
+    单个任务的执行状态 (阶段、进度、可被心跳线程终止的子进程)
+    """
+    def __init__(self, lease, spec, path_map):
+        self.lease = lease
+        self.spec = spec
+        self.path_map = path_map
+        self.stage = "extract"
+        self.progress = 0.0
+        self.child = None
+        self.revoked = threading.Event()
+        self.transcriber = None
+
+    def path(self, key):
+        value = self.spec.get(key) or ""
+        for src, dst in self.path_map:
+            if value.replace("\\", "/").startswith(src):
+                value = dst + value.replace("\\", "/")[len(src):]
+                break
+        return value
+
+    def cancel(self):
+        self.revoked.set()
+        child = self.child
+        if child and child.poll() is None:
+            child.kill()
+        if self.stage == "transcribe" and self.transcriber:
+            self.transcriber.kill()
+
+    def check(self):
+        if self.revoked.is_set():
+            raise Revoked()
+
+def run_process(job, cmd, cwd=None, on_line=None):
+    job.check()
+    job.child = subprocess.Popen(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                 text=True, encoding="utf-8", errors="replace")
+    tail = []
+    for line in job.child.stdout:
+        line = line.strip()
+        if on_line:
+            on_line(line)
+        if line and "=" not in line:
+            tail = (tail + [line])[-5:]
+    code = job.child.wait()
+    job.child = None
+    job.check()
+    if code != 0:
+        raise JobError(f"{cmd[0]} failed (exit code {code}): " + " | ".join(tail))
+
+def partial_path(dst):
+    """
+    目标目录中唯一的隐藏临时文件 (保留扩展名供 ffmpeg 识别格式)。租约过期后旧节点可能仍在写同一任务，
+    固定文件名会让两个节点互相覆盖或删除对方的文件
+    """
+    folder, name = os.path.split(os.path.abspath(dst))
+    stem, ext = os.path.splitext(name)
+    os.makedirs(folder, exist_ok=True)
+    fd, path = tempfile.mkstemp(prefix=f".{stem}.", suffix=f".partial{ext}", dir=folder)
+    os.close(fd)
+    # mkstemp 固定为 0600，替换后的输出按普通文件的权限 (受 umask 限制) 供共享存储上的其他用户读取
+    os.chmod(path, 0o666 & ~UMASK)
+    return path
+
+def replace_if_leased(job, partial, dst):
+    """
+    租约仍有效时才原子替换到目标位置，已被收回的任务不发布结果
+    """
+    job.check()
+    os.replace(partial, dst)
+
+def publish(job, src, dst):
+    """
+    复制到目标目录中的隐藏临时文件，再原子替换 (共享存储上的读者看不到写了一半的文件)
+    """
+    if not dst or not os.path.exists(src):
+        return
+    partial = partial_path(dst)
+    try:
+        shutil.copyfile(src, partial)
+        replace_if_leased(job, partial, dst)
+    finally:
+        if os.path.exists(partial):
+            os.remove(partial)
+
+def execute(job, transcriber, scratch):
+    spec = job.spec
+    source = job.path("input")
+    if not os.path.exists(source):
+        raise JobError(f"input not accessible on this worker: {source}")
+    duration = float(spec.get("duration") or 0)
+    transcript_only = bool(spec.get("transcriptOnly"))
+
+    with tempfile.TemporaryDirectory(prefix="vsg_worker_", dir=scratch) as tmp:
+        # 1. 提取音频 (仅转写任务直接解码源文件)
+        audio = source
+        if not transcript_only:
+            job.stage, job.progress = "extract", 0.0
+            audio = os.path.join(tmp, "audio.wav")
+            run_process(job, ["ffmpeg", "-y", "-v", "error", "-i", source, "-ac", "1", "-ar", "16000", "-f", "wav", audio])
+
+        # 2. 转写
+        job.stage, job.progress = "transcribe", 0.0
+        srt = os.path.join(tmp, "sub.srt")
+        txt = os.path.join(tmp, "transcript.txt")
+        args = [audio, srt, "--engine", spec.get("engine", "whisper"), "--model", spec.get("model", "small")]
+        if transcript_only:
+            args += ["--txt", txt]
+        if duration > 0:
+            args += ["--duration", f"{duration:.2f}"]
+        if spec.get("allowDownload"):
+            args.append("--allow-download")
+
+        def on_transcribe_line(line):
+            if line.startswith("TRANS_PROGRESS:"):
+                try:
+                    job.progress = min(1.0, int(line.split(":", 1)[1]) / 100.0)
+                except ValueError:
+                    pass
+            elif line.startswith("Error") or "Traceback" in line:
+                print("transcribe: " + line)
+
+        job.transcriber = transcriber
+        code = transcriber.run(args, on_transcribe_line)
+        job.check()
+        if code != 0 or not os.path.exists(srt) or os.path.getsize(srt) == 0:
+            raise JobError(f"transcription failed (exit code {code})")
+
+        if transcript_only:
+            publish(job, srt, job.path("subtitle"))
+            publish(job, txt, job.path("transcript"))
+            return
+
+        # 3. 硬字幕合成: 写入输出目录中的隐藏临时文件，完成后原子替换
+        job.stage, job.progress = "embed", 0.0
+        output = job.path("outputVideo")
+        partial = partial_path(output)
+
+        def on_ffmpeg_line(line):
+            if line.startswith("out_time_us=") and duration > 0:
+                try:
+                    job.progress = min(1.0, int(line.split("=", 1)[1]) / 1e6 / duration)
+                except ValueError:
+                    pass
+
+        try:
+            run_process(job, ["ffmpeg", "-y", "-v", "error", "-nostats", "-progress", "pipe:1", "-i", source,
+                              "-vf", "subtitles='sub.srt'", "-c:v", "libx264", "-preset", x264_preset()]
+                        + ["-c:a", "copy", partial], cwd=tmp, on_line=on_ffmpeg_line)
+            replace_if_leased(job, partial, output)
+        finally:
+            if os.path.exists(partial):
+                os.remove(partial)
+
+        if spec.get("keepSubtitle"):
+            publish(job, srt, job.path("subtitle"))
+        if spec.get("keepAudio"):
+            publish(job, audio, job.path("audio"))
+
+def heartbeat_loop(conn, job, interval, stop):
+    """
+    执行期间定时发送心跳；协调器回复 revoked 或连接断开时终止任务
+    """
+    while not stop.wait(interval):
+        try:
+            conn.send({"type": "heartbeat", "lease": job.lease, "stage": job.stage, "progress": round(job.progress, 3)})
+            reply = conn.recv()
+        except (OSError, ConnectionError, ValueError):
+            job.cancel()
+            return
+        if reply.get("type") == "revoked" and reply.get("lease", job.lease) == job.lease:
+            print(f"Lease {job.lease} revoked by coordinator, aborting.")
+            job.cancel()
+            return
+
+def serve(conn, args, transcriber):
+    conn.send({"type": "hello", "worker": args.name, "token": args.token})
+    welcome = conn.recv()
+    if welcome.get("type") != "welcome":
+        raise JobError(welcome.get("message", "rejected by coordinator"))
+    interval = max(1, int(welcome.get("heartbeatSecs", 15)))
+    print(f"Connected to {args.connect} as {args.name} (heartbeat {interval}s)")
+    sys.stdout.flush()
+
+    while True:
+        conn.send({"type": "request"})
+        message = conn.recv()
+        while message.get("type") in ("ack", "revoked"):
+            # 上一个任务遗留的消息 (主动下发的 revoked 之后，最后一次心跳的回复)
+            message = conn.recv()
+        if message.get("type") != "job":
+            continue
+        job = Job(message["lease"], message.get("spec", {}), args.path_map)
+        print(f"Job {message.get('task')} (attempt {message.get('attempt')}): {job.path('input')}")
+        sys.stdout.flush()
+
+        stop = threading.Event()
+        beat = threading.Thread(target=heartbeat_loop, args=(conn, job, interval, stop), daemon=True)
+        beat.start()
+        ok, error = True, ""
+        started = time.time()
+        try:
+            execute(job, transcriber, args.scratch)
+        except Revoked:
+            ok, error = False, "revoked"
+        except Exception as e:
+            ok, error = False, str(e)
+        stop.set()
+        beat.join()
+
+        if job.revoked.is_set():
+            # 租约已被收回 (任务已重新分配) 或连接已断开，结果不再上报；连接断开时下一次发送失败并重连
+            print(f"Job {message.get('task')} abandoned")
+            continue
+        print(f"Job {message.get('task')} {'done' if ok else 'failed: ' + error} in {time.time() - started:.1f}s")
+        sys.stdout.flush()
+        conn.send({"type": "done", "lease": job.lease, "ok": ok, "error": error})
+
+def parse_path_map(items):
+    result = []
+    for item in items or []:
+        if "=" not in item:
+            raise argparse.ArgumentTypeError(f"--path-map expects SRC=DST, got {item}")
+        src, dst = item.split("=", 1)
+        result.append((src.replace("\\", "/"), dst))
+    return result
+
+def default_scratch_dir():
+    """
+    中间文件的本地目录: 有 /dev/shm (tmpfs) 时使用内存盘，否则为系统临时目录
+    """
+    if os.path.isdir("/dev/shm") and os.access("/dev/shm", os.W_OK):
+        return "/dev/shm"
+    return None
+
+def main():
+    parser = argparse.ArgumentParser(description="Stateless pipeline worker for the job coordinator")
+    parser.add_argument("--connect", default="127.0.0.1:47100", help="Coordinator address host:port")
+    parser.add_argument("--token", default="", help="Access token (coordinator.json 'token')")
+    parser.add_argument("--name", default=f"{socket.gethostname()}-{os.getpid()}", help="Worker name shown in the coordinator log")
+    parser.add_argument("--path-map", action="append", metavar="SRC=DST",
+                        help="Translate a coordinator path prefix to the local mount point (repeatable)")
+    parser.add_argument("--scratch", default=default_scratch_dir(),
+                        help="Local directory for intermediates (default: /dev/shm when writable, else the system temp dir)")
+    args = parser.parse_args()
+    args.path_map = parse_path_map(args.path_map)
+    # 本机数据目录 (host_profile.json): x264 preset 和 transcribe.py 子进程的推理参数按本节点的调优结果选择
+    os.environ.setdefault("VSG_DATA_DIR", default_data_dir())
+
+    transcriber = Transcriber()
+    backoff = 1
+    while True:
+        conn = None
+        try:
+            conn = Connection(args.connect)
+            backoff = 1
+            serve(conn, args, transcriber)
+        except KeyboardInterrupt:
+            break
+        except JobError as e:
+            print(f"Error: {e}")
+            return 1
+        except (OSError, ConnectionError, ValueError) as e:
+            print(f"Coordinator unavailable ({e}), retrying in {backoff}s")
+            sys.stdout.flush()
+            time.sleep(backoff)
+            backoff = min(backoff * 2, 30)
+        finally:
+            if conn:
+                conn.close()
+    transcriber.kill()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
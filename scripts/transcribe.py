@@ -4,9 +4,8 @@ import os
 # 1. 强制设置 Hugging Face 镜像站
 os.environ["HF_ENDPOINT"] = "https://hf-mirror.com"
 
-# 2. 强制在线模式，防止被误判为离线
-if "HF_HUB_OFFLINE" in os.environ:
-    del os.environ["HF_HUB_OFFLINE"]
+# 2. 不再强制在线模式: 模型从本地模型仓库解析 (model_registry.py)，转写时不访问网络，
+#    用户设置的 HF_HUB_OFFLINE 保持不变
 
 # 3. 清除可能导致连接失败的代理设置
 for key in ["HTTP_PROXY", "HTTPS_PROXY", "http_proxy", "https_proxy"]:
@@ -73,8 +72,8 @@ import wave
 import json
 import datetime
 import argparse
-import requests
-import zipfile
+import threading
+from types import SimpleNamespace
 
 # Add NVIDIA library paths for faster-whisper/ctranslate2 on Windows
 # This must be done before importing faster_whisper or loading the model
@@ -105,49 +104,49 @@ if sys.platform == "win32":
 # Vosk imports
 from vosk import Model, KaldiRecognizer
 
+# 本地模型仓库 (严格离线解析，允许时才下载)
+import model_registry
+
 # Whisper imports
 try:
-    from faster_whisper import WhisperModel, download_model
+    from faster_whisper import WhisperModel, decode_audio
     HAS_WHISPER = True
 except ImportError:
     HAS_WHISPER = False
 
-VOSK_MODEL_NAME = "vosk-model-small-cn-0.22"
-VOSK_MODEL_URL = f"https://alphacephei.com/vosk/models/{VOSK_MODEL_NAME}.zip"
+# 批量推理管线 (faster-whisper >= 1.1)，旧版本回退为逐个转录
+try:
+    from faster_whisper import BatchedInferencePipeline
+    HAS_BATCHED = True
+except ImportError:
+    HAS_BATCHED = False
 
-def download_vosk_model(path):
-    print(f"Downloading model {VOSK_MODEL_NAME}...")
-    sys.stdout.flush()
-    proxies = {"http": None, "https": None}
-    try:
-        response = requests.get(VOSK_MODEL_URL, stream=True, proxies=proxies)
-    except requests.exceptions.ProxyError:
-        print("Proxy error detected, trying without explicit proxy settings...")
-        response = requests.get(VOSK_MODEL_URL, stream=True)
-    
-    total_size_in_bytes = int(response.headers.get('content-length', 0))
-    block_size = 1024 * 1024 # 1 MB
-    
-    zip_path = path + ".zip"
-    
-    downloaded_size = 0
-    with open(zip_path, 'wb') as file:
-        for data in response.iter_content(block_size):
-            file.write(data)
-            downloaded_size += len(data)
-            if total_size_in_bytes > 0:
-                percent = int(downloaded_size * 100 / total_size_in_bytes)
-                print(f"DOWNLOAD_PROGRESS: {percent}")
-                sys.stdout.flush()
-    
-    print("Extracting model...")
-    sys.stdout.flush()
-    with zipfile.ZipFile(zip_path, 'r') as zip_ref:
-        zip_ref.extractall(os.path.dirname(path))
-    
-    os.remove(zip_path)
-    print("Model downloaded and extracted.")
-    sys.stdout.flush()
+# 本机推理配置 (由 autotune.py 生成，位于 C++ 端通过 VSG_DATA_DIR 传入的本机数据目录)
+from host_profile import HOST_PROFILE_NAME, host_profile_path, host_fingerprint, load_host_profile
+DEFAULT_WHISPER_SETTINGS = {"compute_type": "int8", "cpu_threads": 0, "num_workers": 1, "beam_size": 5}
+
+def whisper_settings(model_size, device):
+    """
+    模型在指定设备上的推理参数: 本机配置中有调优结果时使用，否则为默认值
+    """
+    settings = dict(DEFAULT_WHISPER_SETTINGS)
+    tuned = load_host_profile().get("whisper", {}).get(device, {}).get(model_size, {})
+    for key in DEFAULT_WHISPER_SETTINGS:
+        if key in tuned:
+            settings[key] = tuned[key]
+    return settings
+
+def create_whisper_model(model_path, model_size, device, compute_type=None):
+    """
+    按本机配置创建 WhisperModel，compute_type 非空时覆盖配置 (用于 GPU 精度回退)
+    """
+    settings = whisper_settings(model_size, device)
+    kwargs = {"device": device,
+              "compute_type": compute_type or settings["compute_type"],
+              "num_workers": settings["num_workers"]}
+    if device == "cpu":
+        kwargs["cpu_threads"] = settings["cpu_threads"]
+    return WhisperModel(model_path, **kwargs)
 
 def format_time(seconds):
     dt = datetime.datetime.utcfromtimestamp(seconds)
@@ -188,53 +187,166 @@ def split_and_write_srt(f, count, segments, max_chars=20):
         count += 1
     return count
 
-def process_vosk(input_wav, output_srt, script_dir):
-    model_path = os.path.join(script_dir, "model", VOSK_MODEL_NAME)
-    
-    if not os.path.exists(model_path):
-        os.makedirs(os.path.dirname(model_path), exist_ok=True)
-        potential_path = os.path.join(script_dir, VOSK_MODEL_NAME)
-        if os.path.exists(potential_path):
-            model_path = potential_path
-        else:
-            download_vosk_model(os.path.join(script_dir, VOSK_MODEL_NAME))
-            model_path = os.path.join(script_dir, VOSK_MODEL_NAME)
+def open_pcm_stream(input_path, duration=None):
+    """
+    打开 16bit 单声道 PCM 音频流供 Vosk 逐块识别
+    单声道 PCM WAV 直接读取；其他格式 (mp3/m4a/flac/opus 或视频容器) 通过 ffmpeg 管道
+    流式解码为 16kHz s16le，不生成中间 WAV 文件
+    返回 (read_frames(n), sample_rate, total_frames, close)，总帧数未知时为 0，close 返回解码器退出码
+    """
+    try:
+        wf = wave.open(input_path, "rb")
+        if wf.getnchannels() == 1 and wf.getsampwidth() == 2 and wf.getcomptype() == "NONE":
+            def close_wav():
+                wf.close()
+                return 0
+            return wf.readframes, wf.getframerate(), wf.getnframes(), close_wav
+        wf.close()
+    except (wave.Error, EOFError):
+        pass
+
+    import subprocess
+    sample_rate = 16000
+    proc = subprocess.Popen(
+        ["ffmpeg", "-nostdin", "-v", "error", "-i", input_path,
+         "-vn", "-ac", "1", "-ar", str(sample_rate), "-f", "s16le", "-"],
+        stdout=subprocess.PIPE
+    )
+
+    def close():
+        proc.stdout.close()
+        return proc.wait()
+
+    total_frames = int(duration * sample_rate) if duration else 0
+    return (lambda n: proc.stdout.read(n * 2)), sample_rate, total_frames, close
+
+class TranscribeCheckpoint:
+    """
+    转写检查点 (JSON Lines): 首行记录输入文件，之后每识别完一段追加一行并立即写盘。
+    任务被抢占 (进程被终止) 后用同一检查点重新运行，从最后一段的结束位置继续，已识别的段落不再重复计算。
+    path 为空时所有操作为空操作。
+    """
+    def __init__(self, path, input_path):
+        self.path = path
+        self.file = None
+        self.key = None
+        if path and os.path.exists(input_path):
+            self.key = {"input": os.path.abspath(input_path), "size": os.path.getsize(input_path)}
+
+    def load(self):
+        """
+        读取已完成的段落 (不存在、输入文件已变化或无法读取时为空)，并重写检查点以丢弃被中断时写了一半的行
+        """
+        if not self.path or not self.key:
+            return []
+        entries = []
+        try:
+            with open(self.path, "r", encoding="utf-8") as f:
+                lines = f.read().split("\n")
+            if json.loads(lines[0]) == self.key:
+                for line in lines[1:]:
+                    try:
+                        entries.append(json.loads(line))
+                    except ValueError:
+                        break
+        except (OSError, ValueError):
+            entries = []
+
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            for entry in [self.key] + entries:
+                f.write(json.dumps(entry, ensure_ascii=False) + "\n")
+        os.replace(tmp, self.path)
+        self.file = open(self.path, "a", encoding="utf-8")
+        return entries
+
+    def append(self, entry):
+        if self.file:
+            self.file.write(json.dumps(entry, ensure_ascii=False) + "\n")
+            self.file.flush()
+
+    def discard(self):
+        """
+        转写完成后删除检查点
+        """
+        if self.file:
+            self.file.close()
+            self.file = None
+        if self.path and os.path.exists(self.path):
+            os.remove(self.path)
+
+def load_vosk_model(allow_download=False):
+    model_path = model_registry.resolve_vosk(allow_download=allow_download)
+    if not model_path:
+        sys.exit(1)
 
     print(f"Loading Vosk model from {model_path}...")
     try:
-        model = Model(model_path)
+        return Model(model_path)
     except Exception as e:
         print(f"Failed to load model: {e}")
         sys.exit(1)
 
-    wf = wave.open(input_wav, "rb")
-    if wf.getnchannels() != 1 or wf.getsampwidth() != 2 or wf.getcomptype() != "NONE":
-        print("Audio file must be WAV format mono PCM.")
-        sys.exit(1)
+def process_vosk(input_wav, output_srt, duration=None, allow_download=False, checkpoint=None):
+    transcribe_vosk_core(load_vosk_model(allow_download), input_wav, output_srt, duration, checkpoint)
 
-    total_frames = wf.getnframes()
-    rec = KaldiRecognizer(model, wf.getframerate())
+def transcribe_vosk_core(model, input_wav, output_srt, duration=None, checkpoint=None):
+    """
+    核心 Vosk 识别逻辑，接受已加载的模型
+    checkpoint: 检查点路径，每个识别完成的句子记录一次 (词时间为绝对时间)，中断后跳过已识别的音频
+    """
+    read_frames, sample_rate, total_frames, close_stream = open_pcm_stream(input_wav, duration)
+    rec = KaldiRecognizer(model, sample_rate)
     rec.SetWords(True)
 
-    results = []
+    ckpt = TranscribeCheckpoint(checkpoint, input_wav)
+    results = ckpt.load()
     print("Transcribing (Vosk)...")
     sys.stdout.flush()
-    
+
+    # 从检查点继续: 已识别部分只解码不识别，识别器的时间从跳过之后开始计
+    current_pos = results[-1]['pos'] if results else 0
+    skipped = 0
+    while skipped < current_pos:
+        data = read_frames(min(4000, current_pos - skipped))
+        if len(data) == 0:
+            break
+        skipped += len(data) // 2
+    offset = current_pos / sample_rate
+    if current_pos > 0:
+        print(f"Resuming from checkpoint at {offset:.1f}s ({len(results)} utterances kept)")
+
     while True:
-        data = wf.readframes(4000)
+        if CANCEL_REQUESTED.is_set():
+            close_stream()
+            raise JobCancelled()
+        data = read_frames(4000)
         if len(data) == 0:
             break
         
-        current_pos = wf.tell()
-        percent = int(current_pos * 100 / total_frames)
-        print(f"TRANS_PROGRESS: {percent}")
-        sys.stdout.flush()
+        current_pos += len(data) // 2
+        if total_frames > 0:
+            percent = min(int(current_pos * 100 / total_frames), 100)
+            print(f"TRANS_PROGRESS: {percent}")
+            sys.stdout.flush()
         
         if rec.AcceptWaveform(data):
             part_result = json.loads(rec.Result())
+            for word in part_result.get('result', []):
+                word['start'] += offset
+                word['end'] += offset
+            part_result['pos'] = current_pos
             results.append(part_result)
+            ckpt.append(part_result)
     
+    if close_stream() != 0 and current_pos == 0:
+        print(f"Error: failed to decode audio from {input_wav}")
+        sys.exit(1)
+
     final_result = json.loads(rec.FinalResult())
+    for word in final_result.get('result', []):
+        word['start'] += offset
+        word['end'] += offset
     results.append(final_result)
     
     print("Generating SRT...")
@@ -243,15 +355,40 @@ def process_vosk(input_wav, output_srt, script_dir):
         for res in results:
             if 'result' in res and res['result']:
                 count = split_and_write_srt(f, count, res['result'])
+    ckpt.discard()
     
     print(f"Subtitle saved to {output_srt}")
 
-def transcribe_whisper_core(model, input_wav, output_srt):
+# 解码参数的生产默认值 (evaluate.py 以此为基准评估各参数的耗时与精度)
+WHISPER_DECODE_DEFAULTS = {"beam_size": 5, "no_speech_threshold": 0.4, "repetition_penalty": 1.3, "vad": "retry"}
+
+def whisper_segment_entry(segment, offset=0.0):
+    """
+    Whisper 段落转为可序列化的字典 (检查点格式)，offset 加到所有时间上
+    """
+    entry = {'start': segment.start + offset, 'end': segment.end + offset, 'text': segment.text.strip()}
+    if segment.words:
+        entry['words'] = [{'start': w.start + offset, 'end': w.end + offset, 'word': w.word} for w in segment.words]
+    return entry
+
+def transcribe_whisper_core(model, input_wav, output_srt, beam_size=5,
+                            no_speech_threshold=0.4, repetition_penalty=1.3, vad="retry", checkpoint=None):
     """
     核心转录逻辑，接受已加载的模型
+    vad: "off" 不使用 VAD；"retry" 无结果时启用 VAD 重试 (默认)；"on" 直接启用 VAD
+    checkpoint: 检查点路径，每识别完一段记录一次，中断后从最后一段的结束位置继续
     """
     print("Transcribing (Whisper)...")
     sys.stdout.flush()
+
+    ckpt = TranscribeCheckpoint(checkpoint, input_wav)
+    all_segments = ckpt.load()
+    resume_at = all_segments[-1]['end'] if all_segments else 0.0
+    audio = input_wav
+    if resume_at > 0:
+        # 只识别剩余部分，时间戳加上起点偏移
+        audio = decode_audio(input_wav, sampling_rate=WHISPER_SAMPLE_RATE)[int(resume_at * WHISPER_SAMPLE_RATE):]
+        print(f"Resuming from checkpoint at {resume_at:.1f}s ({len(all_segments)} segments kept)")
     
     # 强制指定中文 'zh'
     # initial_prompt 可以帮助引导模型，例如使用简体中文
@@ -261,68 +398,72 @@ def transcribe_whisper_core(model, input_wav, output_srt):
     # condition_on_previous_text=False: 防止前文错误累积导致无限重复
     # no_speech_threshold=0.6: 提高静音检测阈值 (降低幻觉)
     # repetition_penalty=1.3: 强力抑制重复 (Faster-Whisper 特性)
+    vad_kwargs = dict(vad_filter=True, vad_parameters=dict(min_silence_duration_ms=500)) if vad == "on" else {}
     segments, info = model.transcribe(
-        input_wav, 
-        beam_size=5, 
+        audio, 
+        beam_size=beam_size, 
         word_timestamps=True, 
         language='zh', 
         initial_prompt=None, # 移除 Prompt 以避免干扰，模型通常能自动识别
         condition_on_previous_text=False,
-        no_speech_threshold=0.4, # 稍微降低阈值以避免漏掉轻微语音，靠 repetition_penalty 抑制幻觉
-        repetition_penalty=1.3
+        no_speech_threshold=no_speech_threshold, # 默认稍微降低阈值以避免漏掉轻微语音，靠 repetition_penalty 抑制幻觉
+        repetition_penalty=repetition_penalty,
+        **vad_kwargs
     )
     
     print(f"Detected language '{info.language}' with probability {info.language_probability}")
     print(f"Audio duration: {info.duration}s")
     sys.stdout.flush()
 
-    total_duration = info.duration
-    
-    # 收集所有段落
-    all_segments = list(segments)
+    total_duration = info.duration + resume_at
+
+    def collect(segments):
+        # 段落逐个生成: 每段完成即报告进度并记入检查点
+        for segment in segments:
+            check_cancelled()
+            entry = whisper_segment_entry(segment, resume_at)
+            all_segments.append(entry)
+            ckpt.append(entry)
+            if total_duration > 0:
+                print(f"TRANS_PROGRESS: {min(int(entry['end'] * 100 / total_duration), 100)}")
+                sys.stdout.flush()
+
+    collect(segments)
     
     # 如果没有检测到段落，尝试启用 VAD 重试
-    if not all_segments:
+    if not all_segments and vad == "retry":
         print("Warning: No segments detected with standard settings. Retrying with VAD enabled...")
         # 启用 VAD，调整参数
         segments_vad, info_vad = model.transcribe(
             input_wav, 
-            beam_size=5, 
+            beam_size=beam_size, 
             word_timestamps=True, 
             language='zh', 
             initial_prompt=None,
             condition_on_previous_text=False,
-            repetition_penalty=1.3,
+            repetition_penalty=repetition_penalty,
             vad_filter=True,
             vad_parameters=dict(min_silence_duration_ms=500)
         )
-        all_segments = list(segments_vad)
+        collect(segments_vad)
         
         if not all_segments:
             print("Warning: Still no segments detected after VAD retry.")
         else:
             print(f"Success: Detected {len(all_segments)} segments with VAD enabled.")
     
-    segment_count = 0
+    segment_count = len(all_segments)
     with open(output_srt, "w", encoding="utf-8") as f:
         count = 1
         for segment in all_segments:
-            segment_count += 1
-            # 进度估算
-            if total_duration > 0:
-                percent = int(segment.end * 100 / total_duration)
-                print(f"TRANS_PROGRESS: {percent}")
-                sys.stdout.flush()
-            
             # Whisper segment 也有 words 列表 (因为开启了 word_timestamps=True)
-            if segment.words:
-                # 转换格式适配 split_and_write_srt
-                word_list = [{'start': w.start, 'end': w.end, 'word': w.word} for w in segment.words]
-                count = split_and_write_srt(f, count, word_list)
+            if segment.get('words'):
+                count = split_and_write_srt(f, count, segment['words'])
             else:
                 # 如果没有词级时间戳，直接写入整句
-                write_srt_content(f, count, segment.start, segment.end, segment.text.strip())
+                write_srt_content(f, count, segment['start'], segment['end'], segment['text'])
                 count += 1
+    ckpt.discard()
     
     if segment_count == 0:
         print("Warning: No segments detected! SRT file will be empty.")
@@ -332,7 +473,50 @@ def transcribe_whisper_core(model, input_wav, output_srt):
     print(f"Subtitle saved to {output_srt}")
     return segment_count, info
 
-def process_whisper(input_wav, output_srt, model_size):
+# 常驻工作进程中当前任务的取消请求 (stdin 读取线程设置，转写循环在段落/数据块之间检查)，
+# 任务在进程内结束，已加载的模型保留给下一个任务
+CANCEL_REQUESTED = threading.Event()
+
+class JobCancelled(BaseException):
+    """
+    当前任务已取消 (继承 BaseException，不会被 GPU 回退等通用异常处理拦截)
+    """
+
+def check_cancelled():
+    if CANCEL_REQUESTED.is_set():
+        raise JobCancelled()
+
+# 已加载的 Whisper 模型 (常驻工作进程模式下跨任务复用)，只保留一个: {model_size: (model, model_path, using_gpu)}
+WHISPER_MODEL_CACHE = {}
+
+def cache_whisper_model(model_size, model, model_path, using_gpu):
+    """
+    记录当前模型，替换之前缓存的模型 (换用其他大小或 GPU 回退 CPU 后，下一个任务直接复用新模型)
+    """
+    WHISPER_MODEL_CACHE.clear()
+    WHISPER_MODEL_CACHE[model_size] = (model, model_path, using_gpu)
+
+def release_whisper_models():
+    """
+    释放缓存的模型 (加载其他大小的模型前调用，常驻进程的内存不随使用过的模型数增长)
+    """
+    if not WHISPER_MODEL_CACHE:
+        return
+    print(f"Releasing Whisper model '{next(iter(WHISPER_MODEL_CACHE))}'.")
+    WHISPER_MODEL_CACHE.clear()
+    import gc
+    gc.collect()
+
+def load_whisper_model(model_size, allow_download=False):
+    """
+    从本地模型仓库定位并加载 Whisper 模型 (允许下载时才会联网)，优先使用 GPU，失败时回退 CPU
+    返回 (model, model_path, using_gpu)
+    """
+    if model_size in WHISPER_MODEL_CACHE:
+        print(f"Reusing loaded Whisper model '{model_size}'.")
+        return WHISPER_MODEL_CACHE[model_size]
+    release_whisper_models()
+
     if not HAS_WHISPER:
         print("Error: faster-whisper is not installed. Please pip install faster-whisper -i https://mirrors.aliyun.com/pypi/simple/")
         sys.exit(1)
@@ -342,23 +526,13 @@ def process_whisper(input_wav, output_srt, model_size):
         os.environ["HF_ENDPOINT"] = "https://hf-mirror.com"
         
     print(f"Loading Whisper model '{model_size}'...")
-    print("提示: 首次运行将自动下载模型 (使用 hf-mirror.com 加速)，请耐心等待...")
     sys.stdout.flush()
 
-    # 显式下载模型以捕获下载错误，并获取本地路径
-    try:
-        # 强制 local_files_only=False 确保可以联网下载
-        model_path = download_model(model_size, local_files_only=False)
-        print(f"Model downloaded to {model_path}")
-    except Exception as e:
-        print(f"Error: Model download failed: {e}")
-        # 尝试备用方案：如果联网失败，尝试本地缓存
-        try:
-             print("Network download failed, trying local cache...")
-             model_path = download_model(model_size, local_files_only=True)
-             print(f"Found in local cache: {model_path}")
-        except:
-             sys.exit(1)
+    # 只在本地仓库和缓存中查找 (不访问网络)，未找到且允许下载时才下载
+    model_path = model_registry.resolve_whisper(model_size, allow_download)
+    if not model_path:
+        sys.exit(1)
+    print(f"Model path: {model_path}")
 
     # 尝试使用 GPU (CUDA)
     model = None
@@ -382,8 +556,8 @@ def process_whisper(input_wav, output_srt, model_size):
         print(f"Warning: {required_dll} not found in PATH. Skipping CUDA initialization to avoid crash.")
     else:
         try:
-            model = WhisperModel(model_path, device="cuda", compute_type="int8")
-            print("Using GPU (CUDA) for inference.")
+            model = create_whisper_model(model_path, model_size, "cuda")
+            print(f"Using GPU (CUDA) for inference ({whisper_settings(model_size, 'cuda')}).")
             using_gpu = True
         except Exception as e:
             print(f"Warning: GPU init failed ({e}), falling back to CPU.")
@@ -391,19 +565,31 @@ def process_whisper(input_wav, output_srt, model_size):
 
     if not using_gpu:
         try:
-            model = WhisperModel(model_path, device="cpu", compute_type="int8")
-            print("Using CPU for inference.")
+            model = create_whisper_model(model_path, model_size, "cpu")
+            print(f"Using CPU for inference ({whisper_settings(model_size, 'cpu')}).")
         except Exception as e_cpu:
             print(f"Error: Failed to load Whisper model on CPU: {e_cpu}")
             sys.exit(1)
 
+    cache_whisper_model(model_size, model, model_path, using_gpu)
+    return model, model_path, using_gpu
+
+def process_whisper(input_wav, output_srt, model_size, allow_download=False, checkpoint=None):
+    """
+    单文件 Whisper 转录，返回退出码 (由调用方决定如何退出进程)
+    checkpoint: 检查点路径 (GPU 出错回退 CPU 时也从检查点继续)
+    """
+    model, model_path, using_gpu = load_whisper_model(model_size, allow_download)
+    beam_size = whisper_settings(model_size, "cuda" if using_gpu else "cpu")["beam_size"]
+    cpu_beam_size = whisper_settings(model_size, "cpu")["beam_size"]
+
     # 开始转录，如果 GPU 运行时崩溃，尝试回退 CPU
     try:
         # 设置转录状态标志，确保可能的 tqdm 输出被标记为转录进度
         global IS_TRANSCRIBING
         IS_TRANSCRIBING = True
 
-        count, info = transcribe_whisper_core(model, input_wav, output_srt)
+        count, info = transcribe_whisper_core(model, input_wav, output_srt, beam_size, checkpoint=checkpoint)
         
         # 如果 GPU 转录结果为空，尝试使用更安全的计算类型 (int8_float32) 或回退到 CPU
         # 这是一个关键修复：某些 GPU 在 int8 (float16 compute) 模式下可能因为兼容性问题输出为空
@@ -421,24 +607,23 @@ def process_whisper(input_wav, output_srt, model_size):
                 print("Attempting GPU retry with compute_type='int8_float32' (Safer precision)...")
                 
                 # 释放旧模型
+                WHISPER_MODEL_CACHE.pop(model_size, None)
                 del model
                 import gc
                 gc.collect()
                 
                 try:
                     # 重新加载模型 (GPU, int8_float32)
-                    model = WhisperModel(model_path, device="cuda", compute_type="int8_float32")
+                    model = create_whisper_model(model_path, model_size, "cuda", compute_type="int8_float32")
                     print("Retrying transcription on GPU (int8_float32)...")
-                    count_retry, info_retry = transcribe_whisper_core(model, input_wav, output_srt)
+                    count_retry, info_retry = transcribe_whisper_core(model, input_wav, output_srt, beam_size, checkpoint=checkpoint)
                     
                     if count_retry > 0:
                         print("Success: GPU retry with int8_float32 worked!")
+                        cache_whisper_model(model_size, model, model_path, True)
                         # 成功后直接返回，不需要继续回退
                         IS_TRANSCRIBING = False
-                        # 显式退出，防止后续代码（如异常处理或函数尾部）导致非预期行为
-                        # 使用 os._exit(0) 而非 sys.exit(0) 以避免 C++ 扩展库 (如 ctranslate2) 在析构时崩溃导致非零退出码
-                        os._exit(0)
-                        return
+                        return 0
                     else:
                          print("Warning: GPU int8_float32 also yielded 0 segments.")
                          del model
@@ -457,9 +642,10 @@ def process_whisper(input_wav, output_srt, model_size):
                 
                 try:
                     print("Reloading model on CPU...")
-                    model = WhisperModel(model_path, device="cpu", compute_type="int8")
+                    model = create_whisper_model(model_path, model_size, "cpu")
+                    cache_whisper_model(model_size, model, model_path, False)
                     print("Retrying transcription on CPU...")
-                    transcribe_whisper_core(model, input_wav, output_srt)
+                    transcribe_whisper_core(model, input_wav, output_srt, cpu_beam_size, checkpoint=checkpoint)
                 except Exception as e_cpu_retry:
                     print(f"Error: CPU fallback failed: {e_cpu_retry}")
 
@@ -483,41 +669,400 @@ def process_whisper(input_wav, output_srt, model_size):
         if os.path.exists(output_srt) and os.path.getsize(output_srt) > 100:
              print("Subtitle file generated successfully despite the error. Skipping fallback.")
              # 确保正常退出，不返回错误码
-             os._exit(0)
+             return 0
 
         if using_gpu:
             print("Fatal GPU runtime error detected. Attempting fallback to CPU...")
             # 尝试清理显存
+            WHISPER_MODEL_CACHE.pop(model_size, None)
             del model
             import gc
             gc.collect()
             
             try:
                 print("Reloading model on CPU...")
-                model = WhisperModel(model_path, device="cpu", compute_type="int8")
+                model = create_whisper_model(model_path, model_size, "cpu")
+                cache_whisper_model(model_size, model, model_path, False)
                 print("Retrying transcription on CPU...")
-                transcribe_whisper_core(model, input_wav, output_srt)
+                transcribe_whisper_core(model, input_wav, output_srt, cpu_beam_size, checkpoint=checkpoint)
             except Exception as e_retry:
                 print(f"Error: CPU fallback also failed: {e_retry}")
-                sys.exit(1)
+                return 1
         else:
-            sys.exit(1)
+            return 1
 
-def main():
+    return 0
+
+WHISPER_SAMPLE_RATE = 16000
+WHISPER_WINDOW_SECS = 30
+
+def write_whisper_segments(output_srt, pieces):
+    """
+    将分发到某个任务的字幕片段写入 SRT (每个片段为 [{'start', 'end', 'word'}]，时间已换算到该文件内)
+    返回写入的字幕条数
+    """
+    with open(output_srt, "w", encoding="utf-8") as f:
+        count = 1
+        for piece in pieces:
+            count = split_and_write_srt(f, count, piece)
+    return count - 1
+
+def pack_batch_jobs(jobs, max_windows, load_audio=None):
+    """
+    按 30 秒窗口数将任务分组，每组拼接成一段音频送入批量管线
+    每个文件用静音补齐到整数个窗口，clip 恰好是一个完整窗口: 批量管线把相邻 clip 合并到 max_duration (30 秒) 以内时
+    两个完整窗口无法合并，任何一次解码都不会同时包含两个文件的音频
+    返回 [(audio, clips, spans)]，spans 为 [(job, start_sample, end_sample, padded_end_sample)]
+    """
+    import numpy as np
+
+    load_audio = load_audio or (lambda path: decode_audio(path, sampling_rate=WHISPER_SAMPLE_RATE))
+    window = WHISPER_SAMPLE_RATE * WHISPER_WINDOW_SECS
+    packs = []
+    parts, clips, spans = [], [], []
+    offset = 0
+
+    def flush():
+        nonlocal parts, clips, spans, offset
+        if parts:
+            packs.append((np.concatenate(parts), clips, spans))
+        parts, clips, spans = [], [], []
+        offset = 0
+
+    for job in jobs:
+        audio = load_audio(job['input'])
+        n = len(audio)
+        windows = max(1, (n + window - 1) // window)
+        if clips and len(clips) + windows > max_windows:
+            flush()
+        padded = windows * window
+        for start in range(0, padded, window):
+            clips.append({'start': offset + start, 'end': offset + start + window})
+        spans.append((job, offset, offset + n, offset + padded))
+        parts.append(audio)
+        if padded > n:
+            parts.append(np.zeros(padded - n, dtype=audio.dtype))
+        offset += padded
+    flush()
+    return packs
+
+def route_batch_words(segments, spans, on_segment=None):
+    """
+    按词把批量结果分发回各自的任务: 词的起点落在哪个文件的 (补齐后) 区间就属于哪个文件，
+    起止时间裁剪到该文件的实际音频内并换算为文件内时间，落在补齐静音中的词丢弃
+    没有词时间戳的段落按段落整体处理。on_segment(sample) 用于汇报进度
+    返回 {id(job): [piece]}，piece 为 [{'start', 'end', 'word'}]
+    """
+    routed = {id(job): [] for job, _, _, _ in spans}
+
+    def owner(seconds):
+        sample = seconds * WHISPER_SAMPLE_RATE
+        for span in spans:
+            if span[1] <= sample < span[3]:
+                return span
+        return None
+
+    for segment in segments:
+        words = segment.words or [SimpleNamespace(start=segment.start, end=segment.end, word=segment.text.strip())]
+        pieces = {}
+        for w in words:
+            span = owner(w.start)
+            if span is None:
+                continue
+            job, start, end, _ = span
+            begin_secs, end_secs = start / WHISPER_SAMPLE_RATE, end / WHISPER_SAMPLE_RATE
+            if w.start >= end_secs:
+                continue
+            pieces.setdefault(id(job), []).append({
+                'start': max(w.start, begin_secs) - begin_secs,
+                'end': min(max(w.end, w.start), end_secs) - begin_secs,
+                'word': w.word
+            })
+        for key, piece in pieces.items():
+            routed[key].append(piece)
+        if on_segment:
+            on_segment(int(segment.start * WHISPER_SAMPLE_RATE))
+    return routed
+
+def transcribe_whisper_batch(model, jobs, batch_size, beam_size=5):
+    """
+    批量转录多个短音频：把多个任务的 30 秒窗口打包进同一个 batch 做一次前向推理，
+    再按词把结果分发回各自的 SRT
+    jobs: list of dict {'input': audio, 'output': srt, 'txt': 可选}
+    返回未得到任何段落的任务列表 (由调用方逐个重试)
+    """
+    print(f"Transcribing (Whisper batched, {len(jobs)} files, batch_size={batch_size})...")
+    sys.stdout.flush()
+
+    pipeline = BatchedInferencePipeline(model=model)
+    empty_jobs = []
+    total_samples = 0
+    done_samples = 0
+    packs = pack_batch_jobs(jobs, max_windows=batch_size * 4)
+    for audio, _, _ in packs:
+        total_samples += len(audio)
+
+    for audio, clips, spans in packs:
+        segments, info = pipeline.transcribe(
+            audio,
+            batch_size=batch_size,
+            beam_size=beam_size,
+            word_timestamps=True,
+            language='zh',
+            no_speech_threshold=WHISPER_DECODE_DEFAULTS["no_speech_threshold"],
+            repetition_penalty=WHISPER_DECODE_DEFAULTS["repetition_penalty"],
+            vad_filter=False,
+            clip_timestamps=clips
+        )
+
+        def report(sample):
+            check_cancelled()
+            if total_samples > 0:
+                percent = int((done_samples + sample) * 100 / total_samples)
+                print(f"TRANS_PROGRESS: {min(percent, 100)}")
+                sys.stdout.flush()
+
+        routed = route_batch_words(segments, spans, on_segment=report)
+        for job, _, _, _ in spans:
+            pieces = routed[id(job)]
+            if not pieces:
+                empty_jobs.append(job)
+                continue
+            count = write_whisper_segments(job['output'], pieces)
+            print(f"BATCH_DONE: {job['input']} ({count} entries)")
+            sys.stdout.flush()
+
+        done_samples += len(audio)
+
+    return empty_jobs
+
+def check_batch_packing():
+    """
+    批量打包的回归检查 (不需要模型): 两个短于 30 秒的文件 (7 秒、12 秒)
+    - 每个 clip 恰好是一个完整窗口，且只覆盖一个文件 (批量管线不能把两个文件合并进同一次解码)
+    - 跨越文件边界的词按起点分发，时间裁剪到各自文件的时长内
+    返回退出码
+    """
+    import numpy as np
+
+    lengths = {'a.wav': 7 * WHISPER_SAMPLE_RATE, 'b.wav': 12 * WHISPER_SAMPLE_RATE}
+    jobs = [{'input': 'a.wav', 'output': 'a.srt'}, {'input': 'b.wav', 'output': 'b.srt'}]
+    packs = pack_batch_jobs(jobs, max_windows=8, load_audio=lambda path: np.ones(lengths[path], dtype=np.float32))
+    window = WHISPER_SAMPLE_RATE * WHISPER_WINDOW_SECS
+    errors = []
+    if len(packs) != 1:
+        errors.append(f"expected one pack, got {len(packs)}")
+    audio, clips, spans = packs[0]
+    for clip in clips:
+        if clip['end'] - clip['start'] != window:
+            errors.append(f"clip {clip} is not one full window")
+        owners = [job['input'] for job, start, _, padded in spans if start <= clip['start'] and clip['end'] <= padded]
+        if len(owners) != 1:
+            errors.append(f"clip {clip} is not inside exactly one file")
+    if len(audio) != 2 * window or audio[7 * WHISPER_SAMPLE_RATE:window].any():
+        errors.append("files are not padded with silence to whole windows")
+
+    # 解码结果越过 a 的结尾: 一个词在 a 中，一个落在补齐静音中，一个属于 b
+    segment = SimpleNamespace(start=6.0, end=31.5, text="甲乙丙", words=[
+        SimpleNamespace(start=6.0, end=7.4, word="甲"),
+        SimpleNamespace(start=12.0, end=13.0, word="乙"),
+        SimpleNamespace(start=30.5, end=31.5, word="丙")])
+    routed = route_batch_words([segment], spans)
+    a, b = routed[id(jobs[0])], routed[id(jobs[1])]
+    if [[w['word'] for w in piece] for piece in a] != [["甲"]] or a[0][0]['end'] > 7.0:
+        errors.append(f"file a got {a}")
+    if [[w['word'] for w in piece] for piece in b] != [["丙"]] or abs(b[0][0]['start'] - 0.5) > 1e-6:
+        errors.append(f"file b got {b}")
+
+    for error in errors:
+        print(f"Error: {error}")
+    print("BATCH_CHECK: " + ("failed" if errors else "ok"))
+    return 1 if errors else 0
+
+def process_whisper_batch(jobs_file, model_size, batch_size, allow_download=False):
+    with open(jobs_file, "r", encoding="utf-8") as f:
+        jobs = json.load(f)
+    if not jobs:
+        print("Error: batch jobs file is empty")
+        sys.exit(1)
+
+    model, model_path, using_gpu = load_whisper_model(model_size, allow_download)
+    beam_size = whisper_settings(model_size, "cuda" if using_gpu else "cpu")["beam_size"]
+
+    global IS_TRANSCRIBING
+    IS_TRANSCRIBING = True
+
+    retry_jobs = jobs
+    if HAS_BATCHED:
+        try:
+            retry_jobs = transcribe_whisper_batch(model, jobs, batch_size, beam_size)
+        except Exception as e:
+            print(f"Warning: batched transcription failed ({e}), falling back to per-file transcription.")
+            if using_gpu:
+                WHISPER_MODEL_CACHE.pop(model_size, None)
+                del model
+                import gc
+                gc.collect()
+                model = create_whisper_model(model_path, model_size, "cpu")
+                cache_whisper_model(model_size, model, model_path, False)
+                beam_size = whisper_settings(model_size, "cpu")["beam_size"]
+                print("Reloaded model on CPU.")
+            retry_jobs = jobs
+    else:
+        print("Warning: BatchedInferencePipeline not available (faster-whisper < 1.1), transcribing files one by one.")
+
+    # 批量结果为空的任务逐个转录 (含 VAD 重试)，模型只加载一次
+    failed = 0
+    for job in retry_jobs:
+        check_cancelled()
+        try:
+            transcribe_whisper_core(model, job['input'], job['output'], beam_size)
+            print(f"BATCH_DONE: {job['input']}")
+            sys.stdout.flush()
+        except Exception as e:
+            failed += 1
+            print(f"Error: transcription failed for {job['input']}: {e}")
+
+    IS_TRANSCRIBING = False
+
+    for job in jobs:
+        if job.get('txt') and os.path.exists(job['output']):
+            write_transcript_txt(job['output'], job['txt'])
+    return 1 if failed == len(jobs) else 0
+
+def write_transcript_txt(srt_path, txt_path):
+    """
+    从 SRT 导出纯文本稿 (每条字幕一行，去掉序号和时间轴)
+    """
+    lines = []
+    with open(srt_path, "r", encoding="utf-8") as f:
+        for block in f.read().split("\n\n"):
+            rows = [row.strip() for row in block.strip().splitlines()]
+            # 块格式: 序号 / 时间轴 / 文本...
+            if len(rows) >= 3 and "-->" in rows[1]:
+                lines.append(" ".join(row for row in rows[2:] if row))
+    with open(txt_path, "w", encoding="utf-8") as f:
+        for line in lines:
+            f.write(line + "\n")
+    print(f"Transcript saved to {txt_path}")
+
+def build_parser():
     parser = argparse.ArgumentParser(description="Video Subtitle Generator Transcriber")
-    parser.add_argument("input_wav", help="Input WAV file path")
-    parser.add_argument("output_srt", help="Output SRT file path")
+    parser.add_argument("input_wav", nargs="?", help="Input audio: WAV, or any audio/video container decoded directly (mp3, m4a, flac, opus, ...)")
+    parser.add_argument("output_srt", nargs="?", help="Output SRT file path")
     parser.add_argument("--engine", default="vosk", choices=["vosk", "whisper"], help="Transcription engine")
     parser.add_argument("--model", default="small", help="Model name (for Whisper: tiny, base, small, medium, large; for Vosk: ignored)")
-    
+    parser.add_argument("--batch", metavar="JOBS_JSON", help="Batch mode (Whisper only): JSON list of {\"input\": audio, \"output\": srt, \"txt\": optional}")
+    parser.add_argument("--batch-size", type=int, default=8, help="Number of 30s windows decoded per forward pass in batch mode")
+    parser.add_argument("--txt", metavar="TXT", help="Also write a plain-text transcript (single-file mode)")
+    parser.add_argument("--duration", type=float, help="Known media duration in seconds (progress for streamed Vosk decoding)")
+    parser.add_argument("--allow-download", action="store_true", help="Download models missing from the local registry (default: strict offline)")
+    parser.add_argument("--checkpoint", metavar="PATH", help="Record finished segments to PATH and resume from it when rerun (single-file mode)")
+    parser.add_argument("--serve", action="store_true", help="Run as a resident worker reading JSON jobs from stdin")
+    parser.add_argument("--check-batch", action="store_true", help="Run the batch packing regression check (no model needed) and exit")
+    return parser
+
+def run_job(parser, args, script_dir):
+    """
+    执行一次转录任务，返回退出码
+    """
+    if args.check_batch:
+        return check_batch_packing()
+    if args.batch:
+        if args.engine != "whisper":
+            parser.error("--batch requires --engine whisper")
+        return process_whisper_batch(args.batch, args.model, max(1, args.batch_size), args.allow_download)
+    if not args.input_wav or not args.output_srt:
+        parser.error("input_wav and output_srt are required unless --batch is given")
+    if args.engine == "vosk":
+        process_vosk(args.input_wav, args.output_srt, args.duration, args.allow_download, args.checkpoint)
+        code = 0
+    else:
+        code = process_whisper(args.input_wav, args.output_srt, args.model, args.allow_download, args.checkpoint)
+    if code == 0 and args.txt and os.path.exists(args.output_srt):
+        write_transcript_txt(args.output_srt, args.txt)
+    return code
+
+def serve(parser, script_dir):
+    """
+    常驻工作进程: 由 C++ 端预先启动，导入完成后输出 WORKER_READY，
+    之后逐行从 stdin 读取 {"id": n, "args": [...]} 任务 (args 与命令行参数相同)，
+    每个任务结束输出 JOB_DONE: <id> <exit_code>。已加载的模型在任务之间复用。
+    执行中收到 {"cancel": n} 时在下一个段落边界结束该任务 (退出码 130)，进程和模型保留。
+    """
+    import queue
+    global IS_TRANSCRIBING
+    jobs = queue.Queue()
+    current = {"id": None}
+    cancelled = set() # 取消请求可能先于任务开始执行到达
+
+    # stdin 由读取线程处理: 任务排队，取消请求在任务执行期间也能立即生效
+    def read_stdin():
+        for line in sys.stdin:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                message = json.loads(line)
+            except ValueError as e:
+                print(f"Error: invalid worker request: {e}")
+                continue
+            if "cancel" in message:
+                cancelled.add(message["cancel"])
+                if message["cancel"] == current["id"]:
+                    CANCEL_REQUESTED.set()
+                continue
+            jobs.put(message)
+        jobs.put(None)
+
+    threading.Thread(target=read_stdin, daemon=True).start()
+    print("WORKER_READY")
+    sys.stdout.flush()
+
+    while True:
+        job = jobs.get()
+        if job is None:
+            break
+
+        job_id = job.get("id", -1)
+        CANCEL_REQUESTED.clear()
+        current["id"] = job_id
+        if job_id in cancelled:
+            CANCEL_REQUESTED.set()
+        try:
+            check_cancelled()
+            code = run_job(parser, parser.parse_args(job.get("args", [])), script_dir)
+        except JobCancelled:
+            print("Job cancelled")
+            code = 130
+        except SystemExit as e:
+            # 兼容内部的 sys.exit / parser.error，只结束当前任务
+            code = e.code if isinstance(e.code, int) else 1
+        except Exception as e:
+            print(f"Error: worker job failed: {e}")
+            code = 1
+        current["id"] = None
+        cancelled.discard(job_id)
+
+        IS_TRANSCRIBING = False
+        print(f"JOB_DONE: {job_id} {code}")
+        sys.stdout.flush()
+
+def main():
+    parser = build_parser()
     args = parser.parse_args()
     
     script_dir = os.path.dirname(os.path.abspath(__file__))
     
-    if args.engine == "vosk":
-        process_vosk(args.input_wav, args.output_srt, script_dir)
+    if args.serve:
+        serve(parser, script_dir)
+        code = 0
     else:
-        process_whisper(args.input_wav, args.output_srt, args.model)
+        code = run_job(parser, args, script_dir)
+
+    # 使用 os._exit 而非 sys.exit 以避免 C++ 扩展库 (如 ctranslate2) 在析构时崩溃导致非零退出码
+    sys.stdout.flush()
+    os._exit(code)
 
 if __name__ == "__main__":
     main()
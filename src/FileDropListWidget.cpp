@@ -1,10 +1,14 @@
 #include "FileDropListWidget.h"
+#include "MediaFormats.h"
 
 FileDropListWidget::FileDropListWidget(QWidget *parent)
-    : QListWidget(parent)
+    : QListView(parent)
 {
     setAcceptDrops(true);
     setDragDropMode(QAbstractItemView::DropOnly);
+    // 统一行高后视图不必逐行计算尺寸，分批布局避免一次性排布大量行
+    setUniformItemSizes(true);
+    setLayoutMode(QListView::Batched);
 }
 
 void FileDropListWidget::dragEnterEvent(QDragEnterEvent *event)
@@ -26,13 +30,15 @@ void FileDropListWidget::dropEvent(QDropEvent *event)
     const QMimeData *mimeData = event->mimeData();
     if (mimeData->hasUrls()) {
         QStringList files;
+        QStringList dirs;
         QList<QUrl> urlList = mimeData->urls();
         for (const QUrl &url : urlList) {
             QString localFile = url.toLocalFile();
-            QFileInfo fileInfo(localFile);
-            // 简单过滤，只接受视频文件后缀 (可根据需要扩展)
-            QString suffix = fileInfo.suffix().toLower();
-            if (suffix == "mp4" || suffix == "avi" || suffix == "mkv" || suffix == "mov" || suffix == "flv" || suffix == "wmv") {
+            if (localFile.isEmpty()) continue;
+            // 文件夹交给后台扫描；文件按后缀过滤，只接受视频和音频文件
+            if (QFileInfo(localFile).isDir()) {
+                dirs.append(localFile);
+            } else if (MediaFormats::isSupported(localFile)) {
                 files.append(localFile);
             }
         }
@@ -40,6 +46,9 @@ void FileDropListWidget::dropEvent(QDropEvent *event)
         if (!files.isEmpty()) {
             emit filesDropped(files);
         }
+        if (!dirs.isEmpty()) {
+            emit foldersDropped(dirs);
+        }
         event->acceptProposedAction();
     }
 }
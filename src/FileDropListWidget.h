@@ -1,7 +1,7 @@
 #ifndef FILEDROPLISTWIDGET_H
 #define FILEDROPLISTWIDGET_H
 
-#include <QListWidget>
+#include <QListView>
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QMimeData>
@@ -9,9 +9,11 @@
 #include <QFileInfo>
 
 /**
- * @brief 支持文件拖拽的 ListWidget
+ * @brief 支持文件拖拽的列表视图
+ *
+ * 数据由外部模型提供 (见 TaskStore)，行高统一，只绘制可见行，适合大量文件。
  */
-class FileDropListWidget : public QListWidget
+class FileDropListWidget : public QListView
 {
     Q_OBJECT
 public:
@@ -24,6 +26,12 @@ signals:
      */
     void filesDropped(const QStringList &filePaths);
 
+    /**
+     * @brief 当文件夹被拖入时触发 (由调用方在后台递归扫描)
+     * @param dirPaths 文件夹绝对路径列表
+     */
+    void foldersDropped(const QStringList &dirPaths);
+
 protected:
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dragMoveEvent(QDragMoveEvent *event) override;
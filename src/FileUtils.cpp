@@ -0,0 +1,53 @@
+#include "FileUtils.h"
+#include <QFile>
+#include <QFileInfo>
+#include <filesystem>
+#include <system_error>
+
+/**
+ * @brief 原子替换文件
+ *
+ * QFile::rename 在目标已存在时失败，这里使用 std::filesystem::rename:
+ * POSIX 下为 rename(2)，Windows 下为 MoveFileEx(MOVEFILE_REPLACE_EXISTING)，均直接覆盖目标。
+ */
+bool FileUtils::replaceFile(const QString &from, const QString &to)
+{
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::path(from.toStdWString()), std::filesystem::path(to.toStdWString()), error);
+    if (!error) return true;
+
+    // 目标被占用等情况下退回为 删除 + 重命名 (非原子)
+    if (QFile::exists(to) && !QFile::remove(to)) return false;
+    return QFile::rename(from, to);
+}
+
+/**
+ * @brief 移动文件到最终位置
+ *
+ * 跨文件系统 (例如从内存盘到网络存储) 时 rename 失败，这时先在目标目录写出完整副本，
+ * 再用同目录内的 rename 原子替换目标。
+ */
+bool FileUtils::promoteFile(const QString &from, const QString &to)
+{
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::path(from.toStdWString()), std::filesystem::path(to.toStdWString()), error);
+    if (!error) return true;
+    if (error != std::errc::cross_device_link) return replaceFile(from, to);
+
+    QString partial = partialPath(to);
+    QFile::remove(partial);
+    if (!QFile::copy(from, partial) || !replaceFile(partial, to)) {
+        QFile::remove(partial);
+        return false;
+    }
+    QFile::remove(from);
+    return true;
+}
+
+QString FileUtils::partialPath(const QString &path)
+{
+    QFileInfo info(path);
+    QString name = "." + info.completeBaseName() + ".partial";
+    if (!info.suffix().isEmpty()) name += "." + info.suffix();
+    return info.absolutePath() + "/" + name;
+}
@@ -0,0 +1,35 @@
+#ifndef FILEUTILS_H
+#define FILEUTILS_H
+
+#include <QString>
+
+/**
+ * @brief 文件操作辅助函数
+ */
+class FileUtils
+{
+public:
+    /**
+     * @brief 用 from 原子替换 to (同一文件系统内)，读取方只会看到旧文件或新文件
+     * @param from 新文件 (替换成功后不再存在)
+     * @param to 目标路径 (可以已存在)
+     * @return 是否成功
+     */
+    static bool replaceFile(const QString &from, const QString &to);
+
+    /**
+     * @brief 把文件移到最终位置: 同一文件系统内直接原子替换，否则先复制为目标目录中的临时文件再原子替换
+     * @param from 源文件 (成功后不再存在)
+     * @param to 目标路径 (可以已存在，读取方不会看到写了一半的文件)
+     * @return 是否成功
+     */
+    static bool promoteFile(const QString &from, const QString &to);
+
+    /**
+     * @brief 写入 path 时使用的临时文件名: 同目录下的隐藏文件 .<名称>.partial.<扩展名>
+     * (保留扩展名，FFmpeg 据此选择封装格式；隐藏文件不会被监视文件夹当作新文件)
+     */
+    static QString partialPath(const QString &path);
+};
+
+#endif // FILEUTILS_H
@@ -0,0 +1,200 @@
+#include "FolderScanner.h"
+#include "MediaFormats.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+
+/**
+ * @brief 读取扫描配置
+ */
+FolderScanner::Options FolderScanner::Options::load(const QString &path)
+{
+    Options options;
+    options.suffixes = MediaFormats::videoSuffixes() + MediaFormats::audioSuffixes();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        // 写出默认配置，便于用户按需修改
+        QJsonObject root;
+        root["suffixes"] = QJsonArray::fromStringList(options.suffixes);
+        root["minSizeKB"] = 0;
+        root["maxSizeMB"] = 0;
+        root["followSymlinks"] = options.followSymlinks;
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile out(path);
+        if (out.open(QIODevice::WriteOnly)) {
+            out.write(QJsonDocument(root).toJson());
+            out.commit();
+        }
+        return options;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.contains("suffixes")) {
+        QStringList suffixes;
+        const QJsonArray array = root["suffixes"].toArray();
+        for (const QJsonValue &value : array) {
+            QString suffix = value.toString().trimmed().toLower();
+            if (suffix.startsWith('.')) suffix.remove(0, 1);
+            if (!suffix.isEmpty()) suffixes << suffix;
+        }
+        options.suffixes = suffixes;
+    }
+    options.minSizeBytes = qint64(root["minSizeKB"].toDouble()) * 1024;
+    options.maxSizeBytes = qint64(root["maxSizeMB"].toDouble()) * 1024 * 1024;
+    options.followSymlinks = root["followSymlinks"].toBool(true);
+    return options;
+}
+
+/**
+ * @brief 构造函数
+ */
+FolderScanner::FolderScanner(const QString &configPath, QObject *parent)
+    : QObject(parent), configPath(configPath)
+{
+}
+
+FolderScanner::~FolderScanner()
+{
+    // 扫描线程每处理一个目录项都会检查取消标志，等待时间很短
+    if (thread) {
+        cancelRequested = true;
+        thread->wait();
+        delete thread;
+    }
+}
+
+/**
+ * @brief 开始扫描，正在扫描时排队
+ */
+void FolderScanner::scan(const QStringList &roots)
+{
+    if (roots.isEmpty()) return;
+    if (thread) {
+        queuedRoots += roots;
+        return;
+    }
+    startThread(roots);
+}
+
+void FolderScanner::cancel()
+{
+    queuedRoots.clear();
+    if (thread) cancelRequested = true;
+}
+
+void FolderScanner::startThread(const QStringList &roots)
+{
+    Options options = Options::load(configPath);
+    cancelRequested = false;
+
+    thread = QThread::create([this, roots, options]() { run(roots, options); });
+    // 线程结束后在界面线程收尾，再发出 finished，此时 isRunning() 已反映是否有排队的扫描
+    connect(thread, &QThread::finished, this, [this]() {
+        thread->deleteLater();
+        thread = nullptr;
+        int matched = lastMatched;
+        bool cancelled = cancelRequested;
+        if (!queuedRoots.isEmpty()) {
+            QStringList roots = queuedRoots;
+            queuedRoots.clear();
+            startThread(roots);
+        }
+        emit finished(matched, cancelled);
+    });
+    thread->start(QThread::LowPriority);
+}
+
+bool FolderScanner::accepts(const QFileInfo &info, const Options &options)
+{
+    if (!info.isFile()) return false;
+    if (!options.suffixes.contains(info.suffix().toLower())) return false;
+    qint64 size = info.size();
+    if (size < options.minSizeBytes) return false;
+    if (options.maxSizeBytes > 0 && size > options.maxSizeBytes) return false;
+    return true;
+}
+
+/**
+ * @brief 扫描线程主体 (广度优先)，信号以排队方式送到界面线程
+ */
+void FolderScanner::run(const QStringList &roots, const Options &options)
+{
+    QSet<QString> visitedDirs; // 规范路径，防止符号链接环和重复扫描
+    QStringList pendingDirs;
+    QStringList batch;
+    QList<qint64> batchSizes;
+    QList<qint64> batchMtimes;
+    int dirsScanned = 0;
+    int filesMatched = 0;
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+
+    // 按数量或时间分批送出，文件稀疏时也能及时入队
+    auto flush = [&]() {
+        if (!batch.isEmpty()) {
+            emit filesFound(batch, batchSizes, batchMtimes);
+            batch.clear();
+            batchSizes.clear();
+            batchMtimes.clear();
+        }
+        emit progress(dirsScanned, filesMatched);
+        flushTimer.restart();
+    };
+
+    // accepts() 已读取文件信息，大小和修改时间随路径一起送出
+    auto add = [&](const QString &path, const QFileInfo &info) {
+        batch << path;
+        batchSizes << info.size();
+        batchMtimes << info.lastModified().toMSecsSinceEpoch();
+        filesMatched++;
+    };
+
+    for (const QString &root : roots) {
+        QFileInfo info(root);
+        if (info.isDir()) {
+            pendingDirs << root;
+        } else if (accepts(info, options)) {
+            add(info.absoluteFilePath(), info);
+        }
+    }
+
+    while (!pendingDirs.isEmpty() && !cancelRequested) {
+        QString dir = QFileInfo(pendingDirs.takeFirst()).canonicalFilePath();
+        if (dir.isEmpty() || visitedDirs.contains(dir)) continue;
+        visitedDirs.insert(dir);
+        dirsScanned++;
+
+        // 以规范路径遍历，普通文件的绝对路径即规范路径，同一文件不会以不同路径重复入队
+        QDirIterator it(dir, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+        while (it.hasNext() && !cancelRequested) {
+            it.next();
+            QFileInfo entry = it.fileInfo();
+            if (entry.isDir()) {
+                if (options.followSymlinks || !entry.isSymLink()) {
+                    pendingDirs << entry.absoluteFilePath();
+                }
+                continue;
+            }
+            if (!accepts(entry, options)) continue;
+            add(entry.isSymLink() ? entry.canonicalFilePath() : entry.absoluteFilePath(), entry);
+            if (batch.size() >= options.batchSize || flushTimer.elapsed() >= 250) {
+                flush();
+            }
+        }
+        if (flushTimer.elapsed() >= 250) {
+            flush();
+        }
+    }
+
+    flush();
+    lastMatched = filesMatched;
+}
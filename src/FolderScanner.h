@@ -0,0 +1,94 @@
+#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <atomic>
+
+class QFileInfo;
+
+/**
+ * @brief 后台递归扫描文件夹
+ *
+ * 在独立线程中遍历拖入的文件夹，按后缀和大小过滤，找到的文件分批通过 filesFound 信号
+ * 送回界面线程。目录按规范路径去重，符号链接 (或 Windows 目录联接) 构成的环不会导致重复遍历。
+ */
+class FolderScanner : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 扫描选项 (从 JSON 配置文件读取)
+     */
+    struct Options {
+        QStringList suffixes;       // 接受的后缀 (小写，不含点)
+        qint64 minSizeBytes = 0;    // 小于此大小的文件跳过
+        qint64 maxSizeBytes = 0;    // 大于此大小的文件跳过 (0 表示不限)
+        bool followSymlinks = true; // 是否进入符号链接指向的目录
+        int batchSize = 500;        // 每批送回界面的文件数
+
+        /**
+         * @brief 读取配置，文件不存在时写入默认配置供用户修改
+         * @param path 配置文件路径
+         */
+        static Options load(const QString &path);
+    };
+
+    /**
+     * @brief 构造函数
+     * @param configPath 扫描配置文件路径 (每次开始扫描时重新读取)
+     * @param parent 父对象
+     */
+    explicit FolderScanner(const QString &configPath, QObject *parent = nullptr);
+    ~FolderScanner();
+
+    /**
+     * @brief 扫描文件夹 (正在扫描时排在当前扫描之后)
+     * @param roots 根目录列表
+     */
+    void scan(const QStringList &roots);
+
+    /**
+     * @brief 取消当前及排队中的扫描 (已送出的文件不受影响)
+     */
+    void cancel();
+
+    bool isRunning() const { return thread != nullptr; }
+
+signals:
+    /**
+     * @brief 找到一批文件
+     * @param files 文件绝对路径
+     * @param sizes 扫描时的文件大小 (与 files 一一对应)
+     * @param mtimes 扫描时的修改时间 (毫秒时间戳)，界面线程据此查询探测索引而无需再次访问文件
+     */
+    void filesFound(const QStringList &files, const QList<qint64> &sizes, const QList<qint64> &mtimes);
+
+    /**
+     * @brief 扫描进度
+     * @param dirsScanned 已扫描目录数
+     * @param filesMatched 已找到文件数
+     */
+    void progress(int dirsScanned, int filesMatched);
+
+    /**
+     * @brief 扫描结束
+     * @param filesMatched 找到的文件总数
+     * @param cancelled 是否被取消
+     */
+    void finished(int filesMatched, bool cancelled);
+
+private:
+    void startThread(const QStringList &roots);
+    void run(const QStringList &roots, const Options &options);
+    static bool accepts(const QFileInfo &info, const Options &options);
+
+    QString configPath;
+    QThread *thread = nullptr;
+    QStringList queuedRoots;                  // 扫描进行中时新拖入的目录
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<int> lastMatched{0};          // 扫描线程写入，线程结束后读取
+};
+
+#endif // FOLDERSCANNER_H
@@ -0,0 +1,305 @@
+#include "FolderWatcher.h"
+#include "MediaFormats.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+/**
+ * @brief 构造函数
+ */
+FolderWatcher::FolderWatcher(const QString &configPath, QObject *parent)
+    : QObject(parent), configPath(configPath)
+{
+    suffixes = MediaFormats::videoSuffixes() + MediaFormats::audioSuffixes();
+
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::onDirectoryChanged);
+
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(kDebounceMs);
+    connect(&debounceTimer, &QTimer::timeout, this, &FolderWatcher::rescanDirtyDirs);
+
+    stabilityTimer.setInterval(kStabilityCheckMs);
+    connect(&stabilityTimer, &QTimer::timeout, this, &FolderWatcher::checkCandidates);
+}
+
+/**
+ * @brief 读取监视配置，不存在时写出示例 (空列表)
+ */
+QList<FolderWatcher::Profile> FolderWatcher::loadProfiles() const
+{
+    QList<Profile> result;
+    QFile file(configPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QJsonObject example;
+        example["path"] = QDir::toNativeSeparators(QDir::homePath() + "/Videos/inbox");
+        example["engine"] = "whisper";
+        example["model"] = "small";
+        example["outputDir"] = "";
+        example["transcriptOnly"] = false;
+        example["recursive"] = false;
+        example["processExisting"] = false;
+        QJsonObject root;
+        root["stableSecs"] = 3;
+        root["folders"] = QJsonArray();
+        root["example"] = example;
+        QDir().mkpath(QFileInfo(configPath).absolutePath());
+        QSaveFile out(configPath);
+        if (out.open(QIODevice::WriteOnly)) {
+            out.write(QJsonDocument(root).toJson());
+            out.commit();
+        }
+        return result;
+    }
+
+    static const QStringList engines = {"whisper", "vosk"};
+    static const QStringList models = {"tiny", "base", "small", "medium", "large"};
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonArray folders = root["folders"].toArray();
+    for (const QJsonValue &value : folders) {
+        QJsonObject entry = value.toObject();
+        Profile profile;
+        profile.path = QDir::cleanPath(QDir::fromNativeSeparators(entry["path"].toString()));
+        if (profile.path.isEmpty() || profile.path == ".") continue;
+        // 无效的引擎/模型回退为界面选项
+        profile.engine = engines.contains(entry["engine"].toString()) ? entry["engine"].toString() : QString();
+        profile.model = models.contains(entry["model"].toString()) ? entry["model"].toString() : QString();
+        profile.outputDir = entry["outputDir"].toString();
+        profile.transcriptOnly = entry["transcriptOnly"].toBool();
+        profile.recursive = entry["recursive"].toBool();
+        profile.processExisting = entry["processExisting"].toBool();
+        result << profile;
+    }
+    return result;
+}
+
+bool FolderWatcher::start()
+{
+    stop();
+
+    QFile file(configPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        double stableSecs = QJsonDocument::fromJson(file.readAll()).object()["stableSecs"].toDouble(3);
+        stableMs = int(qBound(1.0, stableSecs, 600.0) * 1000);
+    }
+    profiles = loadProfiles();
+
+    for (int i = 0; i < profiles.size(); ++i) {
+        if (!QFileInfo(profiles[i].path).isDir()) {
+            emit logMessage("监视文件夹不存在，跳过: " + profiles[i].path);
+            continue;
+        }
+        watchDir(profiles[i].path, i, true);
+    }
+    running = !dirProfiles.isEmpty();
+    if (running) {
+        emit logMessage(QString("开始监视 %1 个文件夹 (文件稳定 %2 秒后入队)").arg(dirProfiles.size()).arg(stableMs / 1000.0));
+    }
+    return running;
+}
+
+void FolderWatcher::stop()
+{
+    if (!watcher->directories().isEmpty()) {
+        watcher->removePaths(watcher->directories());
+    }
+    debounceTimer.stop();
+    stabilityTimer.stop();
+    if (probe) {
+        probe->disconnect(this);
+        connect(probe, &QProcess::finished, probe, &QObject::deleteLater);
+        probe->kill();
+        probe = nullptr;
+    }
+    probingPath.clear();
+    probeQueue.clear();
+    candidates.clear();
+    dirtyDirs.clear();
+    dirProfiles.clear();
+    known.clear();
+    running = false;
+}
+
+/**
+ * @brief 监视目录并列出其中的文件 (递归配置下包括子目录)
+ * @param initial 开始监视时的首次列出 (已有文件按配置决定是否入队)
+ */
+void FolderWatcher::watchDir(const QString &dir, int profileIndex, bool initial)
+{
+    QString path = QFileInfo(dir).canonicalFilePath();
+    if (path.isEmpty() || dirProfiles.contains(path)) return;
+    dirProfiles.insert(path, profileIndex);
+    watcher->addPath(path);
+    scanDir(path, profileIndex, initial);
+}
+
+void FolderWatcher::scanDir(const QString &dir, int profileIndex, bool initial)
+{
+    const Profile &profile = profiles[profileIndex];
+    const QFileInfoList entries = QDir(dir).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QFileInfo &info : entries) {
+        if (info.isDir()) {
+            // Extra 目录存放本程序的中间文件和导出文件
+            if (profile.recursive && info.fileName() != "Extra") {
+                watchDir(info.filePath(), profileIndex, initial);
+            }
+            continue;
+        }
+
+        QString path = info.absoluteFilePath();
+        if (known.contains(path) || candidates.contains(path)) continue;
+        if (!suffixes.contains(info.suffix().toLower()) || isOwnOutput(info.fileName())) continue;
+        if (initial && !profile.processExisting) {
+            known.insert(path);
+            continue;
+        }
+
+        Candidate candidate;
+        candidate.profileIndex = profileIndex;
+        candidate.size = info.size();
+        candidate.modified = info.lastModified();
+        candidate.stableTimer.start();
+        candidates.insert(path, candidate);
+    }
+    if (!candidates.isEmpty() && !stabilityTimer.isActive()) {
+        stabilityTimer.start();
+    }
+}
+
+/**
+ * @brief 本程序写出的文件 (输出视频、精修临时文件、隐藏文件)
+ */
+bool FolderWatcher::isOwnOutput(const QString &fileName) const
+{
+    QString baseName = QFileInfo(fileName).completeBaseName();
+    return fileName.startsWith('.') || baseName.endsWith("_subtitled") || baseName.contains(".refine");
+}
+
+void FolderWatcher::onDirectoryChanged(const QString &dir)
+{
+    dirtyDirs.insert(dir);
+    debounceTimer.start();
+}
+
+void FolderWatcher::rescanDirtyDirs()
+{
+    const QSet<QString> dirs = dirtyDirs;
+    dirtyDirs.clear();
+    for (const QString &dir : dirs) {
+        if (!dirProfiles.contains(dir)) continue;
+        if (!QFileInfo(dir).isDir()) {
+            dirProfiles.remove(dir); // 目录已删除，监视随之失效
+            continue;
+        }
+        // 已删除的文件不再记为已知，同名文件重新出现时 (例如再次上传) 会重新入队
+        for (auto it = known.begin(); it != known.end();) {
+            if (QFileInfo(*it).absolutePath() == dir && !QFile::exists(*it)) {
+                it = known.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        scanDir(dir, dirProfiles.value(dir), false);
+    }
+}
+
+/**
+ * @brief 检查候选文件是否已停止变化，稳定的文件送去探测
+ */
+void FolderWatcher::checkCandidates()
+{
+    for (auto it = candidates.begin(); it != candidates.end();) {
+        Candidate &candidate = it.value();
+        if (candidate.probing) {
+            ++it;
+            continue;
+        }
+        QFileInfo info(it.key());
+        if (!info.exists()) {
+            it = candidates.erase(it); // 写入方取消或移走了文件
+            continue;
+        }
+        if (info.size() != candidate.size || info.lastModified() != candidate.modified) {
+            candidate.size = info.size();
+            candidate.modified = info.lastModified();
+            candidate.stableTimer.restart();
+        } else if (candidate.size > 0 && candidate.stableTimer.elapsed() >= stableMs) {
+            candidate.probing = true;
+            probeQueue << it.key();
+        }
+        ++it;
+    }
+    if (candidates.isEmpty()) {
+        stabilityTimer.stop();
+    }
+    startNextProbe();
+}
+
+/**
+ * @brief 逐个用 ffprobe 读取时长 (未写完的 MP4 等读不出时长)
+ */
+void FolderWatcher::startNextProbe()
+{
+    if (probe || probeQueue.isEmpty()) return;
+    probingPath = probeQueue.takeFirst();
+
+    probe = new QProcess(this);
+    connect(probe, &QProcess::finished, this, &FolderWatcher::onProbeFinished);
+    // 启动失败可能在 start() 内同步发出，排队处理避免重入
+    connect(probe, &QProcess::errorOccurred, this, &FolderWatcher::onProbeError, Qt::QueuedConnection);
+    probe->start("ffprobe", QStringList() << "-v" << "error" << "-show_entries" << "format=duration"
+                                          << "-of" << "default=noprint_wrappers=1:nokey=1"
+                                          << QDir::toNativeSeparators(probingPath));
+}
+
+void FolderWatcher::onProbeFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (sender() != probe) return;
+    bool ok = false;
+    double duration = QString::fromUtf8(probe->readAllStandardOutput()).trimmed().toDouble(&ok);
+    finishProbe(exitStatus == QProcess::NormalExit && exitCode == 0 && ok && duration > 0, duration);
+}
+
+void FolderWatcher::onProbeError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart || sender() != probe) return;
+    // 没有 ffprobe 时只依据文件大小稳定判断 (后续处理本身也会失败并报告)
+    emit logMessage("警告: 无法启动 ffprobe，监视文件夹只按文件大小判断写入完成");
+    finishProbe(true, 0);
+}
+
+void FolderWatcher::finishProbe(bool ok, double durationSecs)
+{
+    probe->disconnect(this);
+    probe->deleteLater();
+    probe = nullptr;
+    QString path = probingPath;
+    probingPath.clear();
+
+    auto it = candidates.find(path);
+    if (it != candidates.end()) {
+        Candidate &candidate = it.value();
+        candidate.probing = false;
+        QFileInfo info(path);
+        if (ok && info.size() == candidate.size && info.lastModified() == candidate.modified) {
+            Profile profile = profiles[candidate.profileIndex];
+            candidates.erase(it);
+            known.insert(path);
+            emit fileReady(path, profile, durationSecs);
+        } else if (!ok && ++candidate.probeFailures >= kMaxProbeFailures) {
+            candidates.erase(it);
+            known.insert(path);
+            emit logMessage("监视文件夹: 无法识别的媒体文件，跳过: " + path);
+        } else {
+            candidate.stableTimer.restart(); // 探测期间仍在写入，或还不完整，继续等待
+        }
+    }
+    if (!candidates.isEmpty() && !stabilityTimer.isActive()) {
+        stabilityTimer.start();
+    }
+    startNextProbe();
+}
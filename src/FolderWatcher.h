@@ -0,0 +1,122 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QProcess>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+/**
+ * @brief 监视文件夹 (持续入队)
+ *
+ * 监视 watch_folders.json 中配置的目录 (QFileSystemWatcher，Linux 下为 inotify，Windows 下为
+ * ReadDirectoryChangesW)，目录变化事件经过短暂合并后重新列目录，发现新的媒体文件时:
+ * 1. 等待文件大小和修改时间在 stableSecs 内不再变化 (只对候选文件计时，空闲时没有任何轮询)；
+ * 2. 用 ffprobe 快速探测，能读出时长才认为写入完成 (探测失败的文件继续等待)；
+ * 3. 发出 fileReady，附带该目录的处理配置 (引擎、模型、输出目录等)。
+ * 本程序的输出 (*_subtitled.*、Extra 目录、精修临时文件) 不会被当作新文件。
+ */
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 单个监视目录的处理配置，空字段表示使用界面当前的选项
+     */
+    struct Profile {
+        QString path;
+        QString engine;              // whisper / vosk
+        QString model;               // Whisper 模型
+        QString outputDir;           // 输出目录
+        bool transcriptOnly = false; // 只输出字幕和文本稿
+        bool recursive = false;      // 同时监视子目录
+        bool processExisting = false; // 开始监视时目录中已有的文件也入队
+    };
+
+    /**
+     * @brief 构造函数
+     * @param configPath watch_folders.json 路径 (每次开始监视时重新读取)
+     * @param parent 父对象
+     */
+    explicit FolderWatcher(const QString &configPath, QObject *parent = nullptr);
+
+    /**
+     * @brief 读取配置并开始监视
+     * @return 没有可监视的目录时返回 false
+     */
+    bool start();
+
+    /**
+     * @brief 停止监视 (等待中的文件被丢弃)
+     */
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    /**
+     * @brief 配置文件路径
+     */
+    QString configFile() const { return configPath; }
+
+signals:
+    /**
+     * @brief 文件已写入完成
+     * @param path 文件绝对路径
+     * @param profile 所在监视目录的配置
+     * @param durationSecs 探测到的时长 (ffprobe 不可用时为 0)
+     */
+    void fileReady(const QString &path, const FolderWatcher::Profile &profile, double durationSecs);
+
+    void logMessage(const QString &message);
+
+private slots:
+    void onDirectoryChanged(const QString &dir);
+    void rescanDirtyDirs();
+    void checkCandidates();
+    void onProbeFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProbeError(QProcess::ProcessError error);
+
+private:
+    struct Candidate {
+        int profileIndex = 0;
+        qint64 size = -1;
+        QDateTime modified;
+        QElapsedTimer stableTimer; // 上次变化以来的时间
+        int probeFailures = 0;
+        bool probing = false;
+    };
+
+    QList<Profile> loadProfiles() const;
+    void watchDir(const QString &dir, int profileIndex, bool initial);
+    void scanDir(const QString &dir, int profileIndex, bool initial);
+    bool isOwnOutput(const QString &fileName) const;
+    void startNextProbe();
+    void finishProbe(bool ok, double durationSecs);
+
+    QString configPath;
+    bool running = false;
+    int stableMs = 3000;
+    QStringList suffixes;
+    QList<Profile> profiles;
+    QFileSystemWatcher *watcher;
+    QHash<QString, int> dirProfiles;      // 已监视目录 -> 配置序号
+    QSet<QString> known;                  // 已入队或开始监视前已存在的文件
+    QHash<QString, Candidate> candidates; // 等待写入完成的文件
+    QSet<QString> dirtyDirs;              // 待重新列出的目录 (合并短时间内的多次事件)
+    QTimer debounceTimer;
+    QTimer stabilityTimer;
+    QStringList probeQueue;
+    QProcess *probe = nullptr;
+    QString probingPath;
+
+    static constexpr int kDebounceMs = 300;
+    static constexpr int kStabilityCheckMs = 1000;
+    static constexpr int kMaxProbeFailures = 5;
+};
+
+#endif // FOLDERWATCHER_H
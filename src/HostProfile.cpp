@@ -0,0 +1,79 @@
+#include "HostProfile.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QSysInfo>
+#include <QThread>
+#ifdef Q_OS_UNIX
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief 构造函数
+ */
+HostProfile::HostProfile(const QString &path)
+    : preset("fast")
+{
+    load(path);
+}
+
+bool HostProfile::isLoaded() const
+{
+    return loaded;
+}
+
+QString HostProfile::x264Preset() const
+{
+    return preset;
+}
+
+void HostProfile::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    // 与 Python 端相同，整个 host 对象一致才认为是本机生成
+    if (root["host"].toObject() != hostFingerprint()) return;
+    loaded = true;
+
+    static const QStringList knownPresets = {"ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower", "veryslow"};
+    QString tuned = root["x264"].toObject()["preset"].toString();
+    if (knownPresets.contains(tuned)) {
+        preset = tuned;
+    }
+}
+
+/**
+ * @brief 本机标识，字段和取值与 scripts/host_profile.py 的 host_fingerprint() 一致
+ * cpu_count: os.cpu_count() (在线逻辑 CPU 数，不受进程亲和性限制)；
+ * machine: platform.machine() (POSIX 下为 uname 的 machine，Windows 下为 PROCESSOR_ARCHITECTURE)；
+ * platform: sys.platform
+ */
+QJsonObject HostProfile::hostFingerprint()
+{
+    QJsonObject host;
+#ifdef Q_OS_UNIX
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    host["cpu_count"] = cpus > 0 ? int(cpus) : 1;
+    struct utsname name;
+    host["machine"] = uname(&name) == 0 ? QString::fromLocal8Bit(name.machine) : QString();
+#else
+    host["cpu_count"] = QThread::idealThreadCount();
+    QString machine = qEnvironmentVariable("PROCESSOR_ARCHITEW6432");
+    host["machine"] = machine.isEmpty() ? qEnvironmentVariable("PROCESSOR_ARCHITECTURE") : machine;
+#endif
+
+#if defined(Q_OS_WIN)
+    host["platform"] = "win32";
+#elif defined(Q_OS_MACOS)
+    host["platform"] = "darwin";
+#elif defined(Q_OS_LINUX)
+    host["platform"] = "linux";
+#else
+    host["platform"] = QSysInfo::kernelType();
+#endif
+    return host;
+}
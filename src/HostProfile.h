@@ -0,0 +1,44 @@
+#ifndef HOSTPROFILE_H
+#define HOSTPROFILE_H
+
+#include <QJsonObject>
+#include <QString>
+
+/**
+ * @brief 本机调优配置
+ *
+ * 读取 scripts/autotune.py 生成的 host_profile.json (Whisper 推理参数由 transcribe.py 自行读取，
+ * 这里只使用编码器部分)。文件不存在或由其他机器生成时使用默认值。
+ */
+class HostProfile
+{
+public:
+    /**
+     * @brief 构造函数，加载配置
+     * @param path 配置文件路径
+     */
+    explicit HostProfile(const QString &path);
+
+    /**
+     * @brief 是否加载了属于本机的配置
+     */
+    bool isLoaded() const;
+
+    /**
+     * @brief 硬字幕合成使用的 x264 preset，未调优时为 "fast"
+     */
+    QString x264Preset() const;
+
+    /**
+     * @brief 本机标识 {cpu_count, machine, platform}，与 host_profile.json 中的 host 比较
+     */
+    static QJsonObject hostFingerprint();
+
+private:
+    void load(const QString &path);
+
+    bool loaded = false;
+    QString preset;
+};
+
+#endif // HOSTPROFILE_H
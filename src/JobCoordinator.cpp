@@ -0,0 +1,328 @@
+#include "JobCoordinator.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+/**
+ * @brief 构造函数
+ */
+JobCoordinator::JobCoordinator(const QString &configPath, QObject *parent)
+    : QObject(parent), configPath(configPath)
+{
+    server = new QTcpServer(this);
+    connect(server, &QTcpServer::newConnection, this, &JobCoordinator::onNewConnection);
+    connect(&leaseTimer, &QTimer::timeout, this, &JobCoordinator::checkLeases);
+}
+
+JobCoordinator::~JobCoordinator()
+{
+    stop();
+}
+
+/**
+ * @brief 读取配置并开始监听，配置不存在时写出默认值 (只监听本机)
+ */
+bool JobCoordinator::start()
+{
+    QJsonObject root;
+    QFile file(configPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        root = QJsonDocument::fromJson(file.readAll()).object();
+    } else {
+        root["bind"] = "127.0.0.1";
+        root["port"] = 47100;
+        root["leaseSecs"] = 60;
+        root["maxAttempts"] = 3;
+        root["token"] = "";
+        QDir().mkpath(QFileInfo(configPath).absolutePath());
+        QSaveFile out(configPath);
+        if (out.open(QIODevice::WriteOnly)) {
+            out.write(QJsonDocument(root).toJson());
+            out.commit();
+        }
+    }
+    bindAddress = root["bind"].toString("127.0.0.1");
+    port = quint16(root["port"].toInt(47100));
+    leaseMs = qBound(10, root["leaseSecs"].toInt(60), 3600) * 1000;
+    maxAttempts = qMax(1, root["maxAttempts"].toInt(3));
+    token = root["token"].toString();
+
+    if (server->isListening()) return true;
+    QHostAddress address = bindAddress == "*" ? QHostAddress(QHostAddress::Any) : QHostAddress(bindAddress);
+    if (!server->listen(address, port)) {
+        emit logMessage("错误: 协调器无法监听 " + address.toString() + ":" + QString::number(port) + " - " + server->errorString());
+        return false;
+    }
+    if (address != QHostAddress::LocalHost && token.isEmpty()) {
+        emit logMessage("警告: 协调器监听在非本机地址且未设置访问令牌 (coordinator.json 中的 token)");
+    }
+    leaseTimer.start(qMax(1000, leaseMs / 4));
+    return true;
+}
+
+QList<int> JobCoordinator::stop()
+{
+    QList<int> unfinished = jobs.keys();
+    leaseTimer.stop();
+    server->close();
+    const QList<QTcpSocket*> sockets = workers.keys();
+    workers.clear();
+    for (QTcpSocket *socket : sockets) {
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+    }
+    leases.clear();
+    jobs.clear();
+    pending.clear();
+    if (!sockets.isEmpty()) emit workersChanged(0);
+    return unfinished;
+}
+
+bool JobCoordinator::isRunning() const
+{
+    return server->isListening();
+}
+
+QString JobCoordinator::address() const
+{
+    return bindAddress + ":" + QString::number(server->serverPort());
+}
+
+void JobCoordinator::submit(int taskId, const QJsonObject &spec)
+{
+    if (jobs.contains(taskId)) return;
+    Job job;
+    job.spec = spec;
+    jobs.insert(taskId, job);
+    pending.enqueue(taskId);
+    dispatch();
+}
+
+void JobCoordinator::cancel(int taskId)
+{
+    auto job = jobs.find(taskId);
+    if (job == jobs.end()) return;
+    int leaseId = job->leaseId;
+    jobs.erase(job);
+    pending.removeAll(taskId);
+
+    auto lease = leases.find(leaseId);
+    if (lease == leases.end()) return;
+    auto worker = workers.find(lease->socket);
+    if (worker != workers.end()) {
+        worker->leaseId = 0;
+        send(worker->socket, QJsonObject{{"type", "revoked"}, {"lease", leaseId}});
+    }
+    leases.erase(lease);
+}
+
+void JobCoordinator::prioritize(int taskId)
+{
+    if (pending.removeAll(taskId) > 0) {
+        pending.prepend(taskId);
+    }
+}
+
+bool JobCoordinator::hasJob(int taskId) const
+{
+    return jobs.contains(taskId);
+}
+
+int JobCoordinator::workerCount() const
+{
+    return workers.size();
+}
+
+void JobCoordinator::onNewConnection()
+{
+    while (QTcpSocket *socket = server->nextPendingConnection()) {
+        Worker worker;
+        worker.socket = socket;
+        worker.name = socket->peerAddress().toString();
+        workers.insert(socket, worker);
+        connect(socket, &QTcpSocket::readyRead, this, &JobCoordinator::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &JobCoordinator::onDisconnected);
+    }
+}
+
+void JobCoordinator::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    while (socket && workers.contains(socket) && socket->canReadLine()) {
+        QJsonObject message = QJsonDocument::fromJson(socket->readLine()).object();
+        if (message.isEmpty()) continue;
+        handleMessage(workers[socket], message);
+    }
+}
+
+/**
+ * @brief 连接断开: 收回该节点持有的租约
+ */
+void JobCoordinator::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    auto it = workers.find(socket);
+    if (it == workers.end()) return;
+    int leaseId = it->leaseId;
+    QString name = it->name;
+    bool authenticated = it->authenticated;
+    workers.erase(it);
+    socket->deleteLater();
+
+    if (leaseId) revokeLease(leaseId, "工作节点断开: " + name);
+    if (authenticated) {
+        emit logMessage("工作节点已断开: " + name);
+        emit workersChanged(workers.size());
+    }
+}
+
+void JobCoordinator::handleMessage(Worker &worker, const QJsonObject &message)
+{
+    QString type = message["type"].toString();
+
+    if (!worker.authenticated) {
+        if (type != "hello" || (!token.isEmpty() && message["token"].toString() != token)) {
+            send(worker.socket, QJsonObject{{"type", "error"}, {"message", "unauthorized"}});
+            worker.socket->disconnectFromHost();
+            return;
+        }
+        worker.authenticated = true;
+        worker.name = message["worker"].toString(worker.name);
+        send(worker.socket, QJsonObject{{"type", "welcome"}, {"leaseSecs", leaseMs / 1000},
+                                        {"heartbeatSecs", qMax(1, leaseMs / 4000)}});
+        emit logMessage("工作节点已连接: " + worker.name);
+        emit workersChanged(workers.size());
+        return;
+    }
+
+    if (type == "request") {
+        worker.waiting = true;
+        dispatch();
+    } else if (type == "heartbeat") {
+        int leaseId = message["lease"].toInt();
+        auto it = leases.find(leaseId);
+        if (it == leases.end() || it->socket != worker.socket) {
+            // 租约已过期并被重新分配，通知节点放弃
+            send(worker.socket, QJsonObject{{"type", "revoked"}, {"lease", leaseId}});
+            return;
+        }
+        it->lastHeartbeat.restart();
+        send(worker.socket, QJsonObject{{"type", "ack"}, {"lease", leaseId}});
+        emit jobProgress(it->taskId, message["stage"].toString(), message["progress"].toDouble());
+    } else if (type == "done") {
+        int leaseId = message["lease"].toInt();
+        auto it = leases.find(leaseId);
+        if (it == leases.end() || it->socket != worker.socket) {
+            emit logMessage("忽略已收回租约的结果: " + worker.name);
+            return;
+        }
+        worker.leaseId = 0;
+        completeLease(leaseId, message["ok"].toBool(), message["error"].toString());
+    }
+}
+
+/**
+ * @brief 把排队的任务分给等待中的工作节点
+ */
+void JobCoordinator::dispatch()
+{
+    for (Worker &worker : workers) {
+        if (pending.isEmpty()) return;
+        if (!worker.authenticated || !worker.waiting || worker.leaseId) continue;
+
+        int taskId = pending.dequeue();
+        Job &job = jobs[taskId];
+        job.attempts++;
+        job.leaseId = nextLeaseId++;
+
+        Lease lease;
+        lease.taskId = taskId;
+        lease.socket = worker.socket;
+        lease.lastHeartbeat.start();
+        leases.insert(job.leaseId, lease);
+        worker.waiting = false;
+        worker.leaseId = job.leaseId;
+
+        send(worker.socket, QJsonObject{{"type", "job"}, {"lease", job.leaseId}, {"task", taskId},
+                                        {"attempt", job.attempts}, {"spec", job.spec}});
+        emit jobStarted(taskId, worker.name, job.attempts);
+    }
+}
+
+void JobCoordinator::send(QTcpSocket *socket, const QJsonObject &message)
+{
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+}
+
+/**
+ * @brief 收回超过租约时长未发送心跳的任务
+ */
+void JobCoordinator::checkLeases()
+{
+    QList<int> expired;
+    for (auto it = leases.cbegin(); it != leases.cend(); ++it) {
+        if (it->lastHeartbeat.elapsed() > leaseMs) expired << it.key();
+    }
+    for (int leaseId : expired) {
+        auto worker = workers.find(leases[leaseId].socket);
+        if (worker != workers.end()) {
+            worker->leaseId = 0;
+            send(worker->socket, QJsonObject{{"type", "revoked"}, {"lease", leaseId}});
+        }
+        revokeLease(leaseId, "租约过期 (超过 " + QString::number(leaseMs / 1000) + " 秒无心跳)");
+    }
+}
+
+/**
+ * @brief 收回租约: 任务重新排队，尝试次数用完时以失败结束
+ */
+void JobCoordinator::revokeLease(int leaseId, const QString &reason)
+{
+    auto it = leases.find(leaseId);
+    if (it == leases.end()) return;
+    int taskId = it->taskId;
+    leases.erase(it);
+    if (!jobs.contains(taskId)) return;
+
+    Job &job = jobs[taskId];
+    job.leaseId = 0;
+    job.lastError = reason;
+    if (job.attempts >= maxAttempts) {
+        jobs.remove(taskId);
+        emit jobFinished(taskId, false, reason);
+        return;
+    }
+    emit logMessage(QString("%1，任务重新排队 (已尝试 %2/%3 次)").arg(reason).arg(job.attempts).arg(maxAttempts));
+    pending.prepend(taskId);
+    dispatch();
+}
+
+/**
+ * @brief 节点报告任务结束: 成功则完成，失败则按剩余次数重试
+ */
+void JobCoordinator::completeLease(int leaseId, bool success, const QString &error)
+{
+    auto it = leases.find(leaseId);
+    if (it == leases.end()) return;
+    int taskId = it->taskId;
+    leases.erase(it);
+    if (!jobs.contains(taskId)) return;
+
+    Job &job = jobs[taskId];
+    job.leaseId = 0;
+    if (success || job.attempts >= maxAttempts) {
+        jobs.remove(taskId);
+        emit jobFinished(taskId, success, error);
+        return;
+    }
+    job.lastError = error;
+    emit logMessage(QString("工作节点处理失败 (%1)，任务重新排队 (已尝试 %2/%3 次)").arg(error).arg(job.attempts).arg(maxAttempts));
+    pending.enqueue(taskId);
+    dispatch();
+}
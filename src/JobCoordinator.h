@@ -0,0 +1,156 @@
+#ifndef JOBCOORDINATOR_H
+#define JOBCOORDINATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QQueue>
+#include <QTimer>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @brief 任务协调器 (多节点分发)
+ *
+ * 持有待处理任务，通过 TCP 上的 JSON 行协议把任务租给工作节点 (scripts/pipeline_worker.py)。
+ * 工作节点无状态: 任务消息包含全部参数，输入和输出通过共享存储按路径读写。
+ * - 工作节点空闲时发送 request，协调器有任务时立即下发 (无任务时挂起请求，不轮询)；
+ * - 执行中定时发送 heartbeat，超过租约时长未收到心跳或连接断开时收回任务并重新排队；
+ * - 失败或租约过期的任务最多尝试 maxAttempts 次；被收回的租约迟到的结果被忽略。
+ * 监听地址、端口、租约时长和访问令牌来自 coordinator.json (首次启动时写入默认值)。
+ */
+class JobCoordinator : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数
+     * @param configPath coordinator.json 路径 (每次 start 时重新读取)
+     * @param parent 父对象
+     */
+    explicit JobCoordinator(const QString &configPath, QObject *parent = nullptr);
+    ~JobCoordinator();
+
+    /**
+     * @brief 开始监听
+     * @return 监听失败时返回 false
+     */
+    bool start();
+
+    /**
+     * @brief 停止监听并断开所有工作节点
+     * @return 尚未完成的任务 ID (调用方可改为本地处理)
+     */
+    QList<int> stop();
+
+    bool isRunning() const;
+
+    /**
+     * @brief 监听地址 (host:port)，供工作节点连接
+     */
+    QString address() const;
+
+    /**
+     * @brief 提交任务
+     * @param taskId 任务 ID
+     * @param spec 任务参数 (路径、引擎、模型、编码参数等)
+     */
+    void submit(int taskId, const QJsonObject &spec);
+
+    /**
+     * @brief 取消任务: 排队中的直接移除，执行中的通知节点放弃 (不发出 jobFinished)
+     */
+    void cancel(int taskId);
+
+    /**
+     * @brief 排队中的任务移到队首 (已租出的任务不受影响)
+     */
+    void prioritize(int taskId);
+
+    /**
+     * @brief 任务是否已提交且尚未结束
+     */
+    bool hasJob(int taskId) const;
+
+    /**
+     * @brief 已连接的工作节点数
+     */
+    int workerCount() const;
+
+signals:
+    /**
+     * @brief 任务已租给工作节点
+     */
+    void jobStarted(int taskId, const QString &worker, int attempt);
+
+    /**
+     * @brief 工作节点报告的进度
+     * @param stage 阶段 (extract / transcribe / embed)
+     * @param fraction 阶段完成比例 (0~1)
+     */
+    void jobProgress(int taskId, const QString &stage, double fraction);
+
+    /**
+     * @brief 任务结束 (成功，或重试次数用完)
+     */
+    void jobFinished(int taskId, bool success, const QString &error);
+
+    /**
+     * @brief 工作节点数量变化
+     */
+    void workersChanged(int count);
+
+    void logMessage(const QString &message);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void checkLeases();
+
+private:
+    struct Job {
+        QJsonObject spec;
+        int attempts = 0;
+        int leaseId = 0; // 当前租约，0 表示排队中
+        QString lastError;
+    };
+    struct Worker {
+        QTcpSocket *socket = nullptr;
+        QString name;
+        bool authenticated = false;
+        bool waiting = false; // 已发送 request，等待任务
+        int leaseId = 0;
+    };
+    struct Lease {
+        int taskId = 0;
+        QTcpSocket *socket = nullptr;
+        QElapsedTimer lastHeartbeat;
+    };
+
+    void handleMessage(Worker &worker, const QJsonObject &message);
+    void dispatch();
+    void send(QTcpSocket *socket, const QJsonObject &message);
+    void revokeLease(int leaseId, const QString &reason);
+    void completeLease(int leaseId, bool success, const QString &error);
+
+    QString configPath;
+    QTcpServer *server;
+    QString bindAddress;
+    quint16 port = 0;
+    QString token;
+    int leaseMs = 60000;
+    int maxAttempts = 3;
+
+    QHash<int, Job> jobs;               // 任务 ID -> 任务
+    QQueue<int> pending;                // 排队中的任务 ID
+    QHash<QTcpSocket*, Worker> workers;
+    QHash<int, Lease> leases;
+    int nextLeaseId = 1;
+    QTimer leaseTimer;
+};
+
+#endif // JOBCOORDINATOR_H
@@ -1,4 +1,7 @@
 #include "MainWindow.h"
+#include "FileUtils.h"
+#include "MediaFormats.h"
+#include "ProcessControl.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFileDialog>
@@ -14,25 +17,165 @@
 #include <QMimeData>
 #include <QMenu>
 #include <QScrollBar>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QThread>
+#include <QSignalBlocker>
+#include <QTemporaryFile>
 
 /**
  * @brief 构造函数，初始化UI
  */
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), isProcessing(false), currentStage(StageNone), totalDurationSecs(0), currentProcess(nullptr)
+    : QMainWindow(parent), isProcessing(false), batchIndex(0), batchLeaseId(0), waitingForResources(false),
+      stagePaused(false), preemptRequested(false), preempting(false), stagePausedMs(0), stageResumed(false), currentStage(StageNone), totalDurationSecs(0), currentProcess(nullptr),
+      currentJobId(-1), totalSpawnLatencyMs(0), spawnCount(0),
+      stageFraction(0), busyMs(0), completedFiles(0), completedAudioSecs(0)
 {
     initUI();
+
+    // 吞吐量模型: 按 阶段+引擎+模型 学习本机实时率
+    throughputModel = new ThroughputModel(dataDir() + "/throughput_model.json");
+    etaRefreshTimer.start();
+
+    // 本机调优配置: Python 子进程通过 VSG_DATA_DIR 找到同一份 host_profile.json
+    qputenv("VSG_DATA_DIR", QDir::toNativeSeparators(dataDir()).toLocal8Bit());
+    hostProfile = new HostProfile(dataDir() + "/host_profile.json");
+    if (hostProfile->isLoaded()) {
+        log("已加载本机调优配置 (x264 preset: " + hostProfile->x264Preset() + ")");
+    }
+
+    // 媒体元数据索引: 入队时并发探测，结果按 路径+修改时间+大小 持久化
+    mediaIndex = new MediaProbeIndex(dataDir() + "/media_index.json", qBound(2, QThread::idealThreadCount(), 8), this);
+    connect(mediaIndex, &MediaProbeIndex::probed, this, &MainWindow::onMediaProbed);
+
+    // 文件夹扫描: 后台线程递归遍历，找到的文件分批入队
+    folderScanner = new FolderScanner(dataDir() + "/folder_scan.json", this);
+    connect(folderScanner, &FolderScanner::filesFound, this, &MainWindow::addVideosToQueue);
+    connect(folderScanner, &FolderScanner::progress, this, [this](int dirsScanned, int filesMatched) {
+        scanStatusLabel->setText(QString("正在扫描文件夹: 已扫描 %1 个目录，找到 %2 个文件").arg(dirsScanned).arg(filesMatched));
+    });
+    connect(folderScanner, &FolderScanner::finished, this, &MainWindow::onFolderScanFinished);
+    connect(cancelScanButton, &QPushButton::clicked, folderScanner, &FolderScanner::cancel);
+
+    // 监视文件夹: 目录变化时检查新文件，大小稳定且能探测出时长后按目录配置入队
+    folderWatcher = new FolderWatcher(dataDir() + "/watch_folders.json", this);
+    connect(folderWatcher, &FolderWatcher::logMessage, this, &MainWindow::log);
+    connect(folderWatcher, &FolderWatcher::fileReady, this, &MainWindow::onWatchedFileReady);
+    connect(watchFoldersCheckbox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (!checked) {
+            folderWatcher->stop();
+            log("已停止监视文件夹");
+            return;
+        }
+        if (!folderWatcher->start()) {
+            log("没有可监视的文件夹，请在配置文件中添加: " + QDir::toNativeSeparators(folderWatcher->configFile()));
+            QSignalBlocker blocker(watchFoldersCheckbox);
+            watchFoldersCheckbox->setChecked(false);
+        }
+    });
+
+    // 智能渲染: 只重新编码与字幕重叠的 GOP
+    smartRenderer = new SmartRenderer(this);
+    connect(smartRenderer, &SmartRenderer::logMessage, this, &MainWindow::log);
+    connect(smartRenderer, &SmartRenderer::progress, this, [this](double fraction) {
+        updateTaskProgress(StageEmbed, fraction);
+        statusLabel->setText(QString("步骤 3/3: 智能渲染 - %1%").arg(int(fraction * 100)));
+    });
+    connect(smartRenderer, &SmartRenderer::finished, this, &MainWindow::onSmartRenderFinished);
+
+    // 两级转写的后台精修: 低优先级逐个运行，完成后原子替换草稿
+    refinementQueue = new RefinementQueue("python", transcribeScriptPath(), this);
+    connect(refinementQueue, &RefinementQueue::logMessage, this, &MainWindow::log);
+    connect(refinementQueue, &RefinementQueue::jobFinished, this, &MainWindow::onRefinementFinished);
+
+    // 预启动常驻 Python 工作进程，转写时省去解释器启动、库导入和模型加载；
+    // 两级转写时至少两个进程，后台精修 (所选模型) 与主流程草稿 (tiny) 各自保留已加载的模型
+    workerPoolSize = WorkerFarm::loadPoolSize(dataDir() + "/worker_farm.json");
+    workerFarm = new WorkerFarm("python", QStringList() << transcribeScriptPath() << "--serve", workerPoolSize, this);
+    connect(workerFarm, &WorkerFarm::jobOutput, this, &MainWindow::onWorkerJobOutput);
+    connect(workerFarm, &WorkerFarm::jobFinished, this, &MainWindow::onWorkerJobFinished);
+    connect(workerFarm, &WorkerFarm::logMessage, this, &MainWindow::log);
+    connect(workerFarm, &WorkerFarm::workerReady, this, [this](qint64 latencyMs) {
+        log(QString("Python 工作进程就绪 (启动耗时 %1 ms, 平均 %2 ms)")
+            .arg(latencyMs).arg(workerFarm->averageSpawnLatencyMs(), 0, 'f', 0));
+    });
+    workerFarm->start();
+
+    // 资源调度: 主流程批次与后台精修启动前按估算的峰值内存和中间文件大小准入，常驻工作进程按实测内存计入
+    resourceGovernor = new ResourceGovernor(dataDir() + "/resource_budget.json", this);
+    connect(resourceGovernor, &ResourceGovernor::logMessage, this, &MainWindow::log);
+    connect(resourceGovernor, &ResourceGovernor::capacityAvailable, this, [this]() {
+        if (waitingForResources) processNextTask();
+    });
+    resourceGovernor->setResidentProcesses([this]() { return workerFarm->processIds(); });
+    refinementQueue->setGovernor(resourceGovernor);
+    refinementQueue->setWorkerFarm(workerFarm);
+
+    // 中间文件 (WAV、SRT、渲染用字幕) 放在本机临时目录，输出目录只写入最终产物和用户选择导出的文件
+    scratchSpace = new ScratchSpace(dataDir() + "/scratch.json", this);
+    connect(scratchSpace, &ScratchSpace::logMessage, this, &MainWindow::log);
+
+    // 任务协调器: 分发模式下把队列租给工作节点 (scripts/pipeline_worker.py)，心跳续约，过期或失败时重试
+    jobCoordinator = new JobCoordinator(dataDir() + "/coordinator.json", this);
+    connect(jobCoordinator, &JobCoordinator::logMessage, this, &MainWindow::log);
+    connect(jobCoordinator, &JobCoordinator::jobFinished, this, &MainWindow::onRemoteJobFinished);
+    connect(jobCoordinator, &JobCoordinator::jobStarted, this, [this](int taskId, const QString &worker, int attempt) {
+        if (const TaskInfo *task = taskStore->find(taskId)) {
+            log(QString("任务已分发到 %1 (第 %2 次): %3").arg(worker).arg(attempt).arg(task->inputPath));
+        }
+    });
+    connect(jobCoordinator, &JobCoordinator::jobProgress, this, [this](int taskId, const QString &stage, double fraction) {
+        if (const TaskInfo *task = taskStore->find(taskId)) {
+            statusLabel->setText(QString("工作节点: %1 - %2 %3%").arg(QFileInfo(task->inputPath).fileName(), stage)
+                                     .arg(int(fraction * 100)));
+        }
+    });
+    connect(jobCoordinator, &JobCoordinator::workersChanged, this, [this](int count) {
+        distributeCheckbox->setText(QString("分发到工作节点 (%1)").arg(count));
+    });
+    connect(distributeCheckbox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked) {
+            if (!jobCoordinator->start()) {
+                QSignalBlocker blocker(distributeCheckbox);
+                distributeCheckbox->setChecked(false);
+                return;
+            }
+            log("协调器已启动，工作节点运行: python scripts/pipeline_worker.py --connect " + jobCoordinator->address());
+            dispatchQueue.clear();
+            for (const TaskInfo &task : taskStore->all()) {
+                dispatchQueue.append(task.id);
+            }
+            dispatchToWorkers();
+            return;
+        }
+        // 停止分发: 未完成的任务回到本地队列
+        QList<int> unfinished = jobCoordinator->stop();
+        dispatchQueue.clear();
+        distributeCheckbox->setText("分发到工作节点");
+        for (int id : unfinished) {
+            if (TaskInfo *task = taskStore->find(id)) {
+                task->status = "Pending";
+                taskStore->notifyChanged(id);
+            }
+        }
+        log(QString("协调器已停止，%1 个未完成任务改为本地处理").arg(unfinished.size()));
+        if (currentBatch.isEmpty() && !taskStore->isEmpty()) {
+            processNextTask();
+        }
+    });
 }
 
 MainWindow::~MainWindow()
 {
-    // 析构时确保进程已清理
-    if (currentProcess) {
-        if (currentProcess->state() != QProcess::NotRunning) {
-            currentProcess->kill();
-            currentProcess->waitForFinished(1000);
-        }
+    // 析构时确保进程已清理 (只发送终止信号，不等待)
+    if (currentProcess && currentProcess->state() != QProcess::NotRunning) {
+        currentProcess->kill();
     }
+    delete throughputModel;
+    delete hostProfile;
 }
 
 /**
@@ -45,10 +188,19 @@ void MainWindow::closeEvent(QCloseEvent *event)
             // 提示用户还是直接杀掉？为了防止显存残留，直接强杀比较安全
             // 或者可以弹窗提示，但用户既然点了关闭，通常期望程序退出
             log("正在终止后台进程...");
-            currentProcess->kill(); // 强制杀死
-            currentProcess->waitForFinished(2000); // 等待最多2秒
+            currentProcess->kill(); // 强制杀死，不在 UI 线程等待
         }
     }
+    // 常驻工作进程可能持有模型显存，一并终止
+    workerFarm->shutdown();
+    folderScanner->cancel();
+    folderWatcher->stop();
+    jobCoordinator->stop();
+    smartRenderer->cancel();
+    if (refinementQueue->pendingCount() > 0) {
+        log(QString("放弃 %1 个后台精修，保留草稿").arg(refinementQueue->pendingCount()));
+    }
+    refinementQueue->shutdown();
     event->accept();
 }
 
@@ -70,10 +222,13 @@ void MainWindow::initUI()
     QGroupBox *configGroup = new QGroupBox("配置");
     QHBoxLayout *topLayout = new QHBoxLayout(configGroup);
     
-    addFilesButton = new QPushButton("添加视频");
+    addFilesButton = new QPushButton("添加文件");
     // addFilesButton->setIcon(QIcon::fromTheme("list-add"));
     connect(addFilesButton, &QPushButton::clicked, this, &MainWindow::addVideoFiles);
 
+    addFolderButton = new QPushButton("添加文件夹");
+    connect(addFolderButton, &QPushButton::clicked, this, &MainWindow::addFolder);
+
     // 引擎选择
     QLabel *engineLabel = new QLabel("引擎:");
     engineCombo = new QComboBox();
@@ -90,6 +245,15 @@ void MainWindow::initUI()
     modelCombo->addItem("Large (最准/10G显存)", "large");
     modelCombo->setCurrentIndex(2); // Default to Small for 2G GPU
 
+    // 两级转写: 先用 tiny 模型快速输出草稿，再在后台用所选模型精修并替换
+    QLabel *modeLabel = new QLabel("模式:");
+    transcribeModeCombo = new QComboBox();
+    transcribeModeCombo->addItem("标准", "standard");
+    transcribeModeCombo->addItem("两级: 草稿字幕", "draft");
+    transcribeModeCombo->addItem("两级: 草稿字幕+软字幕视频", "draft_video");
+    transcribeModeCombo->setToolTip("两级模式先用 Tiny 模型快速生成草稿 (可选先输出软字幕视频)，"
+                                    "再在后台以低优先级用所选模型重新转写，完成后替换草稿；所选模型为 Tiny 时等同标准模式");
+
     // 帮助按钮
     helpButton = new QPushButton("模型指南");
     connect(helpButton, &QPushButton::clicked, [this]() {
@@ -108,10 +272,13 @@ void MainWindow::initUI()
         bool isWhisper = (engineCombo->itemData(index).toString() == "whisper");
         modelCombo->setEnabled(isWhisper);
         helpButton->setEnabled(isWhisper);
+        batchTranscribeCheckbox->setEnabled(isWhisper);
+        transcribeModeCombo->setEnabled(isWhisper);
+    });
+    connect(transcribeModeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](int index) {
+        bool twoTier = transcribeModeCombo->itemData(index).toString() != "standard";
+        workerFarm->setPoolSize(twoTier ? qMax(workerPoolSize, 2) : workerPoolSize);
     });
-    // 初始化状态
-    modelCombo->setEnabled(false); // Default is Vosk
-    helpButton->setEnabled(false);
     
     outputDirEdit = new QLineEdit();
     outputDirEdit->setPlaceholderText("输出目录 (默认保存在原视频目录)");
@@ -128,16 +295,62 @@ void MainWindow::initUI()
     exportAudioCheckbox = new QCheckBox("导出音频文件");
     exportAudioCheckbox->setChecked(false); // 默认不打开
 
+    // 批量转写: 将多个短视频的音频打包进同一批次推理，一次模型加载处理多个文件
+    batchTranscribeCheckbox = new QCheckBox("批量转写");
+    batchTranscribeCheckbox->setChecked(false);
+    batchTranscribeCheckbox->setToolTip("Whisper 引擎下一次处理多个任务，适合大量短视频");
+
+    // 仅转写: 只生成字幕和文本稿，不合成视频 (播客、会议录音等)
+    transcriptOnlyCheckbox = new QCheckBox("仅转写");
+    transcriptOnlyCheckbox->setChecked(false);
+    transcriptOnlyCheckbox->setToolTip("新添加的视频只输出字幕 (SRT) 和文本稿 (TXT)，不合成视频；音频文件始终仅转写");
+
+    // 智能渲染: 无字幕的片段直接复制，对白稀疏的视频合成快得多
+    smartRenderCheckbox = new QCheckBox("智能渲染");
+    smartRenderCheckbox->setChecked(false);
+    smartRenderCheckbox->setToolTip("只重新编码出现字幕的片段 (按关键帧切分)，其余片段直接复制；仅支持 H.264 视频，不适用时自动完整渲染");
+
+    // 允许下载模型: 默认关闭，模型只从本地模型仓库加载 (不访问网络)
+    allowDownloadCheckbox = new QCheckBox("允许下载模型");
+    allowDownloadCheckbox->setChecked(false);
+    allowDownloadCheckbox->setToolTip("本地模型仓库中没有所选模型时联网下载并登记；关闭时需先运行 scripts/model_registry.py preload 预置模型");
+
+    // 监视文件夹: 持续把新写入的文件加入队列 (目录及其引擎/模型/输出目录在 watch_folders.json 中配置)
+    watchFoldersCheckbox = new QCheckBox("监视文件夹");
+    watchFoldersCheckbox->setChecked(false);
+    watchFoldersCheckbox->setToolTip("监视本机数据目录下 watch_folders.json 中配置的文件夹，新文件写入完成后自动入队");
+
+    // 分发到工作节点: 启动任务协调器，队列由连接的工作节点 (可在多台机器上) 共同处理
+    distributeCheckbox = new QCheckBox("分发到工作节点");
+    distributeCheckbox->setChecked(false);
+    distributeCheckbox->setToolTip("启动任务协调器 (地址见 coordinator.json)，由 scripts/pipeline_worker.py 工作节点领取任务；"
+                                   "输入和输出需位于各节点都能访问的共享存储");
+
+    // 初始化状态
+    modelCombo->setEnabled(false); // Default is Vosk
+    helpButton->setEnabled(false);
+    batchTranscribeCheckbox->setEnabled(false);
+    transcribeModeCombo->setEnabled(false);
+
     topLayout->addWidget(addFilesButton);
+    topLayout->addWidget(addFolderButton);
+    topLayout->addWidget(watchFoldersCheckbox);
+    topLayout->addWidget(distributeCheckbox);
     topLayout->addWidget(new QLabel("|"));
     topLayout->addWidget(engineLabel);
     topLayout->addWidget(engineCombo);
     topLayout->addWidget(modelLabel);
     topLayout->addWidget(modelCombo);
     topLayout->addWidget(helpButton);
+    topLayout->addWidget(modeLabel);
+    topLayout->addWidget(transcribeModeCombo);
     topLayout->addWidget(new QLabel("|"));
     topLayout->addWidget(exportSubtitleCheckbox); // 添加到界面
     topLayout->addWidget(exportAudioCheckbox);    // 添加到界面
+    topLayout->addWidget(batchTranscribeCheckbox);
+    topLayout->addWidget(transcriptOnlyCheckbox);
+    topLayout->addWidget(smartRenderCheckbox);
+    topLayout->addWidget(allowDownloadCheckbox);
     topLayout->addWidget(new QLabel("|"));
     topLayout->addWidget(outputDirEdit);
     topLayout->addWidget(selectOutputDirButton);
@@ -147,29 +360,56 @@ void MainWindow::initUI()
     QSplitter *splitter = new QSplitter(Qt::Horizontal);
     
     // 左侧：待处理列表 (支持拖拽)
-    QGroupBox *inputGroup = new QGroupBox("待处理队列 (支持拖拽视频文件到此处)");
+    QGroupBox *inputGroup = new QGroupBox("待处理队列 (支持拖拽视频/音频文件或文件夹到此处)");
     QVBoxLayout *inputLayout = new QVBoxLayout(inputGroup);
+    taskStore = new TaskStore(this);
+    taskStore->setGroupKey(&MainWindow::etaGroupKey);
     inputListWidget = new FileDropListWidget();
+    inputListWidget->setModel(taskStore);
     inputListWidget->setSelectionMode(QAbstractItemView::ExtendedSelection); // 支持多选
     // 右键菜单
     inputListWidget->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(inputListWidget, &QWidget::customContextMenuRequested, [this](const QPoint &pos) {
         QMenu menu(this);
+        QAction *priorityAction = menu.addAction("优先处理");
+        connect(priorityAction, &QAction::triggered, this, &MainWindow::prioritizeSelectedTasks);
+        QAction *pauseAction = menu.addAction("暂停");
+        connect(pauseAction, &QAction::triggered, this, [this]() { setSelectedTasksPaused(true); });
+        QAction *resumeAction = menu.addAction("继续");
+        connect(resumeAction, &QAction::triggered, this, [this]() { setSelectedTasksPaused(false); });
+        menu.addSeparator();
         QAction *delAction = menu.addAction("从队列移除");
         connect(delAction, &QAction::triggered, this, &MainWindow::removeSelectedTask);
         menu.exec(inputListWidget->mapToGlobal(pos));
     });
     // 连接拖拽信号
     connect(inputListWidget, &FileDropListWidget::filesDropped, this, &MainWindow::handleDroppedFiles);
+    connect(inputListWidget, &FileDropListWidget::foldersDropped, this, &MainWindow::handleDroppedFolders);
     
     inputLayout->addWidget(inputListWidget);
+
+    // 文件夹扫描状态 (仅扫描时显示)
+    QHBoxLayout *scanLayout = new QHBoxLayout();
+    scanStatusLabel = new QLabel();
+    scanStatusLabel->setStyleSheet("color: #666;");
+    cancelScanButton = new QPushButton("取消扫描");
+    scanLayout->addWidget(scanStatusLabel, 1);
+    scanLayout->addWidget(cancelScanButton);
+    inputLayout->addLayout(scanLayout);
+    scanStatusLabel->hide();
+    cancelScanButton->hide();
     splitter->addWidget(inputGroup);
 
     // 右侧：已完成列表 / 日志
     QGroupBox *outputGroup = new QGroupBox("处理结果");
     QVBoxLayout *outputLayout = new QVBoxLayout(outputGroup);
-    outputListWidget = new QListWidget();
-    outputLayout->addWidget(outputListWidget);
+    resultModel = new ResultListModel(this);
+    outputListView = new QListView();
+    outputListView->setModel(resultModel);
+    outputListView->setUniformItemSizes(true);
+    outputListView->setLayoutMode(QListView::Batched);
+    outputListView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    outputLayout->addWidget(outputListView);
     splitter->addWidget(outputGroup);
 
     // 设置分割比例
@@ -183,7 +423,7 @@ void MainWindow::initUI()
     QVBoxLayout *statusLayout = new QVBoxLayout(statusGroup);
     
     // 功能说明标签
-    QLabel *infoLabel = new QLabel("当前功能: 1. 音频提取(FFmpeg) -> 2. 语音转录(Whisper/Vosk) -> 3. 字幕合成(FFmpeg)");
+    QLabel *infoLabel = new QLabel("当前功能: 1. 音频提取(FFmpeg) -> 2. 语音转录(Whisper/Vosk) -> 3. 字幕合成(FFmpeg)；音频文件/仅转写: 直接转录为 SRT/TXT");
     infoLabel->setStyleSheet("color: #666; font-style: italic;");
     statusLayout->addWidget(infoLabel);
 
@@ -197,6 +437,11 @@ void MainWindow::initUI()
     // 状态文本
     statusLabel = new QLabel("就绪");
     statusLayout->addWidget(statusLabel);
+
+    // 剩余时间与吞吐量
+    etaLabel = new QLabel("剩余时间: --");
+    etaLabel->setStyleSheet("color: #666;");
+    statusLayout->addWidget(etaLabel);
     
     mainLayout->addWidget(statusGroup);
 
@@ -213,10 +458,52 @@ void MainWindow::initUI()
  */
 void MainWindow::addVideoFiles()
 {
-    QStringList fileNames = QFileDialog::getOpenFileNames(this, "选择视频文件", "", "视频文件 (*.mp4 *.avi *.mkv *.mov *.flv *.wmv)");
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, "选择视频或音频文件", "", MediaFormats::dialogFilter());
     addVideosToQueue(fileNames);
 }
 
+/**
+ * @brief 添加文件夹
+ */
+void MainWindow::addFolder()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, "选择要扫描的文件夹");
+    if (!dir.isEmpty()) {
+        handleDroppedFolders(QStringList() << dir);
+    }
+}
+
+/**
+ * @brief 处理拖拽添加的文件夹: 交给后台线程递归扫描，界面不等待
+ */
+void MainWindow::handleDroppedFolders(const QStringList &dirs)
+{
+    for (const QString &dir : dirs) {
+        log("开始扫描文件夹: " + dir);
+    }
+    scanStatusLabel->setText("正在扫描文件夹...");
+    scanStatusLabel->show();
+    cancelScanButton->show();
+    folderScanner->scan(dirs);
+}
+
+/**
+ * @brief 文件夹扫描结束
+ */
+void MainWindow::onFolderScanFinished(int filesMatched, bool cancelled)
+{
+    if (cancelled) {
+        log(QString("文件夹扫描已取消，已找到 %1 个文件").arg(filesMatched));
+    } else {
+        log(QString("文件夹扫描完成，共找到 %1 个文件").arg(filesMatched));
+    }
+    // 排队中的扫描会紧接着开始
+    if (!folderScanner->isRunning()) {
+        scanStatusLabel->hide();
+        cancelScanButton->hide();
+    }
+}
+
 /**
  * @brief 处理拖拽添加的文件
  */
@@ -228,37 +515,93 @@ void MainWindow::handleDroppedFiles(const QStringList &files)
 /**
  * @brief 添加视频到队列的内部逻辑
  */
-void MainWindow::addVideosToQueue(const QStringList &files)
+void MainWindow::addVideosToQueue(const QStringList &files, const QList<qint64> &sizes, const QList<qint64> &mtimes)
 {
     if (files.isEmpty()) return;
+    bool statsKnown = sizes.size() == files.size() && mtimes.size() == files.size();
 
-    int addedCount = 0;
-    for (const QString &fileName : files) {
-        // 检查是否已存在于队列中 (简单去重)
-        bool exists = false;
-        for (const auto &task : taskList) {
-            if (task.inputPath == fileName) {
-                exists = true;
-                break;
-            }
-        }
-        if (exists) continue;
+    QList<TaskInfo> newTasks;
+    newTasks.reserve(files.size());
+    QHash<QString, QPair<qint64, qint64>> fileStats;
+    for (int i = 0; i < files.size(); ++i) {
+        const QString &fileName = files[i];
+        // 已在队列中的文件由 TaskStore 按路径哈希去重
+        if (taskStore->containsPath(fileName)) continue;
 
         TaskInfo task;
         task.inputPath = fileName;
         task.outputDir = outputDirEdit->text();
         task.status = "Pending";
-        
-        taskList.append(task);
-        inputListWidget->addItem(fileName);
-        log("已添加任务: " + fileName);
-        addedCount++;
+        task.transcriptOnly = MediaFormats::isAudioFile(fileName) || transcriptOnlyCheckbox->isChecked();
+
+        // 命中索引时直接使用已知时长 (后台扫描的文件按扫描时的大小和修改时间核对，界面线程不再访问文件)
+        MediaInfo info;
+        bool hit = statsKnown ? mediaIndex->lookup(fileName, sizes[i], mtimes[i], &info)
+                              : mediaIndex->lookup(fileName, &info);
+        if (hit) {
+            task.durationSecs = info.durationSecs;
+        } else if (statsKnown) {
+            fileStats.insert(fileName, qMakePair(sizes[i], mtimes[i]));
+        }
+        newTasks.append(task);
+    }
+    enqueueTasks(newTasks, fileStats);
+}
+
+/**
+ * @brief 监视文件夹的新文件入队 (使用该目录的配置)
+ */
+void MainWindow::onWatchedFileReady(const QString &path, const FolderWatcher::Profile &profile, double durationSecs)
+{
+    if (taskStore->containsPath(path)) return;
+
+    TaskInfo task;
+    task.inputPath = path;
+    task.outputDir = profile.outputDir.isEmpty() ? outputDirEdit->text() : profile.outputDir;
+    task.status = "Pending";
+    task.transcriptOnly = MediaFormats::isAudioFile(path) || profile.transcriptOnly;
+    task.engine = profile.engine;
+    task.model = profile.model;
+    task.durationSecs = durationSecs;
+    enqueueTasks(QList<TaskInfo>() << task);
+}
+
+/**
+ * @brief 加入队列
+ */
+void MainWindow::enqueueTasks(const QList<TaskInfo> &newTasks, const QHash<QString, QPair<qint64, qint64>> &fileStats)
+{
+    // 一次性插入，视图只收到一次行插入通知
+    QList<int> addedIds = taskStore->append(newTasks);
+    for (int id : addedIds) {
+        const TaskInfo *task = taskStore->find(id);
+        // 未命中索引的异步探测 (不阻塞界面)
+        if (task->durationSecs <= 0) {
+            auto stats = fileStats.constFind(task->inputPath);
+            if (stats != fileStats.constEnd()) {
+                mediaIndex->probe(task->inputPath, stats->first, stats->second);
+            } else {
+                mediaIndex->probe(task->inputPath);
+            }
+        }
+        // 大量添加时只记录汇总，避免日志控件逐行刷新
+        if (addedIds.size() <= 20) {
+            log("已添加任务: " + task->inputPath);
+        }
+    }
+    int addedCount = addedIds.size();
+    if (addedCount > 20) {
+        log(QString("已添加 %1 个任务").arg(addedCount));
     }
     
     if (addedCount > 0) {
-        statusLabel->setText(QString("队列中: %1 个任务").arg(taskList.size()));
-        // 如果当前没有在处理，自动开始
-        if (!isProcessing) {
+        statusLabel->setText(QString("队列中: %1 个任务").arg(taskStore->count()));
+        updateEtaLabel(true);
+        // 分发模式下立即交给工作节点；否则如果当前没有在处理，自动开始
+        if (jobCoordinator->isRunning()) {
+            dispatchQueue.append(addedIds);
+            dispatchToWorkers();
+        } else if (!isProcessing) {
             processNextTask();
         }
     }
@@ -269,27 +612,117 @@ void MainWindow::addVideosToQueue(const QStringList &files)
  */
 void MainWindow::removeSelectedTask()
 {
-    QList<QListWidgetItem*> items = inputListWidget->selectedItems();
-    if (items.isEmpty()) return;
-
-    for (auto item : items) {
-        QString path = item->text();
-        // 从任务列表中移除
-        for (int i = 0; i < taskList.size(); ++i) {
-            if (taskList[i].inputPath == path) {
-                // 如果正在处理该任务，则不移除 (或者需要停止逻辑，这里简单处理: 正在处理的不移除)
-                if (isProcessing && i == 0) { // 假设第一个是正在处理的
-                     QMessageBox::warning(this, "无法移除", "该任务正在处理中，无法移除: " + QFileInfo(path).fileName());
-                     continue;
-                }
-                taskList.removeAt(i);
-                delete inputListWidget->takeItem(inputListWidget->row(item));
-                log("已移除任务: " + path);
-                break;
+    QModelIndexList rows = inputListWidget->selectionModel()->selectedRows();
+    if (rows.isEmpty()) return;
+
+    QList<int> ids;
+    QList<int> activeIds;
+    for (const QModelIndex &index : rows) {
+        int id = index.data(TaskStore::TaskIdRole).toInt();
+        QString path = index.data(TaskStore::InputPathRole).toString();
+        // 正在处理的任务需要终止子进程，确认后取消
+        if (isTaskActive(id)) {
+            activeIds.append(id);
+            continue;
+        }
+        if (rows.size() <= 20) {
+            log("已移除任务: " + path);
+        }
+        // 被抢占后回到队列的任务可能留有中间文件和转写检查点
+        const TaskInfo *task = taskStore->find(id);
+        if (!task->scratchDir.isEmpty()) {
+            scratchSpace->release(task->scratchDir);
+        }
+        QFile::remove(checkpointPath(*task));
+        ids.append(id);
+    }
+    if (ids.size() > 20) {
+        log(QString("已移除 %1 个任务").arg(ids.size()));
+    }
+    taskStore->remove(ids);
+
+    if (!activeIds.isEmpty()) {
+        QString question = activeIds.size() == 1
+            ? "该任务正在处理中，是否取消: " + QFileInfo(taskStore->find(activeIds.first())->inputPath).fileName() + "?"
+            : QString("%1 个任务正在处理中，是否取消?").arg(activeIds.size());
+        if (QMessageBox::question(this, "取消任务", question) == QMessageBox::Yes) {
+            for (int id : activeIds) {
+                cancelTask(id);
             }
         }
     }
-    statusLabel->setText(QString("队列中: %1 个任务").arg(taskList.size()));
+    statusLabel->setText(QString("队列中: %1 个任务").arg(taskStore->count()));
+}
+
+/**
+ * @brief 选中的任务优先处理
+ */
+void MainWindow::prioritizeSelectedTasks()
+{
+    QModelIndexList rows = inputListWidget->selectionModel()->selectedRows();
+    QList<int> ids;
+    for (const QModelIndex &index : rows) {
+        int id = index.data(TaskStore::TaskIdRole).toInt();
+        // 本地正在处理的任务无需调整 (协调器中尚未租出的任务仍可调整顺序)
+        if (isTaskActive(id) && !jobCoordinator->hasJob(id)) continue;
+        TaskInfo *task = taskStore->find(id);
+        task->priority = 1;
+        taskStore->notifyChanged(id);
+        ids.append(id);
+    }
+    if (ids.isEmpty()) return;
+
+    // 移到队首后前 ids.size() 行即这些任务 (保持原有顺序)；协调器逐个插到队首，倒序提交
+    taskStore->moveToFront(ids);
+    for (int row = ids.size() - 1; row >= 0; --row) {
+        jobCoordinator->prioritize(taskStore->at(row).id);
+    }
+    log(QString("优先处理 %1 个任务").arg(ids.size()));
+    requestPreemption();
+}
+
+/**
+ * @brief 暂停或继续选中的任务
+ */
+void MainWindow::setSelectedTasksPaused(bool paused)
+{
+    QModelIndexList rows = inputListWidget->selectionModel()->selectedRows();
+    bool activeSelected = false;
+    QList<int> released;
+    for (const QModelIndex &index : rows) {
+        int id = index.data(TaskStore::TaskIdRole).toInt();
+        if (isTaskActive(id)) {
+            activeSelected = true;
+            continue;
+        }
+        TaskInfo *task = taskStore->find(id);
+        if (task->held == paused) continue;
+        task->held = paused;
+        task->status = paused ? "Paused" : "Pending";
+        taskStore->notifyChanged(id);
+        if (!paused) released.append(id);
+    }
+
+    if (activeSelected) {
+        if (jobCoordinator->isRunning()) {
+            log("分发模式下不支持暂停已交给工作节点的任务");
+        } else if (setStagePaused(paused)) {
+            log(paused ? "已暂停当前处理" : "继续当前处理");
+        } else {
+            log(paused ? "当前阶段没有可暂停的进程" : "当前阶段没有已暂停的进程");
+        }
+    }
+
+    // 继续的任务重新参与调度 (之前可能因只剩暂停的任务而空闲)
+    if (!released.isEmpty()) {
+        if (jobCoordinator->isRunning()) {
+            dispatchQueue.append(released);
+            dispatchToWorkers();
+        } else if (!isProcessing) {
+            processNextTask();
+        }
+    }
+    updateEtaLabel(true);
 }
 
 /**
@@ -302,10 +735,11 @@ void MainWindow::selectOutputDir()
         outputDirEdit->setText(dir);
         log("输出目录设置为: " + dir);
         // 更新队列中尚未开始的任务的输出目录
-        for (int i = 0; i < taskList.size(); ++i) {
-             // 如果正在处理 (i==0 && isProcessing)，则不修改当前正在跑的任务
-             if (isProcessing && i == 0) continue;
-             taskList[i].outputDir = dir;
+        for (int row = 0; row < taskStore->count(); ++row) {
+             // 如果正在处理，则不修改当前批次中正在跑的任务
+             TaskInfo &task = taskStore->at(row);
+             if (isTaskActive(task.id)) continue;
+             task.outputDir = dir;
         }
     }
 }
@@ -325,205 +759,1131 @@ void MainWindow::log(const QString &message)
  */
 void MainWindow::processNextTask()
 {
-    if (taskList.isEmpty()) {
+    // 上一批次已结束 (或被终止)，释放其资源占用
+    if (batchLeaseId) {
+        resourceGovernor->release(batchLeaseId);
+        batchLeaseId = 0;
+    }
+    stagePaused = false;
+
+    // 已暂停的任务不参与调度
+    int firstRow = 0;
+    while (firstRow < taskStore->count() && taskStore->at(firstRow).held) {
+        firstRow++;
+    }
+
+    if (firstRow >= taskStore->count()) {
+        waitingForResources = false;
+        if (isProcessing) {
+            busyMs += sessionTimer.elapsed();
+        }
         isProcessing = false;
+        if (!taskStore->isEmpty()) {
+            statusLabel->setText(QString("队列中的 %1 个任务均已暂停").arg(taskStore->count()));
+            updateEtaLabel(true);
+            return;
+        }
         statusLabel->setText("所有任务完成");
-        QMessageBox::information(this, "完成", "所有视频处理完成!");
         progressBar->setValue(100);
+        updateEtaLabel(true);
+        // 监视文件夹时持续运行，不弹窗打断
+        if (!folderWatcher->isRunning()) {
+            QMessageBox::information(this, "完成", "所有视频处理完成!");
+        }
         return;
     }
 
+    if (!isProcessing) {
+        sessionTimer.start();
+    }
     isProcessing = true;
-    currentTask = taskList.first(); // 获取第一个但不移除，处理完再移除
-    
-    // 高亮当前正在处理的项
-    QList<QListWidgetItem*> items = inputListWidget->findItems(currentTask.inputPath, Qt::MatchExactly);
-    if (!items.isEmpty()) {
-        items.first()->setBackground(QColor("#e6f7ff")); // 浅蓝色背景
-        items.first()->setText(currentTask.inputPath + " (处理中...)");
+
+    // 分发模式: 待处理任务全部交给协调器，由工作节点执行
+    if (jobCoordinator->isRunning()) {
+        currentBatch.clear();
+        currentStage = StageNone;
+        dispatchToWorkers();
+        return;
+    }
+
+    // 组建本轮批次: 批量转写模式下一次取多个待处理任务，否则只取第一个
+    bool batchMode = batchTranscribeCheckbox->isChecked() && taskEngine(taskStore->at(firstRow)) == "whisper";
+    int batchLimit = batchMode ? kMaxBatchTasks : 1;
+
+    QList<int> rows;
+    double batchSecs = 0;
+    for (int row = firstRow; row < taskStore->count() && rows.size() < batchLimit; ++row) {
+        const TaskInfo &task = taskStore->at(row);
+        if (task.held) continue;
+        // 被抢占后继续的任务 (已有中间产物或检查点) 单独处理；优先任务不与普通任务合批
+        if (!rows.isEmpty()) {
+            const TaskInfo &head = taskStore->at(rows.first());
+            if (head.resumed() || task.resumed() || task.priority != head.priority) {
+                break;
+            }
+        }
+        // 批量只打包时长已知的短视频且总时长不超过上限，长视频或未探测完成的单独处理
+        if (!rows.isEmpty()
+            && (task.durationSecs <= 0 || batchSecs + task.durationSecs > kMaxBatchAudioSecs)) {
+            break;
+        }
+        // 同一批次共用一次模型加载，引擎和模型不同的任务 (来自不同监视文件夹) 不能合批
+        if (!rows.isEmpty() && (taskEngine(task) != taskEngine(taskStore->at(rows.first()))
+                                || taskModel(task) != taskModel(taskStore->at(rows.first())))) {
+            break;
+        }
+        batchSecs += task.durationSecs;
+        rows << row;
+    }
+
+    batchLeaseId = acquireBatchResources(rows);
+    if (!batchLeaseId) {
+        if (!waitingForResources) {
+            log("资源不足 (内存或磁盘空间)，等待后台任务释放资源...");
+            statusLabel->setText("等待资源: " + QFileInfo(taskStore->at(rows.first()).inputPath).fileName());
+        }
+        waitingForResources = true;
+        return;
     }
+    waitingForResources = false;
+    preemptRequested = false;
 
     log("==========================================");
-    log("开始处理: " + currentTask.inputPath);
-    progressBar->setValue(0);
-    
-    // 重置状态
-    currentStage = StageExtract;
-    totalDurationSecs = 0;
+    currentBatch.clear();
+    for (int row : rows) {
+        TaskInfo &task = taskStore->at(row);
+        prepareTask(task);
+        currentBatch.append(task);
+    }
+    batchIndex = 0;
 
-    // 准备路径
-    QFileInfo fileInfo(currentTask.inputPath);
-    QString baseName = fileInfo.completeBaseName();
-    QString sourceDir = fileInfo.absolutePath();
-    
-    // 确定输出目录
-    QString targetDir = currentTask.outputDir;
-    if (targetDir.isEmpty()) {
-        targetDir = sourceDir;
+    if (currentBatch.size() > 1) {
+        log(QString("批量转写: 本批次共 %1 个任务").arg(currentBatch.size()));
     }
+    startExtractStage();
+}
 
-    // 设置视频输出路径 (保持原样: [targetDir]/[BaseName]_subtitled.[ext])
-    currentTask.outputVideoPath = targetDir + "/" + baseName + "_subtitled." + fileInfo.suffix();
+/**
+ * @brief 把尚未分发的任务交给协调器
+ * 工作节点只做完整流程 (提取、转写、完整渲染)，两级转写和智能渲染仅在本地可用。
+ * 这里只计算导出位置，不创建目录、不删除旧产物: 文件由工作节点在完成时写入。
+ */
+void MainWindow::dispatchToWorkers()
+{
+    int dispatched = 0;
+    QList<int> queued;
+    queued.swap(dispatchQueue);
+    for (int id : queued) {
+        TaskInfo *task = taskStore->find(id);
+        // 已删除、已暂停 (继续时重新加入) 或已提交的任务不再处理
+        if (!task || task->held || jobCoordinator->hasJob(id)) continue;
+        // 本地正在处理的任务 (开启分发前已开始) 结束后若仍在队列中 (被抢占让出) 再分发
+        if (isTaskActive(id)) {
+            dispatchQueue.append(id);
+            continue;
+        }
 
-    // 确定额外输出目录 (Extra/output)
-    QString extraOutputDir = targetDir + "/Extra/"+baseName;
-    QDir extraDir(extraOutputDir);
-    if (!extraDir.exists()) {
-        if (!extraDir.mkpath(".")) {
-            log("错误: 无法创建额外输出目录: " + extraOutputDir);
-            // 如果创建失败，回退到 targetDir，或者直接报错停止？
-            // 这里回退到 targetDir 以防万一
-            extraOutputDir = targetDir;
+        // 中间文件由工作节点放在它自己的临时目录 (本地被抢占的任务在工作节点上从头处理)
+        if (!task->scratchDir.isEmpty()) {
+            scratchSpace->release(task->scratchDir);
+            task->scratchDir.clear();
         }
+        task->audioReady = false;
+        task->subtitleReady = false;
+        task->checkpointed = false;
+        task->refineModel.clear();
+        task->draftVideo = false;
+        assignExportPaths(*task);
+        task->status = "Processing";
+        taskStore->notifyChanged(id);
+
+        // 编码 preset 由工作节点按它自己的 host_profile.json 选择
+        QJsonObject spec;
+        spec["input"] = task->inputPath;
+        spec["outputVideo"] = task->outputVideoPath;
+        spec["subtitle"] = task->subtitlePath;
+        spec["transcript"] = task->transcriptPath;
+        spec["audio"] = task->audioPath;
+        spec["transcriptOnly"] = task->transcriptOnly;
+        spec["engine"] = taskEngine(*task);
+        spec["model"] = taskModel(*task);
+        spec["duration"] = task->durationSecs;
+        spec["keepAudio"] = exportAudioCheckbox->isChecked();
+        spec["keepSubtitle"] = exportSubtitleCheckbox->isChecked();
+        spec["allowDownload"] = allowDownloadCheckbox->isChecked();
+        jobCoordinator->submit(id, spec);
+        dispatched++;
     }
-
-    // 使用 Extra/output 目录存放中间文件和最终导出的文件
-    tempAudioPath = extraOutputDir + "/" + baseName + ".wav"; // 统一使用 wav 扩展名
-    outputSubtitlePath = extraOutputDir + "/" + baseName + ".srt";
-    
-    // 如果输出目录与源目录不同，确保输出目录存在
-    QDir dir(targetDir);
-    if (!dir.exists()) {
-        dir.mkpath(".");
+    if (dispatched > 0) {
+        if (!isProcessing) sessionTimer.start();
+        isProcessing = true;
+        statusLabel->setText(QString("已分发 %1 个任务，工作节点: %2").arg(dispatched).arg(jobCoordinator->workerCount()));
     }
+}
 
-    // 检查并删除旧文件
-    if (QFile::exists(tempAudioPath)) QFile::remove(tempAudioPath);
-    if (QFile::exists(outputSubtitlePath)) QFile::remove(outputSubtitlePath);
-    if (QFile::exists(currentTask.outputVideoPath)) QFile::remove(currentTask.outputVideoPath);
-
-    log("正在提取音频...");
-    statusLabel->setText("步骤 1/3: 提取音频 - " + baseName);
-    progressBar->setValue(5);
+/**
+ * @brief 工作节点任务结束
+ */
+void MainWindow::onRemoteJobFinished(int taskId, bool success, const QString &error)
+{
+    const TaskInfo *task = taskStore->find(taskId);
+    if (!task) return;
+    TaskInfo finished = *task;
+    if (!success) {
+        log("错误: 工作节点处理失败: " + finished.inputPath + " - " + error);
+    }
+    finishTask(finished, success, error);
+    if (taskStore->isEmpty()) {
+        processNextTask();
+    }
+}
 
-    // ffmpeg -i input.mp4 -ac 1 -ar 16000 -f wav temp_audio.wav
-    // 使用 nativeSeparators 确保路径分隔符正确 (虽然 Qt 通常能处理，但 FFmpeg 有时对中文路径敏感)
-    QString nativeInputPath = QDir::toNativeSeparators(currentTask.inputPath);
-    QString nativeTempAudioPath = QDir::toNativeSeparators(tempAudioPath);
+/**
+ * @brief 批次资源准入
+ * 各阶段顺序执行，峰值内存取 转写 (模型 + 整批音频) 与 硬字幕渲染 中的较大者；
+ * 模型由常驻工作进程加载时按进程实测内存计入，这里不重复估算。临时磁盘为整批的中间 WAV
+ * 加上最大一个智能渲染的中间片段 (智能渲染逐个进行)。
+ */
+int MainWindow::acquireBatchResources(QList<int> &rows)
+{
+    const TaskInfo &head = taskStore->at(rows.first());
+    QString engine = taskEngine(head);
+    QString model = transcribeModel(head, twoTierActive(head));
+    bool includeModel = !workerFarm->isAvailable();
+
+    while (!rows.isEmpty()) {
+        double audioSecs = 0;
+        qint64 wavBytes = 0;
+        qint64 smartBytes = 0; // 智能渲染逐个进行，只计最大的一个
+        bool renders = false;
+        for (int row : rows) {
+            const TaskInfo &task = taskStore->at(row);
+            audioSecs += task.durationSecs;
+            if (!task.transcriptOnly) {
+                wavBytes += ResourceGovernor::estimateWavBytes(task.durationSecs);
+                renders = true;
+                if (smartRenderCheckbox->isChecked() && !twoTierActive(task)) {
+                    smartBytes = qMax(smartBytes, SmartRenderer::estimateWorkBytes(QFileInfo(task.inputPath).size()));
+                }
+            }
+        }
+        qint64 diskBytes = wavBytes + smartBytes;
+        qint64 memory = ResourceGovernor::estimateTranscribeMemory(engine, model, audioSecs, includeModel);
+        if (renders) {
+            memory = qMax(memory, ResourceGovernor::estimateRenderMemory());
+        }
 
-    QStringList args;
-    args << "-y" << "-i" << nativeInputPath << "-ac" << "1" << "-ar" << "16000" << "-f" << "wav" << nativeTempAudioPath;
-    runCommand("ffmpeg", args);
+        const TaskInfo &first = taskStore->at(rows.first());
+        QString scratchDir = first.outputDir.isEmpty() ? QFileInfo(first.inputPath).absolutePath() : first.outputDir;
+        // 中间 WAV 和智能渲染片段放得进临时目录时不占输出目录的空间；临时目录在内存盘上时改为计入内存
+        if (!twoTierActive(head) && scratchSpace->fits(diskBytes)) {
+            if (scratchSpace->isMemoryBacked()) memory += diskBytes;
+            scratchDir = scratchSpace->path();
+        }
+        QString label = rows.size() > 1 ? QString("批次 (%1 个任务)").arg(rows.size()) : QFileInfo(first.inputPath).fileName();
+        int leaseId = resourceGovernor->tryAcquire(label, memory, diskBytes, scratchDir);
+        if (leaseId || rows.size() == 1) {
+            return leaseId;
+        }
+        rows.removeLast();
+    }
+    return 0;
 }
 
 /**
- * @brief 运行外部命令 (复用或创建进程)
+ * @brief 准备任务的输出路径
  */
-void MainWindow::runCommand(const QString &program, const QStringList &arguments, const QString &workDir)
+void MainWindow::prepareTask(TaskInfo &task)
 {
-    // 如果没有当前进程，或者当前进程正在被销毁，则创建新进程
-    if (!currentProcess) {
-        currentProcess = new QProcess(this);
-        connect(currentProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onProcessFinished(int, QProcess::ExitStatus)));
-        connect(currentProcess, &QProcess::readyReadStandardOutput, this, &MainWindow::onProcessReadyReadStandardOutput);
-        connect(currentProcess, &QProcess::readyReadStandardError, this, &MainWindow::onProcessReadyReadStandardError);
+    // 标记为处理中 (队列视图据此高亮)
+    log("开始处理: " + task.inputPath);
+    task.status = "Processing";
+    taskStore->notifyChanged(task.id);
+
+    // 被抢占后继续: 已完成阶段的产物和转写检查点仍在原位置 (临时目录不释放)，沿用之前的路径和模式
+    if (task.resumed()) {
+        return;
     }
-    
-    // 确保进程处于非运行状态
-    if (currentProcess->state() != QProcess::NotRunning) {
-        currentProcess->kill();
-        currentProcess->waitForFinished();
+
+    // 两级转写: 草稿用 tiny，记录精修模型 (容器不支持软字幕时草稿只有字幕)
+    task.refineModel = twoTierActive(task) ? taskModel(task) : QString();
+    task.draftVideo = !task.refineModel.isEmpty() && !task.transcriptOnly
+        && transcribeModeCombo->currentData().toString() == "draft_video"
+        && !MediaFormats::softSubtitleCodec(task.inputPath).isEmpty();
+
+    // 中间文件放在临时目录 (两级转写的草稿要保留到后台精修结束，仍放在输出目录)；
+    // 时长未知时无法估算 WAV 大小，不占用临时目录
+    if (!task.scratchDir.isEmpty()) {
+        scratchSpace->release(task.scratchDir);
+        task.scratchDir.clear();
+    }
+    if (task.refineModel.isEmpty() && (task.transcriptOnly || task.durationSecs > 0)) {
+        qint64 wavBytes = task.transcriptOnly ? 0 : ResourceGovernor::estimateWavBytes(task.durationSecs);
+        task.scratchDir = scratchSpace->allocate(wavBytes + kScratchTextBytes);
+    }
+
+    assignExportPaths(task);
+    QString targetDir = QFileInfo(task.transcriptOnly ? task.subtitlePath : task.outputVideoPath).absolutePath();
+    QDir().mkpath(targetDir);
+
+    // 仅转写: 源文件直接送入转写脚本解码，字幕和文本稿即最终产物，完成后移到输出目录
+    if (task.transcriptOnly) {
+        if (!task.scratchDir.isEmpty()) {
+            task.subtitlePath = task.scratchDir + "/subtitle.srt";
+            task.transcriptPath = task.scratchDir + "/transcript.txt";
+            return;
+        }
+        if (QFile::exists(task.subtitlePath)) QFile::remove(task.subtitlePath);
+        if (QFile::exists(task.transcriptPath)) QFile::remove(task.transcriptPath);
+        return;
     }
 
-    if (!workDir.isEmpty()) {
-        currentProcess->setWorkingDirectory(workDir);
+    // 渲染写入输出视频同目录的临时文件，完成后原子替换，旧的输出在此之前保持可用
+    if (!task.scratchDir.isEmpty()) {
+        task.audioPath = task.scratchDir + "/audio.wav";
+        task.subtitlePath = task.scratchDir + "/subtitle.srt";
+        return;
     }
-    
-    // 设置进程环境，强制 Python 不缓冲输出
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    env.insert("PYTHONUNBUFFERED", "1");
-    env.insert("PYTHONUTF8", "1"); // 强制 Python 使用 UTF-8 输出
-    currentProcess->setProcessEnvironment(env);
-    
-    log("执行命令: " + program + " " + arguments.join(" "));
-    currentProcess->start(program, arguments);
-    
-    if (!currentProcess->waitForStarted()) {
-        log("错误: 无法启动程序 " + program);
-        // 如果启动失败，手动触发失败回调 (Exit Code -1)
-        onProcessFinished(-1, QProcess::NormalExit);
+
+    // 临时目录不可用或放不下: 使用 Extra/output 目录存放中间文件和最终导出的文件
+    QString extraOutputDir = QFileInfo(task.subtitlePath).absolutePath();
+    if (!QDir().mkpath(extraOutputDir)) {
+        log("错误: 无法创建额外输出目录: " + extraOutputDir);
+        // 回退到输出目录
+        QString baseName = QFileInfo(task.inputPath).completeBaseName();
+        task.audioPath = targetDir + "/" + baseName + ".wav";
+        task.subtitlePath = targetDir + "/" + baseName + ".srt";
     }
+
+    // 检查并删除旧文件
+    if (QFile::exists(task.audioPath)) QFile::remove(task.audioPath);
+    if (QFile::exists(task.subtitlePath)) QFile::remove(task.subtitlePath);
 }
 
 /**
- * @brief 统一处理进程完成信号
+ * @brief 任务产物的最终导出位置
+ * 仅转写: [targetDir]/[BaseName].srt/.txt；视频: [targetDir]/[BaseName]_subtitled.[ext]，
+ * 导出的音频和字幕在 [targetDir]/Extra/[BaseName]/ 下 (统一使用 wav 扩展名)
  */
-void MainWindow::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void MainWindow::assignExportPaths(TaskInfo &task)
 {
-    // 根据当前阶段分发处理逻辑
-    if (currentStage == StageExtract) {
-        onExtractAudioFinished(exitCode);
-    } else if (currentStage == StageTranscribe) {
-        onTranscribeFinished(exitCode);
-    } else if (currentStage == StageEmbed) {
-        onEmbedSubtitleFinished(exitCode);
-    } else {
-        log("未知阶段的任务完成: " + QString::number(exitCode));
+    QFileInfo fileInfo(task.inputPath);
+    QString baseName = fileInfo.completeBaseName();
+    QString targetDir = task.outputDir.isEmpty() ? fileInfo.absolutePath() : task.outputDir;
+
+    if (task.transcriptOnly) {
+        task.outputVideoPath.clear();
+        task.audioPath = task.inputPath;
+        task.subtitlePath = targetDir + "/" + baseName + ".srt";
+        task.transcriptPath = targetDir + "/" + baseName + ".txt";
+        return;
     }
-    
-    // 注意：不再调用 deleteLater，因为我们要复用 currentProcess
-    // 只有在 closeEvent 时才销毁
+    QString extraOutputDir = targetDir + "/Extra/" + baseName;
+    task.outputVideoPath = targetDir + "/" + baseName + "_subtitled." + fileInfo.suffix();
+    task.audioPath = extraOutputDir + "/" + baseName + ".wav";
+    task.subtitlePath = extraOutputDir + "/" + baseName + ".srt";
+    task.transcriptPath.clear();
 }
 
 /**
- * @brief 统一处理标准输出
+ * @brief 临时目录中的产物移到最终位置 (跨文件系统时先复制为目标目录中的隐藏文件，再原子替换)
  */
-void MainWindow::onProcessReadyReadStandardOutput()
+bool MainWindow::promoteArtifacts(TaskInfo &task)
 {
-    QProcess *process = qobject_cast<QProcess*>(sender());
-    if (!process) return;
+    if (task.scratchDir.isEmpty()) return true;
 
-    // 循环读取所有可用行，确保不遗漏
-    while(process->canReadLine()) {
-        QString line = QString::fromUtf8(process->readLine()).trimmed();
-        if (line.isEmpty()) continue;
-        
-        // 检查下载进度: DOWNLOAD_PROGRESS: 45
-        if (line.contains("DOWNLOAD_PROGRESS:")) {
-            int idx = line.lastIndexOf("DOWNLOAD_PROGRESS:");
-            QString valStr = line.mid(idx + 18).trimmed();
-            bool ok;
-            int percent = valStr.toInt(&ok);
-            if (ok) {
-                statusLabel->setText(QString("正在下载模型: %1%").arg(percent));
-            }
+    TaskInfo exported = task;
+    assignExportPaths(exported);
+
+    QList<QPair<QString*, QString>> moves;
+    if (task.transcriptOnly) {
+        moves << qMakePair(&task.subtitlePath, exported.subtitlePath);
+        if (QFile::exists(task.transcriptPath)) {
+            moves << qMakePair(&task.transcriptPath, exported.transcriptPath);
         }
-        // 检查转录进度: TRANS_PROGRESS: 50
-        else if (line.contains("TRANS_PROGRESS:")) {
-            int idx = line.lastIndexOf("TRANS_PROGRESS:");
-            QString valStr = line.mid(idx + 15).trimmed();
-            bool ok;
-            int percent = valStr.toInt(&ok);
-            if (ok) {
-                // 映射到总进度 30-80
-                int totalPercent = 30 + (percent / 2); 
-                progressBar->setValue(totalPercent);
-                statusLabel->setText(QString("正在转录: %1%").arg(percent));
-            }
+    } else {
+        if (exportAudioCheckbox->isChecked()) {
+            moves << qMakePair(&task.audioPath, exported.audioPath);
+        }
+        if (exportSubtitleCheckbox->isChecked()) {
+            moves << qMakePair(&task.subtitlePath, exported.subtitlePath);
         }
-        // 其他重要信息直接显示
-        else {
-            // 只有当不是进度信息时才打印到日志，避免日志刷屏
-            log("Python: " + line);
+        if (!moves.isEmpty()) QDir().mkpath(QFileInfo(exported.subtitlePath).absolutePath());
+    }
+
+    bool ok = true;
+    for (const auto &move : moves) {
+        if (FileUtils::promoteFile(*move.first, move.second)) {
+            *move.first = move.second;
+        } else {
+            log("错误: 无法写入输出文件: " + move.second);
+            ok = false;
         }
     }
+    return ok;
 }
 
 /**
- * @brief 统一处理标准错误
+ * @brief 开始提取音频 (批次中的当前任务)
  */
-void MainWindow::onProcessReadyReadStandardError()
+void MainWindow::startExtractStage()
 {
-    QProcess *process = qobject_cast<QProcess*>(sender());
-    if (!process) return;
+    // 仅转写任务不需要提取音频，被抢占前已提取的任务不再重复
+    while (batchIndex < currentBatch.size()
+           && (currentBatch[batchIndex].transcriptOnly || currentBatch[batchIndex].audioReady)) {
+        batchIndex++;
+    }
+    if (batchIndex >= currentBatch.size()) {
+        startTranscribeStage();
+        return;
+    }
+    if (yieldIfPreempted()) return;
 
-    QByteArray data = process->readAllStandardError();
-    QString output = QString::fromUtf8(data);
-    
-    // 分割行，处理可能混合在一起的 \r (FFmpeg进度) 和 \n (普通日志)
-    // 简单替换 \r 为 \n 然后分割
-    QString cleanOutput = output;
-    cleanOutput.replace('\r', '\n');
+    currentTask = currentBatch[batchIndex];
+    currentStage = StageExtract;
+    totalDurationSecs = currentTask.durationSecs; // 未知时为 0，由 FFmpeg 输出解析
+    stageTimer.start();
+    stagePausedMs = 0;
+    updateTaskProgress(StageExtract, 0);
+
+    QString baseName = QFileInfo(currentTask.inputPath).completeBaseName();
+    log("正在提取音频...");
+    statusLabel->setText("步骤 1/3: 提取音频 - " + baseName);
+
+    // ffmpeg -i input.mp4 -ac 1 -ar 16000 -f wav temp_audio.wav
+    // 使用 nativeSeparators 确保路径分隔符正确 (虽然 Qt 通常能处理，但 FFmpeg 有时对中文路径敏感)
+    QString nativeInputPath = QDir::toNativeSeparators(currentTask.inputPath);
+    QString nativeTempAudioPath = QDir::toNativeSeparators(currentTask.audioPath);
+
+    QStringList args;
+    args << "-y" << "-i" << nativeInputPath << "-ac" << "1" << "-ar" << "16000" << "-f" << "wav" << nativeTempAudioPath;
+    runCommand("ffmpeg", args);
+}
+
+/**
+ * @brief 结束任务并从队列移除
+ */
+void MainWindow::finishTask(const TaskInfo &task, bool success, const QString &reason)
+{
+    bool cancelled = cancelledIds.remove(task.id);
+    if (cancelled) {
+        resultModel->addResult(task.inputPath + " -> 已取消", false);
+    } else if (success) {
+        // 两级转写且没有草稿视频时，最终视频由后台精修生成
+        bool hasVideo = !task.transcriptOnly && (task.refineModel.isEmpty() || task.draftVideo);
+        QString outputPath = hasVideo ? task.outputVideoPath : task.subtitlePath;
+        QString marker = task.refineModel.isEmpty() ? QString() : QString(" (草稿，后台精修中)");
+        resultModel->addResult(QFileInfo(task.inputPath).fileName() + " -> " + outputPath + marker, true);
+        completedFiles++;
+        completedAudioSecs += task.durationSecs;
+    } else {
+        resultModel->addResult(task.inputPath + " -> 失败 (" + reason + ")", false);
+    }
+
+    // 未导出的中间文件随临时目录删除；中间文件在 Extra 目录时只清理检查点和未完成的输出
+    if (!task.scratchDir.isEmpty()) {
+        scratchSpace->release(task.scratchDir);
+    } else {
+        QFile::remove(checkpointPath(task));
+    }
+    if (cancelled && !task.outputVideoPath.isEmpty()) {
+        QFile::remove(FileUtils::partialPath(task.outputVideoPath));
+    }
+
+    // 从任务队列 (及队列视图) 移除
+    taskStore->remove(task.id);
+}
+
+/**
+ * @brief 任务是否在当前批次中
+ */
+bool MainWindow::isTaskActive(int id) const
+{
+    if (jobCoordinator->hasJob(id)) return true;
+    if (!isProcessing) return false;
+    for (const TaskInfo &task : currentBatch) {
+        if (task.id == id) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 取消正在处理的任务
+ */
+void MainWindow::cancelTask(int id)
+{
+    const TaskInfo *stored = taskStore->find(id);
+    if (!stored) return;
+
+    // 分发模式: 收回租约 (工作节点收到 revoked 后终止)
+    if (jobCoordinator->hasJob(id)) {
+        jobCoordinator->cancel(id);
+        cancelledIds.insert(id);
+        log("已取消: " + stored->inputPath);
+        finishTask(*stored, false, "已取消");
+        return;
+    }
+
+    int index = -1;
+    for (int i = 0; isProcessing && i < currentBatch.size(); ++i) {
+        if (currentBatch[i].id == id) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) return;
+    // 合成阶段排在当前任务之前的已经完成
+    if (currentStage == StageEmbed && index < batchIndex) return;
+
+    cancelledIds.insert(id);
+    log("正在取消: " + stored->inputPath);
+
+    // 当前阶段正在处理该任务: 终止子进程，由阶段完成回调结束任务并继续
+    bool running = currentStage == StageTranscribe ? currentBatch.size() == 1 : index == batchIndex;
+    if (running) {
+        stopStageProcess();
+        return;
+    }
+    // 批量转写无法只终止其中一个文件，本阶段结束后丢弃其结果
+    if (currentStage == StageTranscribe) {
+        log("批量转写进行中，该任务在转写结束后丢弃");
+        return;
+    }
+    // 尚未轮到 (或已提取、等待转写) 的任务直接移出批次
+    TaskInfo task = currentBatch.takeAt(index);
+    if (index < batchIndex) batchIndex--;
+    finishTask(task, false, "已取消");
+}
+
+/**
+ * @brief 终止当前阶段的子进程
+ * 挂起的进程同样可以直接终止。常驻工作进程中排队的任务立即回调，其余由子进程的 finished 信号回调。
+ */
+void MainWindow::stopStageProcess()
+{
+    if (currentJobId >= 0) {
+        // 常驻进程需要继续运行才能读到取消请求
+        if (stagePaused) ProcessControl::resume(stageProcessId());
+        stagePaused = false;
+        workerFarm->cancel(currentJobId);
+        return;
+    }
+    if (smartRenderer->isRunning()) {
+        // 智能渲染取消时不发出 finished，按失败排队回调
+        stagePaused = false;
+        smartRenderer->cancel();
+        releaseSmartScratch();
+        QMetaObject::invokeMethod(this, [this]() { onEmbedSubtitleFinished(-1); }, Qt::QueuedConnection);
+        return;
+    }
+    stagePaused = false;
+    if (currentProcess && currentProcess->state() != QProcess::NotRunning) {
+        currentProcess->kill();
+    }
+}
+
+qint64 MainWindow::stageProcessId() const
+{
+    if (currentJobId >= 0) return workerFarm->processIdForJob(currentJobId);
+    if (smartRenderer->isRunning()) return smartRenderer->processId();
+    if (currentProcess && currentProcess->state() == QProcess::Running) return currentProcess->processId();
+    return 0;
+}
+
+/**
+ * @brief 挂起或恢复当前阶段的子进程
+ * 挂起的进程保留内存和显存，只是不再占用 CPU/GPU 时间；批次中的任务一起显示为已暂停。
+ */
+bool MainWindow::setStagePaused(bool paused)
+{
+    if (paused == stagePaused) return true;
+    qint64 pid = stageProcessId();
+    if (pid <= 0) return false;
+    if (!(paused ? ProcessControl::suspend(pid) : ProcessControl::resume(pid))) {
+        return false;
+    }
+
+    stagePaused = paused;
+    if (paused) {
+        pauseTimer.start();
+    } else {
+        stagePausedMs += pauseTimer.elapsed();
+    }
+    for (const TaskInfo &task : currentBatch) {
+        if (TaskInfo *stored = taskStore->find(task.id)) {
+            stored->status = paused ? "Paused" : "Processing";
+            taskStore->notifyChanged(task.id);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 请求抢占当前批次
+ */
+void MainWindow::requestPreemption()
+{
+    if (!isProcessing || currentBatch.isEmpty() || jobCoordinator->isRunning()) return;
+    for (const TaskInfo &task : currentBatch) {
+        if (task.priority > 0) return; // 当前批次本身就是优先任务
+    }
+
+    // 挂起的阶段到达不了让出点，先恢复
+    setStagePaused(false);
+    preemptRequested = true;
+    // 单个任务的转写可以在检查点处中断 (再次轮到时从中断处继续)；批量转写和 FFmpeg 阶段不可续做，等待阶段结束
+    if (currentStage == StageTranscribe && currentBatch.size() == 1) {
+        log("优先任务等待中: 中断当前转写，已转写的部分保存在检查点");
+        preempting = true;
+        stopStageProcess();
+        return;
+    }
+    log("优先任务等待中: 当前阶段结束后让出");
+}
+
+bool MainWindow::yieldIfPreempted()
+{
+    if (!preemptRequested) return false;
+    requeueBatch();
+    return true;
+}
+
+/**
+ * @brief 让出当前批次
+ * 批次中尚未完成的任务带着中间产物的路径和完成标记回到队列原位置，优先任务已在队首。
+ */
+void MainWindow::requeueBatch()
+{
+    int requeued = 0;
+    for (const TaskInfo &task : currentBatch) {
+        TaskInfo *stored = taskStore->find(task.id);
+        if (!stored) continue; // 已完成
+        int priority = stored->priority;
+        bool held = stored->held;
+        *stored = task;
+        stored->priority = priority;
+        stored->held = held;
+        stored->status = held ? "Paused" : "Pending";
+        taskStore->notifyChanged(task.id);
+        requeued++;
+    }
+    log(QString("让出 %1 个任务给优先任务，之后从已完成的阶段继续").arg(requeued));
+
+    preemptRequested = false;
+    preempting = false;
+    currentBatch.clear();
+    currentStage = StageNone;
+    processNextTask();
+}
+
+QString MainWindow::checkpointPath(const TaskInfo &task)
+{
+    return task.subtitlePath.isEmpty() ? QString() : task.subtitlePath + ".checkpoint";
+}
+
+qint64 MainWindow::stageElapsedMs() const
+{
+    qint64 pausedMs = stagePausedMs + (stagePaused ? pauseTimer.elapsed() : 0);
+    return qMax<qint64>(0, stageTimer.elapsed() - pausedMs);
+}
+
+/**
+ * @brief 把秒数格式化为 h:mm:ss
+ */
+static QString formatEta(double secs)
+{
+    if (secs < 0) return "--:--";
+    qint64 total = qint64(secs + 0.5);
+    return QString("%1:%2:%3").arg(total / 3600)
+        .arg((total / 60) % 60, 2, 10, QChar('0'))
+        .arg(total % 60, 2, 10, QChar('0'));
+}
+
+/**
+ * @brief 任务需要经过的阶段
+ */
+QList<MainWindow::TaskStage> MainWindow::taskStages(const TaskInfo &task) const
+{
+    if (task.transcriptOnly) {
+        return QList<TaskStage>() << StageTranscribe;
+    }
+    if (!task.refineModel.isEmpty() && !task.draftVideo) {
+        return QList<TaskStage>() << StageExtract << StageTranscribe;
+    }
+    return QList<TaskStage>() << StageExtract << StageTranscribe << StageEmbed;
+}
+
+/**
+ * @brief 按吞吐量模型估算阶段耗时
+ */
+double MainWindow::estimateStageSecs(const TaskInfo &task, TaskStage stage, double mediaSecs) const
+{
+    if (stage == StageExtract) return throughputModel->estimateSecs("extract", QString(), QString(), mediaSecs);
+
+    // 已开始的任务按 prepareTask 确定的模式，尚未开始的按其引擎/模型配置和当前选项
+    bool prepared = !task.subtitlePath.isEmpty();
+    bool twoTier = prepared ? !task.refineModel.isEmpty() : twoTierActive(task);
+    if (stage == StageEmbed) {
+        // 智能渲染的实时率与字幕密度有关，单独统计
+        bool draftVideo = prepared ? task.draftVideo
+                                   : twoTier && transcribeModeCombo->currentData().toString() == "draft_video";
+        QString mode = draftVideo ? QString("softsub") : smartRenderCheckbox->isChecked() ? QString("smart") : QString();
+        return throughputModel->estimateSecs("embed", mode, QString(), mediaSecs);
+    }
+    if (stage == StageTranscribe) {
+        // 与 recordStageTiming 使用相同的键
+        QString engine = taskEngine(task);
+        QString model = (engine == "whisper") ? transcribeModel(task, twoTier) : QString();
+        return throughputModel->estimateSecs("transcribe", engine, model, mediaSecs);
+    }
+    return 0;
+}
+
+/**
+ * @brief 把阶段实测耗时计入吞吐量模型
+ */
+void MainWindow::recordStageTiming(TaskStage stage, double mediaSecs)
+{
+    // 从检查点继续的转写只覆盖部分音频，不计入
+    if (mediaSecs <= 0 || (stage == StageTranscribe && stageResumed)) return;
+    double elapsedSecs = stageElapsedMs() / 1000.0;
+    if (stage == StageExtract) {
+        throughputModel->record("extract", QString(), QString(), mediaSecs, elapsedSecs);
+    } else if (stage == StageEmbed) {
+        throughputModel->record("embed", embedMode, QString(), mediaSecs, elapsedSecs);
+    } else if (stage == StageTranscribe) {
+        QString engine = taskEngine(currentTask);
+        QString model = (engine == "whisper") ? transcribeModel(currentTask, !currentTask.refineModel.isEmpty()) : QString();
+        throughputModel->record("transcribe", engine, model, mediaSecs, elapsedSecs);
+    }
+}
+
+/**
+ * @brief 当前选项下是否使用两级转写
+ */
+bool MainWindow::twoTierActive(const TaskInfo &task) const
+{
+    return taskEngine(task) == "whisper"
+        && transcribeModeCombo->currentData().toString() != "standard"
+        && taskModel(task) != "tiny";
+}
+
+/**
+ * @brief 转写阶段实际使用的模型
+ */
+QString MainWindow::transcribeModel(const TaskInfo &task, bool twoTier) const
+{
+    return twoTier ? QString("tiny") : taskModel(task);
+}
+
+/**
+ * @brief 任务的转写引擎 (监视文件夹配置优先)
+ */
+QString MainWindow::taskEngine(const TaskInfo &task) const
+{
+    return task.engine.isEmpty() ? engineCombo->currentData().toString() : task.engine;
+}
+
+/**
+ * @brief 任务的 Whisper 模型 (监视文件夹配置优先)
+ */
+QString MainWindow::taskModel(const TaskInfo &task) const
+{
+    return task.model.isEmpty() ? modelCombo->currentData().toString() : task.model;
+}
+
+/**
+ * @brief 估算任务剩余时间
+ */
+double MainWindow::remainingTaskSecs(const TaskInfo &task) const
+{
+    if (task.durationSecs <= 0) return -1;
+
+    bool isCurrent = isProcessing && task.id == currentTask.id;
+    // 批次中的其他任务: 提取/合成阶段按批次顺序逐个执行，排在当前任务之后的还要经过当前阶段
+    int position = -1;
+    for (int i = 0; isProcessing && i < currentBatch.size(); ++i) {
+        if (currentBatch[i].id == task.id) {
+            position = i;
+            break;
+        }
+    }
+
+    double remaining = 0;
+    for (TaskStage stage : taskStages(task)) {
+        double estimate = estimateStageSecs(task, stage, task.durationSecs);
+        if (position < 0 || stage > currentStage) {
+            remaining += estimate;
+        } else if (stage == currentStage) {
+            if (isCurrent) {
+                // 进度足够时按本阶段实际速度外推，否则用模型估计
+                double elapsed = stageElapsedMs() / 1000.0;
+                if (stageFraction >= 0.05) {
+                    remaining += elapsed * (1.0 - stageFraction) / stageFraction;
+                } else {
+                    remaining += qMax(0.0, estimate - elapsed);
+                }
+            } else if (currentStage != StageTranscribe && position > batchIndex) {
+                remaining += estimate;
+            }
+        }
+    }
+    return remaining;
+}
+
+/**
+ * @brief 按各阶段预计耗时加权更新进度条
+ */
+void MainWindow::updateTaskProgress(TaskStage stage, double fraction)
+{
+    stageFraction = qBound(0.0, fraction, 1.0);
+
+    // 时长未知时权重只取决于各阶段实时率之比，用任意时长计算即可
+    double mediaSecs = currentTask.durationSecs > 0 ? currentTask.durationSecs : 60.0;
+    double total = 0, done = 0;
+    for (TaskStage s : taskStages(currentTask)) {
+        double estimate = estimateStageSecs(currentTask, s, mediaSecs);
+        if (s < stage) {
+            done += estimate;
+        } else if (s == stage) {
+            done += estimate * stageFraction;
+        }
+        total += estimate;
+    }
+    progressBar->setValue(total > 0 ? int(done * 100 / total) : 0);
+    updateEtaLabel();
+}
+
+/**
+ * @brief 剩余时间的分组键: 决定各阶段实时率的字段 (见 estimateStageSecs、taskStages)
+ * 正在处理的任务 (包括已分发给工作节点的) 不计入排队汇总。
+ */
+QString MainWindow::etaGroupKey(const TaskInfo &task)
+{
+    if (task.status == "Processing" || (task.status == "Paused" && !task.held)) return QString();
+    return QStringList{task.engine, task.model, task.transcriptOnly ? "transcript" : "",
+                       task.subtitlePath.isEmpty() ? "" : "prepared", task.refineModel,
+                       task.draftVideo ? "draft" : ""}.join('|');
+}
+
+/**
+ * @brief 刷新剩余时间与吞吐量
+ */
+void MainWindow::updateEtaLabel(bool force)
+{
+    if (!force && etaRefreshTimer.elapsed() < 500) return;
+    etaRefreshTimer.restart();
+
+    // 排队的任务按分组汇总估算 (各阶段耗时与时长成正比，同组任务可以合并计算)，
+    // 正在处理的批次逐个按进度估算；刷新耗时与队列长度无关
+    const QHash<QString, TaskStore::GroupTotal> &groups = taskStore->groupTotals();
+    QList<TaskInfo> active;
+    for (const TaskInfo &task : currentBatch) {
+        if (isProcessing && taskStore->find(task.id)) active.append(task);
+    }
+
+    // 时长未知的任务按已知任务的平均时长估计
+    double knownSecs = 0;
+    int knownCount = 0;
+    for (const TaskStore::GroupTotal &group : groups) {
+        knownSecs += qMax(0.0, group.knownSecs);
+        knownCount += group.knownCount;
+    }
+    for (const TaskInfo &task : active) {
+        if (task.durationSecs > 0) {
+            knownSecs += task.durationSecs;
+            knownCount++;
+        }
+    }
+
+    double queueSecs = 0;
+    bool complete = true;
+    for (const TaskStore::GroupTotal &group : groups) {
+        TaskInfo estimate = group.sample;
+        if (group.knownCount > 0) {
+            estimate.durationSecs = qMax(0.0, group.knownSecs);
+            queueSecs += qMax(0.0, remainingTaskSecs(estimate));
+        }
+        if (group.unknownCount > 0) {
+            if (knownCount == 0) {
+                complete = false;
+                continue;
+            }
+            estimate.durationSecs = knownSecs / knownCount * group.unknownCount;
+            queueSecs += remainingTaskSecs(estimate);
+        }
+    }
+    for (const TaskInfo &task : active) {
+        double remaining = remainingTaskSecs(task);
+        if (remaining < 0) {
+            if (knownCount == 0) {
+                complete = false;
+                continue;
+            }
+            TaskInfo estimate = task;
+            estimate.durationSecs = knownSecs / knownCount;
+            remaining = remainingTaskSecs(estimate);
+        }
+        queueSecs += remaining;
+    }
+
+    QString text;
+    if (isProcessing) {
+        text += "当前任务剩余: " + formatEta(remainingTaskSecs(currentTask)) + " | ";
+    }
+    text += QString("队列剩余: %1%2 (%3 个任务)")
+        .arg(formatEta(queueSecs), complete ? QString() : QString("+")).arg(taskStore->count());
+
+    double busyHours = (busyMs + (isProcessing ? sessionTimer.elapsed() : 0)) / 3600000.0;
+    if (completedFiles > 0 && busyHours > 0) {
+        text += QString(" | 吞吐: %1 文件/小时, %2 音频小时/小时")
+            .arg(completedFiles / busyHours, 0, 'f', 1)
+            .arg(completedAudioSecs / 3600.0 / busyHours, 0, 'f', 2);
+    }
+    etaLabel->setText(text);
+}
+
+/**
+ * @brief 本机数据目录
+ */
+QString MainWindow::dataDir() const
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(dir);
+    return dir;
+}
+
+/**
+ * @brief 媒体信息探测完成，回填任务时长
+ */
+void MainWindow::onMediaProbed(const QString &path, const MediaInfo &info)
+{
+    if (!info.valid) {
+        log("警告: 无法读取媒体信息: " + path);
+        return;
+    }
+    if (info.audioStreams == 0) {
+        log("警告: 未检测到音频流: " + path);
+    }
+
+    int id = taskStore->idForPath(path);
+    if (TaskInfo *task = taskStore->find(id)) {
+        task->durationSecs = info.durationSecs;
+        taskStore->notifyChanged(id); // 更新剩余时间的分组汇总
+    }
+    for (TaskInfo &task : currentBatch) {
+        if (task.id == id) task.durationSecs = info.durationSecs;
+    }
+    if (id >= 0 && currentTask.id == id) {
+        currentTask.durationSecs = info.durationSecs;
+        if (totalDurationSecs <= 0.1 && (currentStage == StageExtract || currentStage == StageEmbed)) {
+            totalDurationSecs = info.durationSecs;
+        }
+    }
+
+    if (mediaIndex->pendingCount() == 0) {
+        log("媒体信息分析完成");
+    }
+}
+
+/**
+ * @brief 定位 transcribe.py
+ */
+QString MainWindow::transcribeScriptPath() const
+{
+    // 获取当前可执行文件目录的上级目录中的 scripts/transcribe.py
+    QString appDir = QCoreApplication::applicationDirPath();
+    // 假设结构是 build/Debug/VideoSubtitleGenerator.exe -> scripts 在 build/../scripts
+    // 或者直接在 src/../scripts
+    // 我们多试几个路径
+    QString scriptPath = appDir + "/../scripts/transcribe.py";
+    if (!QFile::exists(scriptPath)) {
+        scriptPath = appDir + "/scripts/transcribe.py";
+    }
+    if (!QFile::exists(scriptPath)) {
+        // 尝试源码目录 (假设 d:/myfiles/code/wavToTxt)
+        scriptPath = "d:/myfiles/code/wavToTxt/scripts/transcribe.py";
+    }
+    return scriptPath;
+}
+
+/**
+ * @brief 运行外部命令 (复用或创建进程)
+ */
+void MainWindow::runCommand(const QString &program, const QStringList &arguments, const QString &workDir)
+{
+    // 上一个进程仍在运行时，断开信号后异步终止，由其 finished 信号回收，不在 UI 线程等待
+    if (currentProcess && currentProcess->state() != QProcess::NotRunning) {
+        QProcess *oldProcess = currentProcess;
+        oldProcess->disconnect(this);
+        connect(oldProcess, &QProcess::finished, oldProcess, &QObject::deleteLater);
+        oldProcess->kill();
+        currentProcess = nullptr;
+    }
+
+    // 如果没有当前进程，则创建新进程
+    if (!currentProcess) {
+        currentProcess = new QProcess(this);
+        connect(currentProcess, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onProcessFinished(int, QProcess::ExitStatus)));
+        connect(currentProcess, &QProcess::readyReadStandardOutput, this, &MainWindow::onProcessReadyReadStandardOutput);
+        connect(currentProcess, &QProcess::readyReadStandardError, this, &MainWindow::onProcessReadyReadStandardError);
+        connect(currentProcess, &QProcess::started, this, &MainWindow::onProcessStarted);
+        // 启动失败可能在 start() 内同步发出，排队处理避免重入
+        connect(currentProcess, &QProcess::errorOccurred, this, &MainWindow::onProcessErrorOccurred, Qt::QueuedConnection);
+    }
+
+    if (batchLeaseId) {
+        resourceGovernor->attachProcess(batchLeaseId, currentProcess);
+    }
+    currentProcess->setWorkingDirectory(workDir);
+    
+    // 设置进程环境，强制 Python 不缓冲输出
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("PYTHONUNBUFFERED", "1");
+    env.insert("PYTHONUTF8", "1"); // 强制 Python 使用 UTF-8 输出
+    currentProcess->setProcessEnvironment(env);
+    
+    log("执行命令: " + program + " " + arguments.join(" "));
+    processStartTimer.start();
+    currentProcess->start(program, arguments);
+}
+
+/**
+ * @brief 子进程已启动
+ */
+void MainWindow::onProcessStarted()
+{
+    qint64 latencyMs = processStartTimer.elapsed();
+    totalSpawnLatencyMs += latencyMs;
+    spawnCount++;
+    log(QString("进程已启动 (启动耗时 %1 ms, 平均 %2 ms)")
+        .arg(latencyMs).arg(double(totalSpawnLatencyMs) / spawnCount, 0, 'f', 1));
+}
+
+/**
+ * @brief 子进程启动失败
+ */
+void MainWindow::onProcessErrorOccurred(QProcess::ProcessError error)
+{
+    // 其他错误 (崩溃等) 会伴随 finished 信号，由 onProcessFinished 处理
+    if (error != QProcess::FailedToStart) return;
+    if (sender() != currentProcess) return;
+
+    log("错误: 无法启动程序 " + currentProcess->program());
+    // 启动失败不会触发 finished，手动触发失败回调 (Exit Code -1)
+    onProcessFinished(-1, QProcess::NormalExit);
+}
+
+/**
+ * @brief 工作进程池任务输出
+ */
+void MainWindow::onWorkerJobOutput(int jobId, const QString &line)
+{
+    if (jobId != currentJobId) return;
+    handleScriptOutputLine(line);
+}
+
+/**
+ * @brief 工作进程池任务完成
+ */
+void MainWindow::onWorkerJobFinished(int jobId, int exitCode)
+{
+    if (jobId != currentJobId) return;
+    currentJobId = -1;
+    if (currentStage == StageTranscribe) {
+        onTranscribeFinished(exitCode);
+    }
+}
+
+/**
+ * @brief 统一处理进程完成信号
+ */
+void MainWindow::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    // 被终止 (取消或抢占) 的进程退出码不可靠，按失败处理
+    if (exitStatus == QProcess::CrashExit && exitCode == 0) {
+        exitCode = -1;
+    }
+
+    // 根据当前阶段分发处理逻辑
+    if (currentStage == StageExtract) {
+        onExtractAudioFinished(exitCode);
+    } else if (currentStage == StageTranscribe) {
+        onTranscribeFinished(exitCode);
+    } else if (currentStage == StageEmbed) {
+        onEmbedSubtitleFinished(exitCode);
+    } else {
+        log("未知阶段的任务完成: " + QString::number(exitCode));
+    }
+    
+    // 注意：不再调用 deleteLater，因为我们要复用 currentProcess
+    // 只有在 closeEvent 时才销毁
+}
+
+/**
+ * @brief 统一处理标准输出
+ */
+void MainWindow::onProcessReadyReadStandardOutput()
+{
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process) return;
+
+    // 循环读取所有可用行，确保不遗漏
+    while(process->canReadLine()) {
+        QString line = QString::fromUtf8(process->readLine()).trimmed();
+        if (line.isEmpty()) continue;
+        handleScriptOutputLine(line);
+    }
+}
+
+/**
+ * @brief 处理转写脚本的一行输出
+ */
+void MainWindow::handleScriptOutputLine(const QString &line)
+{
+    // 检查下载进度: DOWNLOAD_PROGRESS: 45
+    if (line.contains("DOWNLOAD_PROGRESS:")) {
+        int idx = line.lastIndexOf("DOWNLOAD_PROGRESS:");
+        QString valStr = line.mid(idx + 18).trimmed();
+        bool ok;
+        int percent = valStr.toInt(&ok);
+        if (ok) {
+            statusLabel->setText(QString("正在下载模型: %1%").arg(percent));
+        }
+    }
+    // 检查转录进度: TRANS_PROGRESS: 50
+    else if (line.contains("TRANS_PROGRESS:")) {
+        int idx = line.lastIndexOf("TRANS_PROGRESS:");
+        QString valStr = line.mid(idx + 15).trimmed();
+        bool ok;
+        int percent = valStr.toInt(&ok);
+        if (ok) {
+            updateTaskProgress(StageTranscribe, percent / 100.0);
+            statusLabel->setText(QString("正在转录: %1%").arg(percent));
+        }
+    }
+    // 其他重要信息直接显示
+    else {
+        // 只有当不是进度信息时才打印到日志，避免日志刷屏
+        log("Python: " + line);
+    }
+}
+
+/**
+ * @brief 统一处理标准错误
+ */
+void MainWindow::onProcessReadyReadStandardError()
+{
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process) return;
+
+    QByteArray data = process->readAllStandardError();
+    QString output = QString::fromUtf8(data);
+    
+    // 分割行，处理可能混合在一起的 \r (FFmpeg进度) 和 \n (普通日志)
+    // 简单替换 \r 为 \n 然后分割
+    QString cleanOutput = output;
+    cleanOutput.replace('\r', '\n');
     QStringList lines = cleanOutput.split('\n', Qt::SkipEmptyParts);
 
     for (const QString &line : lines) {
@@ -564,18 +1924,11 @@ void MainWindow::onProcessReadyReadStandardError()
                     if (percent > 100) percent = 100;
                     if (percent < 0) percent = 0;
                     
-                    // 根据阶段更新进度条
+                    // 根据阶段更新进度条 (按各阶段预计耗时加权)
+                    updateTaskProgress(currentStage, percent / 100.0);
                     if (currentStage == StageExtract) {
-                        // 0-30%
-                        int val = (int)(percent * 0.3);
-                        if (val > 30) val = 30;
-                        progressBar->setValue(val);
                         statusLabel->setText(QString("步骤 1/3: 提取音频 - %1%").arg(percent));
                     } else if (currentStage == StageEmbed) {
-                        // 80-100%
-                        int val = 80 + (int)(percent * 0.2);
-                        if (val > 100) val = 100;
-                        progressBar->setValue(val);
                         statusLabel->setText(QString("步骤 3/3: 合成字幕 - %1%").arg(percent));
                     }
                 }
@@ -604,49 +1957,128 @@ void MainWindow::onExtractAudioFinished(int exitCode)
 {
     // 不再这里销毁 process
     
-    if (exitCode != 0) {
+    if (cancelledIds.contains(currentTask.id)) {
+        log("已取消: " + currentTask.inputPath);
+        if (currentTask.scratchDir.isEmpty()) QFile::remove(currentTask.audioPath);
+        finishTask(currentTask, false, "已取消");
+        currentBatch.removeAt(batchIndex);
+    } else if (exitCode != 0) {
         log("错误: 音频提取失败");
-        // 标记失败
-        QListWidgetItem *item = new QListWidgetItem(currentTask.inputPath + " -> 失败 (音频提取)");
-        item->setForeground(Qt::red); // 红色字体
-        outputListWidget->addItem(item);
-        
-        // 从输入列表移除
-        if (!taskList.isEmpty()) taskList.removeFirst();
-        QList<QListWidgetItem*> items = inputListWidget->findItems(currentTask.inputPath + " (处理中...)", Qt::MatchExactly);
-        if (!items.isEmpty()) delete inputListWidget->takeItem(inputListWidget->row(items.first()));
-        
+        // 标记失败并从批次中移除
+        finishTask(currentTask, false, "音频提取");
+        currentBatch.removeAt(batchIndex);
+    } else {
+        recordStageTiming(StageExtract, currentTask.durationSecs);
+        currentBatch[batchIndex].audioReady = true;
+        batchIndex++;
+    }
+
+    // 批次中还有未提取的任务
+    if (batchIndex < currentBatch.size()) {
+        startExtractStage();
+        return;
+    }
+    if (currentBatch.isEmpty()) {
         processNextTask();
         return;
     }
 
-    log("音频提取完成，开始转录...");
-    statusLabel->setText("步骤 2/3: 语音转写 - " + QFileInfo(currentTask.inputPath).baseName());
-    progressBar->setValue(30);
-    
+    startTranscribeStage();
+}
+
+/**
+ * @brief 开始语音转写 (整批执行)
+ */
+void MainWindow::startTranscribeStage()
+{
+    if (yieldIfPreempted()) return;
+    // 被抢占前已完成转写 (批次中只有这一个任务)
+    if (currentBatch.first().subtitleReady) {
+        batchIndex = 0;
+        startEmbedStage();
+        return;
+    }
+
+    currentTask = currentBatch.first();
     currentStage = StageTranscribe;
+    stageTimer.start();
+    stagePausedMs = 0;
+    stageResumed = currentBatch.size() == 1 && QFile::exists(checkpointPath(currentTask));
+    updateTaskProgress(StageTranscribe, 0);
+
+    QString engine = taskEngine(currentTask);
+    bool twoTier = !currentTask.refineModel.isEmpty();
+    QString model = transcribeModel(currentTask, twoTier);
+    if (twoTier) {
+        log("两级转写: 先用 tiny 模型生成草稿，之后在后台用 " + currentTask.refineModel + " 模型精修");
+    }
+    // 主流程转写期间暂缓启动后台精修，避免与其争用 GPU
+    refinementQueue->setHeld(true);
 
     // python transcribe.py input.wav output.srt
-    // 获取当前可执行文件目录的上级目录中的 scripts/transcribe.py
-    QString appDir = QCoreApplication::applicationDirPath();
-    // 假设结构是 build/Debug/VideoSubtitleGenerator.exe -> scripts 在 build/../scripts
-    // 或者直接在 src/../scripts
-    // 我们多试几个路径
-    QString scriptPath = appDir + "/../scripts/transcribe.py";
-    if (!QFile::exists(scriptPath)) {
-        scriptPath = appDir + "/scripts/transcribe.py";
+    QStringList args;
+    if (currentBatch.size() == 1) {
+        QString baseName = QFileInfo(currentTask.inputPath).baseName();
+        if (currentTask.transcriptOnly) {
+            log("开始转录 (直接解码源文件)...");
+            statusLabel->setText("步骤 1/1: 语音转写 - " + baseName);
+        } else {
+            log("音频提取完成，开始转录...");
+            statusLabel->setText("步骤 2/3: 语音转写 - " + baseName);
+        }
+        args << currentTask.audioPath << currentTask.subtitlePath;
+        if (currentTask.transcriptOnly) {
+            args << "--txt" << currentTask.transcriptPath;
+        }
+        if (currentTask.durationSecs > 0) {
+            args << "--duration" << QString::number(currentTask.durationSecs, 'f', 2);
+        }
+        // 逐段写入检查点: 被抢占或中断后再次转写时从最后一段之后继续
+        args << "--checkpoint" << checkpointPath(currentTask);
+        if (stageResumed) {
+            log("从检查点继续转写: " + checkpointPath(currentTask));
+        }
+    } else {
+        // 批量模式: 把整批音频写入任务清单，由 Python 在一次模型加载内打包推理
+        QJsonArray jobs;
+        for (const TaskInfo &task : currentBatch) {
+            QJsonObject job;
+            job["input"] = task.audioPath;
+            job["output"] = task.subtitlePath;
+            if (task.transcriptOnly) {
+                job["txt"] = task.transcriptPath;
+            }
+            jobs.append(job);
+        }
+        // 唯一文件名，放在本进程的临时目录 (不可用时为系统临时目录)，多个实例互不覆盖；转写结束时删除
+        QString jobsDir = scratchSpace->isAvailable() ? scratchSpace->path() : QDir::tempPath();
+        QTemporaryFile jobsFile(jobsDir + "/vsg_batch_jobs_XXXXXX.json");
+        jobsFile.setAutoRemove(false);
+        if (!jobsFile.open()) {
+            log("错误: 无法写入批量任务清单: " + jobsFile.fileTemplate());
+            onTranscribeFinished(-1);
+            return;
+        }
+        batchJobsPath = jobsFile.fileName();
+        jobsFile.write(QJsonDocument(jobs).toJson());
+        jobsFile.close();
+
+        log(QString("开始批量转录 %1 个文件...").arg(currentBatch.size()));
+        statusLabel->setText(QString("步骤 2/3: 批量语音转写 - %1 个文件").arg(currentBatch.size()));
+        args << "--batch" << batchJobsPath;
     }
-    if (!QFile::exists(scriptPath)) {
-        // 尝试源码目录 (假设 d:/myfiles/code/wavToTxt)
-        scriptPath = "d:/myfiles/code/wavToTxt/scripts/transcribe.py";
+    args << "--engine" << engine << "--model" << model;
+    if (allowDownloadCheckbox->isChecked()) {
+        args << "--allow-download";
     }
-    
-    QString engine = engineCombo->currentData().toString();
-    QString model = modelCombo->currentData().toString();
 
-    QStringList args;
-    args << scriptPath << tempAudioPath << outputSubtitlePath << "--engine" << engine << "--model" << model;
-    runCommand("python", args);
+    // 优先交给常驻工作进程 (模型已加载时无需重复加载)，不可用时回退为一次性进程
+    if (workerFarm->isAvailable()) {
+        log("提交转写任务到工作进程: " + args.join(" "));
+        currentJobId = workerFarm->submit(args);
+    } else {
+        runCommand("python", QStringList() << transcribeScriptPath() << args);
+    }
 }
 
 /**
@@ -660,58 +2092,251 @@ void MainWindow::onTranscribeFinished(int exitCode)
         log("Python 错误输出: " + errorOutput);
     }
 
-    if (exitCode != 0) {
-        log("错误: 语音转写失败 (Exit Code: " + QString::number(exitCode) + ")");
-        QListWidgetItem *item = new QListWidgetItem(currentTask.inputPath + " -> 失败 (转写错误)");
-        item->setForeground(Qt::red);
-        outputListWidget->addItem(item);
-
-        if (!taskList.isEmpty()) taskList.removeFirst();
-        QList<QListWidgetItem*> items = inputListWidget->findItems(currentTask.inputPath + " (处理中...)", Qt::MatchExactly);
-        if (!items.isEmpty()) delete inputListWidget->takeItem(inputListWidget->row(items.first()));
+    if (!batchJobsPath.isEmpty()) {
+        QFile::remove(batchJobsPath);
+        batchJobsPath.clear();
+    }
+    refinementQueue->setHeld(false);
+
+    // 为优先任务中断的转写: 检查点保留，任务回到队列 (取消优先于让出；已正常结束时照常继续)
+    bool yielding = preempting && exitCode != 0 && !cancelledIds.contains(currentTask.id);
+    preempting = false;
+    if (yielding) {
+        // 仅转写任务没有提取阶段，检查点是它唯一的中间产物
+        currentBatch.first().checkpointed = true;
+        requeueBatch();
+        return;
+    }
 
+    if (exitCode != 0) {
+        if (currentBatch.size() == 1 && cancelledIds.contains(currentTask.id)) {
+            log("已取消: " + currentTask.inputPath);
+        } else {
+            log("错误: 语音转写失败 (Exit Code: " + QString::number(exitCode) + ")");
+        }
+        for (const TaskInfo &task : currentBatch) {
+            finishTask(task, false, "转写错误");
+        }
+        currentBatch.clear();
         processNextTask();
         return;
     }
 
-    // 准备硬字幕合成
-    QString targetDir = QFileInfo(currentTask.outputVideoPath).absolutePath();
-    QString tempSrtName = "temp_render_subs.srt";
-    QString tempSrtPath = targetDir + "/" + tempSrtName;
+    // 整批转写耗时按整批时长计入 (任一时长未知则不计)
+    double batchSecs = 0;
+    for (const TaskInfo &task : currentBatch) {
+        if (task.durationSecs <= 0) {
+            batchSecs = 0;
+            break;
+        }
+        batchSecs += task.durationSecs;
+    }
+    recordStageTiming(StageTranscribe, batchSecs);
 
     // 检查字幕文件是否存在且不为空
-    QFileInfo srtInfo(outputSubtitlePath);
-    if (!srtInfo.exists() || srtInfo.size() == 0) {
-        // 如果文件不存在或为空，可能是Python脚本虽然exit(0)但没有生成有效内容
-        // 或者确实是静音文件
-        log("错误: 字幕文件无效 (未检测到语音或生成失败): " + outputSubtitlePath);
-        
-        QListWidgetItem *item = new QListWidgetItem(currentTask.inputPath + " -> 失败 (字幕无效)");
-        item->setForeground(Qt::red);
-        outputListWidget->addItem(item);
+    for (int i = 0; i < currentBatch.size(); ) {
+        // 批量转写期间取消的任务，丢弃其结果
+        if (cancelledIds.contains(currentBatch[i].id)) {
+            log("已取消: " + currentBatch[i].inputPath);
+            finishTask(currentBatch[i], false, "已取消");
+            currentBatch.removeAt(i);
+            continue;
+        }
+        QFileInfo srtInfo(currentBatch[i].subtitlePath);
+        if (!srtInfo.exists() || srtInfo.size() == 0) {
+            // 如果文件不存在或为空，可能是Python脚本虽然exit(0)但没有生成有效内容
+            // 或者确实是静音文件
+            log("错误: 字幕文件无效 (未检测到语音或生成失败): " + currentBatch[i].subtitlePath);
+            finishTask(currentBatch[i], false, "字幕无效");
+            currentBatch.removeAt(i);
+            continue;
+        }
+        currentBatch[i].subtitleReady = true;
+        ++i;
+    }
+    if (currentBatch.isEmpty()) {
+        processNextTask();
+        return;
+    }
 
-        if (!taskList.isEmpty()) taskList.removeFirst();
-        QList<QListWidgetItem*> items = inputListWidget->findItems(currentTask.inputPath + " (处理中...)", Qt::MatchExactly);
-        if (!items.isEmpty()) delete inputListWidget->takeItem(inputListWidget->row(items.first()));
+    log("语音转写完成");
+    batchIndex = 0;
+    startEmbedStage();
+}
 
+/**
+ * @brief 开始合成字幕 (批次中的当前任务)
+ */
+void MainWindow::startEmbedStage()
+{
+    // 仅转写任务没有合成阶段，转写完成即结束；两级转写且不输出草稿视频的任务由后台精修合成
+    while (batchIndex < currentBatch.size()
+           && (currentBatch[batchIndex].transcriptOnly
+               || (!currentBatch[batchIndex].refineModel.isEmpty() && !currentBatch[batchIndex].draftVideo))) {
+        TaskInfo &task = currentBatch[batchIndex];
+        if (!promoteArtifacts(task)) {
+            finishTask(task, false, "写入输出");
+            batchIndex++;
+            continue;
+        }
+        QString outputs = task.subtitlePath;
+        if (QFile::exists(task.transcriptPath)) outputs += ", " + task.transcriptPath;
+        log((task.refineModel.isEmpty() ? "转写完成! 输出文件: " : "草稿转写完成! 输出文件: ") + outputs);
+        progressBar->setValue(100);
+        finishTask(task, true);
+        if (!task.refineModel.isEmpty()) {
+            enqueueRefinement(task);
+        }
+        batchIndex++;
+    }
+    if (batchIndex >= currentBatch.size()) {
+        currentBatch.clear();
         processNextTask();
         return;
     }
+    if (yieldIfPreempted()) return;
+
+    currentTask = currentBatch[batchIndex];
+    currentStage = StageEmbed;
+    totalDurationSecs = currentTask.durationSecs; // 未知时为 0，重新从 FFmpeg 输出获取时长
+    stageTimer.start();
+    stagePausedMs = 0;
+    updateTaskProgress(StageEmbed, 0);
+
+    if (currentTask.draftVideo) {
+        startSoftSubtitleMux();
+        return;
+    }
+
+    // 智能渲染只适用于 H.264 源 (已知编码时提前排除，未知时由 SmartRenderer 自行判断)
+    if (smartRenderCheckbox->isChecked()) {
+        MediaInfo info;
+        bool known = mediaIndex->lookup(currentTask.inputPath, &info);
+        if (!known || info.videoCodec == "h264") {
+            log("开始合成视频(智能渲染)...");
+            statusLabel->setText("步骤 3/3: 智能渲染 - " + QFileInfo(currentTask.inputPath).baseName());
+            embedMode = "smart";
+            // 中间文件约为源文件大小: 临时目录放得下时按配额占用，否则写在输出目录所在的文件系统
+            qint64 workBytes = SmartRenderer::estimateWorkBytes(QFileInfo(currentTask.inputPath).size());
+            smartScratchDir = scratchSpace->allocate(workBytes);
+            QString workParent = smartScratchDir.isEmpty() ? QFileInfo(currentTask.outputVideoPath).absolutePath() : smartScratchDir;
+            smartRenderer->start(currentTask.inputPath, currentTask.subtitlePath,
+                                 FileUtils::partialPath(currentTask.outputVideoPath), videoEncodeArgs(), workParent);
+            return;
+        }
+        log("源视频编码为 " + info.videoCodec + "，智能渲染仅支持 H.264，使用完整渲染");
+    }
+    startFullRender();
+}
+
+/**
+ * @brief 草稿软字幕视频 (当前任务)
+ */
+void MainWindow::startSoftSubtitleMux()
+{
+    log("开始合成草稿视频(软字幕)...");
+    statusLabel->setText("步骤 3/3: 合成草稿视频(软字幕) - " + QFileInfo(currentTask.inputPath).baseName());
+    embedMode = "softsub";
 
-    // 复制 SRT
-    if (QFile::exists(tempSrtPath)) QFile::remove(tempSrtPath);
-    if (!QFile::copy(outputSubtitlePath, tempSrtPath)) {
-        log("错误: 无法复制字幕文件到渲染目录: " + tempSrtPath);
+    // 只复制音视频流并封装字幕流，耗时与文件读写相当；硬字幕视频由后台精修生成后替换
+    QStringList args;
+    args << "-y" << "-i" << QDir::toNativeSeparators(currentTask.inputPath)
+         << "-i" << QDir::toNativeSeparators(currentTask.subtitlePath)
+         << "-map" << "0:v:0" << "-map" << "0:a:0?" << "-map" << "1:0"
+         << "-c" << "copy" << "-c:s" << MediaFormats::softSubtitleCodec(currentTask.outputVideoPath)
+         << "-metadata:s:s:0" << "language=chi"
+         << QDir::toNativeSeparators(FileUtils::partialPath(currentTask.outputVideoPath));
+    runCommand("ffmpeg", args);
+}
+
+/**
+ * @brief 加入后台精修队列
+ */
+void MainWindow::enqueueRefinement(const TaskInfo &task)
+{
+    RefinementJob job;
+    job.inputPath = task.inputPath;
+    job.audioPath = task.audioPath;
+    job.subtitlePath = task.subtitlePath;
+    job.transcriptPath = task.transcriptPath;
+    job.outputVideoPath = task.outputVideoPath;
+    job.model = task.refineModel;
+    job.encodeArgs = videoEncodeArgs();
+    job.durationSecs = task.durationSecs;
+    job.keepAudio = exportAudioCheckbox->isChecked();
+    job.keepSubtitle = exportSubtitleCheckbox->isChecked();
+    job.allowDownload = allowDownloadCheckbox->isChecked();
+    refinementQueue->enqueue(job);
+}
+
+/**
+ * @brief 后台精修结束
+ */
+void MainWindow::onRefinementFinished(const QString &inputPath, const QString &outputPath, bool success)
+{
+    if (success) {
+        log("后台精修完成: " + outputPath);
+        resultModel->addResult(QFileInfo(inputPath).fileName() + " -> " + outputPath + " (已精修)", true);
+    } else {
+        resultModel->addResult(inputPath + " -> 精修失败 (保留草稿)", false);
     }
-    // 重要: copy 之后，源文件仍被占用吗？通常不会，但为了安全起见，这里不操作源文件
+}
 
+/**
+ * @brief 硬字幕合成的视频编码参数
+ */
+QStringList MainWindow::videoEncodeArgs() const
+{
+    return QStringList() << "-c:v" << "libx264" << "-preset" << hostProfile->x264Preset();
+}
+
+/**
+ * @brief 智能渲染结束
+ */
+void MainWindow::onSmartRenderFinished(bool success, const QString &reason)
+{
+    releaseSmartScratch();
+    if (currentStage != StageEmbed) return;
+    if (success) {
+        onEmbedSubtitleFinished(0);
+        return;
+    }
+    log("智能渲染未完成 (" + reason + ")，改为完整渲染");
+    stageTimer.start();
+    stagePausedMs = 0;
+    updateTaskProgress(StageEmbed, 0);
+    startFullRender();
+}
+
+void MainWindow::releaseSmartScratch()
+{
+    if (smartScratchDir.isEmpty()) return;
+    scratchSpace->release(smartScratchDir);
+    smartScratchDir.clear();
+}
+
+/**
+ * @brief 完整渲染 (当前任务)
+ */
+void MainWindow::startFullRender()
+{
+    log("开始合成视频(硬字幕)...");
+    embedMode.clear();
+
+    // 准备硬字幕合成: 在字幕所在目录 (临时目录，或回退时的 Extra 目录) 运行，输出目录不出现临时字幕
+    QString renderDir = QFileInfo(currentTask.subtitlePath).absolutePath();
+    QString tempSrtName = "subtitle.srt";
+    if (currentTask.scratchDir.isEmpty()) {
+        // 导出的字幕文件名来自源文件，可能含有滤镜需要转义的字符，复制为固定文件名
+        tempSrtName = "temp_render_subs.srt";
+        QString tempSrtPath = renderDir + "/" + tempSrtName;
+        if (QFile::exists(tempSrtPath)) QFile::remove(tempSrtPath);
+        if (!QFile::copy(currentTask.subtitlePath, tempSrtPath)) {
+            log("错误: 无法复制字幕文件到渲染目录: " + tempSrtPath);
+        }
+    }
 
-    log("语音转写完成，开始合成视频(硬字幕)...");
     statusLabel->setText("步骤 3/3: 合成字幕(硬字幕) - " + QFileInfo(currentTask.inputPath).baseName());
-    progressBar->setValue(80);
-    
-    currentStage = StageEmbed;
-    totalDurationSecs = 0; // 重置，重新从 FFmpeg 输出获取时长
 
     // ffmpeg -i input.mp4 -vf subtitles='subs.srt' -c:v libx264 -preset fast -c:a copy output.mp4
     // 注意: subtitles 滤镜路径问题比较麻烦，使用相对路径最稳妥
@@ -720,21 +2345,21 @@ void MainWindow::onTranscribeFinished(int exitCode)
     // 1. 路径分隔符必须是 / 或 \\\\ (转义)
     // 2. 盘符冒号需要转义，例如 D\:/path/to/file
     // 3. 但如果使用相对路径且在同一目录下运行，通常可以避免这些问题。
-    // 我们这里采用相对路径 temp_render_subs.srt，并且设置工作目录为 outputVideoPath 所在目录
+    // 我们这里采用相对路径的固定文件名，并且设置工作目录为字幕所在目录
     
     // 确保路径分隔符正确 (Windows下 ffmpeg 有时偏好 /)
     QString nativeInputPath = QDir::toNativeSeparators(currentTask.inputPath);
-    QString nativeOutputVideoPath = QDir::toNativeSeparators(currentTask.outputVideoPath);
+    QString nativeOutputVideoPath = QDir::toNativeSeparators(FileUtils::partialPath(currentTask.outputVideoPath));
 
     // 对于 subtitles 滤镜中的文件名，FFmpeg 需要特殊的转义
-    // 但因为我们已经在 targetDir 下运行，且文件名为简单的 temp_render_subs.srt，不含特殊字符，直接用文件名即可
+    // 但因为我们已经在 renderDir 下运行，且文件名不含特殊字符，直接用文件名即可
     
     QStringList args;
     args << "-y" << "-i" << nativeInputPath << "-vf" << QString("subtitles='%1'").arg(tempSrtName) 
-         << "-c:v" << "libx264" << "-preset" << "fast" << "-c:a" << "copy" << nativeOutputVideoPath;
+         << videoEncodeArgs() << "-c:a" << "copy" << nativeOutputVideoPath;
     
-    // 传递工作目录 targetDir
-    runCommand("ffmpeg", args, targetDir);
+    // 传递工作目录 renderDir
+    runCommand("ffmpeg", args, renderDir);
 }
 
 /**
@@ -744,52 +2369,69 @@ void MainWindow::onEmbedSubtitleFinished(int exitCode)
 {
     // 不再销毁进程，以便复用
 
-
-    if (exitCode != 0) {
-        log("错误: 视频合成失败");
-        QListWidgetItem *item = new QListWidgetItem(currentTask.inputPath + " -> 失败 (合成错误)");
-        item->setForeground(Qt::red);
-        outputListWidget->addItem(item);
+    // 渲染输出为同目录的临时文件，成功后原子替换为最终文件名
+    bool cancelled = cancelledIds.contains(currentTask.id);
+    bool success = (exitCode == 0) && !cancelled;
+    QString partialVideoPath = FileUtils::partialPath(currentTask.outputVideoPath);
+    if (success && !FileUtils::replaceFile(partialVideoPath, currentTask.outputVideoPath)) {
+        log("错误: 无法写入输出文件: " + currentTask.outputVideoPath);
+        success = false;
+    }
+    if (!success) {
+        QFile::remove(partialVideoPath);
+        log(cancelled ? "已取消: " + currentTask.inputPath : QString("错误: 视频合成失败"));
     } else {
-        log("任务完成! 输出文件: " + currentTask.outputVideoPath);
-        QListWidgetItem *item = new QListWidgetItem(QFileInfo(currentTask.inputPath).fileName() + " -> " + currentTask.outputVideoPath);
-        item->setForeground(Qt::darkGreen); // 绿色表示成功
-        outputListWidget->addItem(item);
+        log((currentTask.draftVideo ? "草稿视频完成! 输出文件: " : "任务完成! 输出文件: ") + currentTask.outputVideoPath);
+        recordStageTiming(StageEmbed, currentTask.durationSecs);
         progressBar->setValue(100);
     }
 
-    // 清理临时文件 (根据用户选项决定是否保留)
-    if (!exportAudioCheckbox->isChecked()) {
-        if (QFile::exists(tempAudioPath)) {
-            bool removed = QFile::remove(tempAudioPath);
-            if (!removed) log("警告: 无法删除临时音频文件: " + tempAudioPath);
-        }
-    } else {
-        log("保留音频文件: " + tempAudioPath);
+    // 草稿视频: 中间音频和字幕留给后台精修，由精修完成后按用户选项清理
+    if (success && currentTask.draftVideo) {
+        finishTask(currentTask, true);
+        enqueueRefinement(currentTask);
+        batchIndex++;
+        startEmbedStage();
+        return;
     }
-    
-    // 如果不导出字幕，删除字幕文件
-    if (!exportSubtitleCheckbox->isChecked()) {
-        if (QFile::exists(outputSubtitlePath)) {
-            bool removed = QFile::remove(outputSubtitlePath);
-            if (!removed) log("警告: 无法删除临时字幕文件: " + outputSubtitlePath);
+
+    // 中间文件在临时目录时，导出的文件移到 Extra 目录，其余随临时目录删除
+    if (!currentTask.scratchDir.isEmpty()) {
+        if (success && !promoteArtifacts(currentTask)) {
+            log("警告: 导出的音频或字幕未能写入 Extra 目录");
         }
     } else {
-        log("保留字幕文件: " + outputSubtitlePath);
-    }
-    
-    // 清理渲染用的临时字幕文件 (始终清理，这是为了渲染生成的副本)
-    QString targetDir = QFileInfo(currentTask.outputVideoPath).absolutePath();
-    QString tempSrtPath = targetDir + "/temp_render_subs.srt";
-    if (QFile::exists(tempSrtPath)) {
-        QFile::remove(tempSrtPath);
+        // 清理临时文件 (根据用户选项决定是否保留)
+        if (!exportAudioCheckbox->isChecked()) {
+            if (QFile::exists(currentTask.audioPath)) {
+                bool removed = QFile::remove(currentTask.audioPath);
+                if (!removed) log("警告: 无法删除临时音频文件: " + currentTask.audioPath);
+            }
+        } else {
+            log("保留音频文件: " + currentTask.audioPath);
+        }
+
+        // 如果不导出字幕，删除字幕文件
+        if (!exportSubtitleCheckbox->isChecked()) {
+            if (QFile::exists(currentTask.subtitlePath)) {
+                bool removed = QFile::remove(currentTask.subtitlePath);
+                if (!removed) log("警告: 无法删除临时字幕文件: " + currentTask.subtitlePath);
+            }
+        } else {
+            log("保留字幕文件: " + currentTask.subtitlePath);
+        }
+
+        // 清理渲染用的临时字幕文件 (始终清理，这是为了渲染生成的副本)
+        QString tempSrtPath = QFileInfo(currentTask.subtitlePath).absolutePath() + "/temp_render_subs.srt";
+        if (QFile::exists(tempSrtPath)) {
+            QFile::remove(tempSrtPath);
+        }
     }
 
     // 从任务队列和待处理列表移除
-    if (!taskList.isEmpty()) taskList.removeFirst();
-    QList<QListWidgetItem*> items = inputListWidget->findItems(currentTask.inputPath + " (处理中...)", Qt::MatchExactly);
-    if (!items.isEmpty()) delete inputListWidget->takeItem(inputListWidget->row(items.first()));
+    finishTask(currentTask, success, "合成错误");
 
-    // 继续下一个任务
-    processNextTask();
+    // 批次中的下一个任务，或继续下一批
+    batchIndex++;
+    startEmbedStage();
 }
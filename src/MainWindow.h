@@ -8,25 +8,30 @@
 #include <QLabel>
 #include <QProgressBar>
 #include <QComboBox>
-#include <QListWidget>
+#include <QListView>
 #include <QQueue>
 #include <QCloseEvent>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QSet>
 #include "FileDropListWidget.h"
+#include "WorkerFarm.h"
+#include "MediaProbeIndex.h"
+#include "ThroughputModel.h"
+#include "TaskStore.h"
+#include "ResultListModel.h"
+#include "FolderScanner.h"
+#include "FolderWatcher.h"
+#include "SmartRenderer.h"
+#include "RefinementQueue.h"
+#include "HostProfile.h"
+#include "ResourceGovernor.h"
+#include "ScratchSpace.h"
+#include "JobCoordinator.h"
 #include <QCheckBox>
 
 
 
-/**
- * @brief 任务信息结构体
- */
-struct TaskInfo {
-    QString inputPath;
-    QString outputDir;
-    QString status; // "Pending", "Processing", "Completed", "Failed"
-    QString outputVideoPath;
-};
-
 /**
  * @brief 主窗口类
  * 
@@ -56,6 +61,11 @@ private slots:
      * @brief 添加视频文件 (通过文件对话框)
      */
     void addVideoFiles();
+
+    /**
+     * @brief 添加文件夹 (后台递归扫描)
+     */
+    void addFolder();
     
     /**
      * @brief 处理拖拽添加的文件
@@ -63,6 +73,27 @@ private slots:
      */
     void handleDroppedFiles(const QStringList &files);
 
+    /**
+     * @brief 处理拖拽添加的文件夹
+     * @param dirs 文件夹路径列表
+     */
+    void handleDroppedFolders(const QStringList &dirs);
+
+    /**
+     * @brief 文件夹扫描结束
+     * @param filesMatched 找到的文件数
+     * @param cancelled 是否被取消
+     */
+    void onFolderScanFinished(int filesMatched, bool cancelled);
+
+    /**
+     * @brief 监视文件夹中的新文件已写入完成
+     * @param path 文件路径
+     * @param profile 所在监视目录的配置
+     * @param durationSecs 探测到的时长
+     */
+    void onWatchedFileReady(const QString &path, const FolderWatcher::Profile &profile, double durationSecs);
+
     /**
      * @brief 选择输出目录
      */
@@ -74,10 +105,21 @@ private slots:
     void processNextTask();
 
     /**
-     * @brief 从队列中删除选中项
+     * @brief 从队列中删除选中项 (正在处理的任务确认后取消)
      */
     void removeSelectedTask();
 
+    /**
+     * @brief 选中的任务优先处理: 移到队首，必要时抢占正在处理的批次
+     */
+    void prioritizeSelectedTasks();
+
+    /**
+     * @brief 暂停或继续选中的任务
+     * @param paused true 为暂停: 待处理的任务不再参与调度，正在处理的任务挂起其子进程
+     */
+    void setSelectedTasksPaused(bool paused);
+
     /**
      * @brief 处理提取音频完成
      * @param exitCode 退出代码
@@ -105,34 +147,83 @@ private:
     /**
      * @brief 添加视频到队列的内部逻辑
      * @param files 文件路径列表
+     * @param sizes 已知的文件大小 (来自后台扫描，为空时查询索引前读取文件信息)
+     * @param mtimes 已知的修改时间 (毫秒时间戳)
+     */
+    void addVideosToQueue(const QStringList &files, const QList<qint64> &sizes = {}, const QList<qint64> &mtimes = {});
+
+    /**
+     * @brief 把已构造的任务加入队列 (去重、探测时长、自动开始)
+     * @param newTasks 新任务
+     * @param fileStats 已知的文件信息 路径 -> (大小, 修改时间)，探测时直接使用
      */
-    void addVideosToQueue(const QStringList &files);
+    void enqueueTasks(const QList<TaskInfo> &newTasks, const QHash<QString, QPair<qint64, qint64>> &fileStats = {});
 
     // UI 控件
     FileDropListWidget *inputListWidget;
-    QListWidget *outputListWidget;
+    QListView *outputListView;
 
     // 配置控件
     QComboBox *engineCombo;
     QComboBox *modelCombo;
+    QComboBox *transcribeModeCombo; // 转写模式: 标准 / 两级 (草稿 + 后台精修，仅 Whisper)
     QPushButton *helpButton;
     QLineEdit *outputDirEdit;
     QPushButton *addFilesButton;
+    QPushButton *addFolderButton;
     QPushButton *selectOutputDirButton;
     QCheckBox *exportSubtitleCheckbox; // 导出字幕选项
     QCheckBox *exportAudioCheckbox;    // 导出音频选项
+    QCheckBox *batchTranscribeCheckbox; // 批量转写选项 (仅 Whisper)
+    QCheckBox *transcriptOnlyCheckbox;  // 仅转写选项 (音频文件始终仅转写)
+    QCheckBox *smartRenderCheckbox;     // 智能渲染选项 (只重新编码含字幕的 GOP)
+    QCheckBox *allowDownloadCheckbox;   // 允许下载本地模型仓库中缺少的模型 (默认严格离线)
+    QCheckBox *watchFoldersCheckbox;    // 监视文件夹 (按 watch_folders.json 持续入队)
+    QCheckBox *distributeCheckbox;      // 分发到工作节点 (启动任务协调器)
     // QPushButton *startButton; // 自动开始，不需要按钮
     QTextEdit *logArea;
     QProgressBar *progressBar;
     QLabel *statusLabel;
+    QLabel *etaLabel; // 剩余时间与吞吐量
+    QLabel *scanStatusLabel;      // 文件夹扫描进度
+    QPushButton *cancelScanButton; // 取消文件夹扫描
 
     // 数据
-    QList<TaskInfo> taskList; // 使用 QList 方便删除
+    TaskStore *taskStore;          // 待处理任务 (按 ID/路径索引，同时是队列视图的模型)
+    ResultListModel *resultModel;  // 处理结果
     TaskInfo currentTask;
     bool isProcessing;
 
-    QString tempAudioPath;
-    QString outputSubtitlePath;
+    // 当前批次 (非批量模式下只有一个任务)，提取和合成阶段逐个执行，转写阶段整批执行
+    QList<TaskInfo> currentBatch;
+    int batchIndex;
+    QString batchJobsPath; // 批量转写任务清单 (临时 JSON)
+    static constexpr int kMaxBatchTasks = 8;
+    static constexpr double kMaxBatchAudioSecs = 1200; // 单批次音频总时长上限
+    static constexpr qint64 kScratchTextBytes = 16 * 1024 * 1024; // 临时目录中字幕/文本稿的预留大小
+
+    MediaProbeIndex *mediaIndex; // 媒体元数据索引 (入队时异步探测)
+    FolderScanner *folderScanner; // 后台递归扫描拖入的文件夹
+    FolderWatcher *folderWatcher; // 监视文件夹，新文件写入完成后按目录配置入队
+    SmartRenderer *smartRenderer; // 智能渲染 (只重新编码含字幕的片段)
+    QString embedMode;            // 当前任务的合成方式: "smart"、"softsub" 或空 (完整渲染)，用于吞吐量统计
+    QString smartScratchDir;      // 智能渲染中间文件占用的临时目录 (放不下时为空，中间文件写在输出目录)
+    RefinementQueue *refinementQueue; // 两级转写的后台精修 (低优先级)
+    ResourceGovernor *resourceGovernor; // 并发工作的内存与临时磁盘准入控制
+    int batchLeaseId;                   // 当前批次的资源占用 (0 表示无)
+    ScratchSpace *scratchSpace;         // 中间文件的临时目录 (内存盘)，输出目录只写最终产物
+    JobCoordinator *jobCoordinator;     // 分发模式下把任务租给工作节点
+    QList<int> dispatchQueue;           // 分发模式下尚未提交给协调器的任务 (入队、继续或开启分发时加入)
+    bool waitingForResources;           // 下一批次正在等待资源释放
+
+    // 任务控制: 取消、暂停与抢占
+    QSet<int> cancelledIds;   // 已取消、等待当前阶段的子进程结束的任务
+    bool stagePaused;         // 当前阶段的子进程已挂起
+    bool preemptRequested;    // 有优先任务等待: 当前批次在下一个阶段边界让出
+    bool preempting;          // 转写已被终止以让出 (检查点保留)，结束回调中让出批次
+    QElapsedTimer pauseTimer; // 本次挂起的开始时间
+    qint64 stagePausedMs;     // 当前阶段累计挂起时间 (不计入吞吐量统计)
+    bool stageResumed;        // 当前转写从检查点继续 (只覆盖部分音频，不计入吞吐量统计)
 
     // 任务阶段枚举
     enum TaskStage {
@@ -144,6 +235,23 @@ private:
     TaskStage currentStage;
     double totalDurationSecs; // 用于计算 FFmpeg 进度
     QProcess *currentProcess; // 当前正在运行的子进程指针
+    WorkerFarm *workerFarm;   // 常驻 Python 工作进程池
+    int workerPoolSize;       // 配置的常驻进程数 (worker_farm.json)，两级转写时至少为 2
+    int currentJobId;         // 提交给工作进程池的转写任务 ID (-1 表示无)
+    QElapsedTimer processStartTimer; // 统计子进程启动耗时
+    qint64 totalSpawnLatencyMs;
+    int spawnCount;
+
+    // 吞吐量与剩余时间
+    ThroughputModel *throughputModel; // 本机各阶段实时率 (持久化)
+    HostProfile *hostProfile;         // 本机调优配置 (autotune.py 生成)
+    QElapsedTimer stageTimer;         // 当前阶段已用时间
+    double stageFraction;             // 当前阶段完成比例 (0~1)
+    QElapsedTimer sessionTimer;       // 本轮队列处理计时
+    QElapsedTimer etaRefreshTimer;    // 限制剩余时间刷新频率
+    qint64 busyMs;                    // 之前各轮累计处理时间
+    int completedFiles;
+    double completedAudioSecs;
 
     /**
      * @brief 记录日志
@@ -159,6 +267,223 @@ private:
      */
     void runCommand(const QString &program, const QStringList &arguments, const QString &workDir = "");
 
+    /**
+     * @brief 任务需要经过的阶段
+     * @param task 任务
+     */
+    QList<TaskStage> taskStages(const TaskInfo &task) const;
+
+    /**
+     * @brief 按吞吐量模型估算阶段耗时 (秒)
+     * @param task 任务 (决定引擎、模型和合成方式)
+     * @param stage 阶段
+     * @param mediaSecs 媒体时长 (秒)
+     */
+    double estimateStageSecs(const TaskInfo &task, TaskStage stage, double mediaSecs) const;
+
+    /**
+     * @brief 估算任务剩余时间 (秒)，时长未知时返回 -1
+     * @param task 任务
+     */
+    double remainingTaskSecs(const TaskInfo &task) const;
+
+    /**
+     * @brief 队列剩余时间的分组键 (TaskStore 按此增量汇总排队任务的时长)
+     */
+    static QString etaGroupKey(const TaskInfo &task);
+
+    /**
+     * @brief 按各阶段预计耗时加权更新当前任务进度条
+     * @param stage 当前阶段
+     * @param fraction 阶段完成比例 (0~1)
+     */
+    void updateTaskProgress(TaskStage stage, double fraction);
+
+    /**
+     * @brief 刷新剩余时间与吞吐量显示
+     * @param force 忽略刷新频率限制
+     */
+    void updateEtaLabel(bool force = false);
+
+    /**
+     * @brief 把刚完成阶段的实测耗时计入吞吐量模型
+     * @param stage 阶段
+     * @param mediaSecs 该阶段处理的媒体时长 (秒)
+     */
+    void recordStageTiming(TaskStage stage, double mediaSecs);
+
+    /**
+     * @brief 处理转写脚本的一行输出 (进度标记或日志)
+     * @param line 输出行
+     */
+    void handleScriptOutputLine(const QString &line);
+
+    /**
+     * @brief 把 dispatchQueue 中的任务交给协调器 (分发模式)，本地仍在处理的任务留到下次
+     */
+    void dispatchToWorkers();
+
+    /**
+     * @brief 为待处理队列前若干行组成的批次申请资源，装不下时缩小批次
+     * @param rows 候选行 (按需从末尾移除)
+     * @return 占用 ID，单个任务也装不下时返回 0
+     */
+    int acquireBatchResources(QList<int> &rows);
+
+    /**
+     * @brief 计算任务的输出路径并清理旧文件，同时在队列中高亮
+     * @param task 待处理任务
+     */
+    void prepareTask(TaskInfo &task);
+
+    /**
+     * @brief 设置任务产物的最终导出位置 (视频、字幕、文本稿、音频)，不访问文件系统
+     */
+    static void assignExportPaths(TaskInfo &task);
+
+    /**
+     * @brief 取消正在处理的任务: 终止其所在阶段的子进程 (批量转写中的任务在该阶段结束后丢弃)
+     * @param id 任务 ID
+     */
+    void cancelTask(int id);
+
+    /**
+     * @brief 终止当前阶段的子进程，由该阶段的完成回调继续后续流程
+     */
+    void stopStageProcess();
+
+    /**
+     * @brief 挂起或恢复当前阶段的子进程
+     * @return 是否成功 (没有运行中的子进程时失败)
+     */
+    bool setStagePaused(bool paused);
+
+    /**
+     * @brief 当前阶段子进程的 PID，没有时返回 0
+     */
+    qint64 stageProcessId() const;
+
+    /**
+     * @brief 当前批次中没有优先任务时请求抢占: 单个任务的转写立即在检查点处让出，其他阶段在阶段结束时让出
+     */
+    void requestPreemption();
+
+    /**
+     * @brief 阶段边界: 有抢占请求时让出当前批次
+     * @return 是否已让出 (调用方应直接返回)
+     */
+    bool yieldIfPreempted();
+
+    /**
+     * @brief 让出当前批次: 尚未完成的任务带着已完成阶段的产物回到队列
+     */
+    void requeueBatch();
+
+    /**
+     * @brief 当前阶段的实际运行时间 (扣除挂起时间)，毫秒
+     */
+    qint64 stageElapsedMs() const;
+
+    /**
+     * @brief 转写检查点路径 (与字幕放在同一目录)
+     */
+    static QString checkpointPath(const TaskInfo &task);
+
+    /**
+     * @brief 把临时目录中的产物移到最终位置: 仅转写任务的字幕和文本稿，视频任务中用户选择导出的音频和字幕
+     * @param task 已完成的任务 (路径更新为最终位置)
+     * @return 是否全部成功
+     */
+    bool promoteArtifacts(TaskInfo &task);
+
+    /**
+     * @brief 归还智能渲染的临时目录配额 (渲染结束或取消时)
+     */
+    void releaseSmartScratch();
+
+    /**
+     * @brief 对当前批次中 batchIndex 指向的任务提取音频
+     */
+    void startExtractStage();
+
+    /**
+     * @brief 对当前批次执行语音转写 (多于一个任务时使用批量模式)
+     */
+    void startTranscribeStage();
+
+    /**
+     * @brief 对当前批次中 batchIndex 指向的任务合成字幕
+     */
+    void startEmbedStage();
+
+    /**
+     * @brief 完整渲染: 对整个视频重新编码并叠加字幕 (也是智能渲染失败时的回退)
+     */
+    void startFullRender();
+
+    /**
+     * @brief 硬字幕合成的视频编码参数 (完整渲染、智能渲染与后台精修共用，preset 取自本机调优配置)
+     */
+    QStringList videoEncodeArgs() const;
+
+    /**
+     * @brief 结束任务: 记录结果并从队列移除
+     * @param task 任务
+     * @param success 是否成功
+     * @param reason 失败原因 (成功时忽略)
+     */
+    void finishTask(const TaskInfo &task, bool success, const QString &reason = QString());
+
+    /**
+     * @brief 任务是否属于正在处理的批次
+     * @param id 任务 ID
+     */
+    bool isTaskActive(int id) const;
+
+    /**
+     * @brief 任务是否使用两级转写 (Whisper 且模型不是 tiny)，默认参数表示按界面当前选项
+     * @param task 任务
+     */
+    bool twoTierActive(const TaskInfo &task = TaskInfo()) const;
+
+    /**
+     * @brief 转写阶段实际使用的模型 (两级转写的草稿阶段为 tiny)
+     * @param task 任务
+     * @param twoTier 是否两级转写
+     */
+    QString transcribeModel(const TaskInfo &task, bool twoTier) const;
+
+    /**
+     * @brief 任务的转写引擎 (任务自带配置优先，否则为界面当前选项)
+     */
+    QString taskEngine(const TaskInfo &task) const;
+
+    /**
+     * @brief 任务的 Whisper 模型 (任务自带配置优先，否则为界面当前选项)
+     */
+    QString taskModel(const TaskInfo &task) const;
+
+    /**
+     * @brief 草稿软字幕视频: 直接封装字幕流，不重新编码 (当前任务)
+     */
+    void startSoftSubtitleMux();
+
+    /**
+     * @brief 草稿完成后加入后台精修队列
+     * @param task 任务
+     */
+    void enqueueRefinement(const TaskInfo &task);
+
+    /**
+     * @brief 定位 transcribe.py 脚本路径
+     */
+    QString transcribeScriptPath() const;
+
+    /**
+     * @brief 本机数据目录 (索引、统计等持久化文件)
+     */
+    QString dataDir() const;
+
 private slots:
     /**
      * @brief 统一处理进程完成信号
@@ -176,6 +501,57 @@ private slots:
      * @brief 统一处理标准错误
      */
     void onProcessReadyReadStandardError();
+
+    /**
+     * @brief 子进程已启动 (记录启动耗时)
+     */
+    void onProcessStarted();
+
+    /**
+     * @brief 子进程错误 (仅处理启动失败)
+     * @param error 错误类型
+     */
+    void onProcessErrorOccurred(QProcess::ProcessError error);
+
+    /**
+     * @brief 工作进程池任务输出
+     */
+    void onWorkerJobOutput(int jobId, const QString &line);
+
+    /**
+     * @brief 工作进程池任务完成
+     */
+    void onWorkerJobFinished(int jobId, int exitCode);
+
+    /**
+     * @brief 媒体信息探测完成
+     * @param path 文件路径
+     * @param info 元数据
+     */
+    void onMediaProbed(const QString &path, const MediaInfo &info);
+
+    /**
+     * @brief 智能渲染结束，失败时回退为完整渲染
+     * @param success 是否成功
+     * @param reason 失败原因
+     */
+    void onSmartRenderFinished(bool success, const QString &reason);
+
+    /**
+     * @brief 后台精修结束
+     * @param inputPath 源文件
+     * @param outputPath 替换后的最终产物
+     * @param success 是否成功 (失败时保留草稿)
+     */
+    void onRefinementFinished(const QString &inputPath, const QString &outputPath, bool success);
+
+    /**
+     * @brief 工作节点任务结束 (成功，或重试次数用完)
+     * @param taskId 任务 ID
+     * @param success 是否成功
+     * @param error 失败原因
+     */
+    void onRemoteJobFinished(int taskId, bool success, const QString &error);
 };
 
 #endif // MAINWINDOW_H
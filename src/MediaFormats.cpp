@@ -0,0 +1,47 @@
+#include "MediaFormats.h"
+#include <QFileInfo>
+
+const QStringList &MediaFormats::videoSuffixes()
+{
+    static const QStringList suffixes = {"mp4", "avi", "mkv", "mov", "flv", "wmv"};
+    return suffixes;
+}
+
+const QStringList &MediaFormats::audioSuffixes()
+{
+    static const QStringList suffixes = {"mp3", "m4a", "flac", "opus", "ogg", "aac", "wav"};
+    return suffixes;
+}
+
+bool MediaFormats::isAudioFile(const QString &path)
+{
+    return audioSuffixes().contains(QFileInfo(path).suffix().toLower());
+}
+
+bool MediaFormats::isSupported(const QString &path)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    return videoSuffixes().contains(suffix) || audioSuffixes().contains(suffix);
+}
+
+QString MediaFormats::softSubtitleCodec(const QString &path)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "mp4" || suffix == "mov" || suffix == "m4v") return "mov_text";
+    if (suffix == "mkv") return "srt";
+    return QString();
+}
+
+/**
+ * @brief 例如 "媒体文件 (*.mp4 ... *.mp3 ...);;视频文件 (...);;音频文件 (...)"
+ */
+QString MediaFormats::dialogFilter()
+{
+    auto patterns = [](const QStringList &suffixes) {
+        QStringList list;
+        for (const QString &suffix : suffixes) list << "*." + suffix;
+        return list.join(' ');
+    };
+    return QString("媒体文件 (%1 %2);;视频文件 (%1);;音频文件 (%2)")
+        .arg(patterns(videoSuffixes()), patterns(audioSuffixes()));
+}
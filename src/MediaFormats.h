@@ -0,0 +1,47 @@
+#ifndef MEDIAFORMATS_H
+#define MEDIAFORMATS_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief 支持的输入文件格式 (拖拽、文件对话框共用)
+ */
+class MediaFormats
+{
+public:
+    /**
+     * @brief 视频文件后缀 (小写，不含点)
+     */
+    static const QStringList &videoSuffixes();
+
+    /**
+     * @brief 音频文件后缀 (小写，不含点)，这类文件只生成字幕/文本
+     */
+    static const QStringList &audioSuffixes();
+
+    /**
+     * @brief 是否为音频文件
+     * @param path 文件路径
+     */
+    static bool isAudioFile(const QString &path);
+
+    /**
+     * @brief 是否为支持的输入文件 (视频或音频)
+     * @param path 文件路径
+     */
+    static bool isSupported(const QString &path);
+
+    /**
+     * @brief 容器支持的软字幕编码 (mp4/mov 为 mov_text，mkv 为 srt)，不支持时为空
+     * @param path 视频文件路径
+     */
+    static QString softSubtitleCodec(const QString &path);
+
+    /**
+     * @brief 文件对话框过滤器
+     */
+    static QString dialogFilter();
+};
+
+#endif // MEDIAFORMATS_H
@@ -0,0 +1,324 @@
+#include "MediaProbeIndex.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+/**
+ * @brief MediaInfo 与 JSON 互转 (索引文件格式)
+ */
+static QJsonObject mediaInfoToJson(const MediaInfo &info)
+{
+    QJsonObject obj;
+    obj["duration"] = info.durationSecs;
+    obj["format"] = info.formatName;
+    obj["videoCodec"] = info.videoCodec;
+    obj["audioCodec"] = info.audioCodec;
+    obj["channels"] = info.audioChannels;
+    obj["sampleRate"] = info.sampleRate;
+    obj["videoStreams"] = info.videoStreams;
+    obj["audioStreams"] = info.audioStreams;
+    obj["layout"] = info.streamLayout;
+    obj["keyframeInterval"] = info.keyframeIntervalSecs;
+    return obj;
+}
+
+static MediaInfo mediaInfoFromJson(const QJsonObject &obj)
+{
+    MediaInfo info;
+    info.valid = true;
+    info.durationSecs = obj["duration"].toDouble();
+    info.formatName = obj["format"].toString();
+    info.videoCodec = obj["videoCodec"].toString();
+    info.audioCodec = obj["audioCodec"].toString();
+    info.audioChannels = obj["channels"].toInt();
+    info.sampleRate = obj["sampleRate"].toInt();
+    info.videoStreams = obj["videoStreams"].toInt();
+    info.audioStreams = obj["audioStreams"].toInt();
+    info.streamLayout = obj["layout"].toString();
+    info.keyframeIntervalSecs = obj["keyframeInterval"].toDouble();
+    return info;
+}
+
+/**
+ * @brief 构造函数，加载索引文件
+ */
+MediaProbeIndex::MediaProbeIndex(const QString &indexPath, int maxConcurrent, QObject *parent)
+    : QObject(parent), indexPath(indexPath), maxConcurrent(qMax(1, maxConcurrent))
+{
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(2000);
+    connect(&saveTimer, &QTimer::timeout, this, &MediaProbeIndex::save);
+    load();
+}
+
+MediaProbeIndex::~MediaProbeIndex()
+{
+    // 终止未完成的探测，不再处理其结果
+    for (auto it = running.begin(); it != running.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->kill();
+    }
+    if (saveTimer.isActive()) {
+        save();
+    }
+}
+
+/**
+ * @brief 查询索引
+ */
+bool MediaProbeIndex::lookup(const QString &path, MediaInfo *info) const
+{
+    if (!entries.contains(path)) return false;
+
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists()) return false;
+    return lookup(path, fileInfo.size(), fileInfo.lastModified().toMSecsSinceEpoch(), info);
+}
+
+bool MediaProbeIndex::lookup(const QString &path, qint64 size, qint64 mtime, MediaInfo *info) const
+{
+    auto it = entries.constFind(path);
+    if (it == entries.constEnd() || size != it->size || mtime != it->mtime) return false;
+    if (info) *info = it->info;
+    return true;
+}
+
+/**
+ * @brief 加入探测队列
+ */
+void MediaProbeIndex::probe(const QString &path)
+{
+    probe(path, -1, 0);
+}
+
+void MediaProbeIndex::probe(const QString &path, qint64 size, qint64 mtime)
+{
+    if (inFlight.contains(path)) return;
+    inFlight.insert(path);
+    Request request;
+    request.path = path;
+    request.size = size;
+    request.mtime = mtime;
+    queue.enqueue(request);
+    startNext();
+}
+
+int MediaProbeIndex::pendingCount() const
+{
+    return inFlight.size();
+}
+
+/**
+ * @brief 启动排队的探测，直到达到并发上限
+ */
+void MediaProbeIndex::startNext()
+{
+    while (running.size() < maxConcurrent && !queue.isEmpty()) {
+        Request request = queue.dequeue();
+        if (request.size < 0) {
+            QFileInfo fileInfo(request.path);
+            request.size = fileInfo.size();
+            request.mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+        }
+
+        QProcess *process = new QProcess(this);
+        process->setStandardErrorFile(QProcess::nullDevice());
+        connect(process, &QProcess::finished, this, &MediaProbeIndex::onProbeFinished);
+        // 启动失败可能在 start() 内同步发出，排队处理避免重入
+        connect(process, &QProcess::errorOccurred, this, &MediaProbeIndex::onProbeError, Qt::QueuedConnection);
+        running.insert(process, request);
+
+        // 一次调用同时获取: 容器时长、各路流信息、前 30 秒的包 (用于估算关键帧间隔)
+        QStringList args;
+        args << "-v" << "error" << "-print_format" << "json"
+             << "-show_entries"
+             << "format=duration,format_name"
+                ":stream=index,codec_type,codec_name,channels,sample_rate"
+                ":stream_disposition=attached_pic"
+                ":packet=stream_index,pts_time,flags"
+             << "-read_intervals" << "%+30"
+             << QDir::toNativeSeparators(request.path);
+        process->start("ffprobe", args);
+    }
+}
+
+void MediaProbeIndex::onProbeFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process || !running.contains(process)) return;
+
+    MediaInfo info;
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        info = parseProbeOutput(process->readAllStandardOutput());
+    }
+    finishProbe(process, info);
+}
+
+void MediaProbeIndex::onProbeError(QProcess::ProcessError error)
+{
+    // 其他错误会伴随 finished 信号
+    if (error != QProcess::FailedToStart) return;
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process || !running.contains(process)) return;
+    finishProbe(process, MediaInfo());
+}
+
+/**
+ * @brief 记录探测结果并启动下一个
+ */
+void MediaProbeIndex::finishProbe(QProcess *process, const MediaInfo &info)
+{
+    Request request = running.take(process);
+    const QString &path = request.path;
+    inFlight.remove(path);
+    process->deleteLater();
+
+    // 以探测前的文件信息为键；探测期间文件被改写 (例如仍在复制) 时结果可能已过期，不写入索引
+    if (info.valid) {
+        QFileInfo fileInfo(path);
+        if (fileInfo.size() == request.size && fileInfo.lastModified().toMSecsSinceEpoch() == request.mtime) {
+            Entry entry;
+            entry.mtime = request.mtime;
+            entry.size = request.size;
+            entry.info = info;
+            entries.insert(path, entry);
+            saveTimer.start();
+        }
+    }
+
+    emit probed(path, info);
+    startNext();
+}
+
+/**
+ * @brief 解析 ffprobe JSON 输出
+ */
+MediaInfo MediaProbeIndex::parseProbeOutput(const QByteArray &output)
+{
+    MediaInfo info;
+    QJsonParseError parseError;
+    QJsonObject root = QJsonDocument::fromJson(output, &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) return info;
+
+    QJsonObject format = root["format"].toObject();
+    info.formatName = format["format_name"].toString();
+    info.durationSecs = format["duration"].toString().toDouble(); // ffprobe 以字符串输出数值
+
+    int videoIndex = -1;
+    QStringList layout;
+    const QJsonArray streams = root["streams"].toArray();
+    for (const QJsonValue &value : streams) {
+        QJsonObject stream = value.toObject();
+        QString type = stream["codec_type"].toString();
+        QString codec = stream["codec_name"].toString();
+
+        if (type == "video") {
+            // 音频文件中的封面图也表现为视频流，不计入
+            if (stream["disposition"].toObject()["attached_pic"].toInt() == 1) {
+                layout << "cover:" + codec;
+                continue;
+            }
+            info.videoStreams++;
+            if (videoIndex < 0) {
+                videoIndex = stream["index"].toInt();
+                info.videoCodec = codec;
+            }
+            layout << "v:" + codec;
+        } else if (type == "audio") {
+            info.audioStreams++;
+            int channels = stream["channels"].toInt();
+            if (info.audioCodec.isEmpty()) {
+                info.audioCodec = codec;
+                info.audioChannels = channels;
+                info.sampleRate = stream["sample_rate"].toString().toInt();
+            }
+            layout << QString("a:%1(%2ch)").arg(codec).arg(channels);
+        } else if (!type.isEmpty()) {
+            layout << type.left(1) + ":" + codec;
+        }
+    }
+    info.streamLayout = layout.join(' ');
+
+    // 关键帧间隔: 第一路视频流中带 K 标记的包的平均间隔
+    if (videoIndex >= 0) {
+        double first = -1, last = -1;
+        int count = 0;
+        const QJsonArray packets = root["packets"].toArray();
+        for (const QJsonValue &value : packets) {
+            QJsonObject packet = value.toObject();
+            if (packet["stream_index"].toInt() != videoIndex) continue;
+            if (!packet["flags"].toString().contains('K')) continue;
+            bool ok;
+            double t = packet["pts_time"].toString().toDouble(&ok);
+            if (!ok) continue;
+            if (first < 0) first = t;
+            last = t;
+            count++;
+        }
+        if (count >= 2 && last > first) {
+            info.keyframeIntervalSecs = (last - first) / (count - 1);
+        }
+    }
+
+    info.valid = info.durationSecs > 0 || info.audioStreams > 0 || info.videoStreams > 0;
+    return info;
+}
+
+/**
+ * @brief 加载索引文件
+ */
+void MediaProbeIndex::load()
+{
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    QJsonObject items = root["entries"].toObject();
+    for (auto it = items.begin(); it != items.end(); ++it) {
+        QJsonObject obj = it.value().toObject();
+        Entry entry;
+        entry.mtime = qint64(obj["mtime"].toDouble());
+        entry.size = qint64(obj["size"].toDouble());
+        entry.info = mediaInfoFromJson(obj["info"].toObject());
+        entries.insert(it.key(), entry);
+    }
+}
+
+/**
+ * @brief 写入索引文件 (QSaveFile 保证写入过程中断时不损坏旧文件)，先移除不再存在的文件的记录
+ */
+void MediaProbeIndex::save()
+{
+    saveTimer.stop();
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (QFileInfo::exists(it.key())) {
+            ++it;
+        } else {
+            it = entries.erase(it);
+        }
+    }
+
+    QJsonObject items;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QJsonObject obj;
+        obj["mtime"] = double(it->mtime);
+        obj["size"] = double(it->size);
+        obj["info"] = mediaInfoToJson(it->info);
+        items[it.key()] = obj;
+    }
+    QJsonObject root;
+    root["version"] = 1;
+    root["entries"] = items;
+
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
@@ -0,0 +1,131 @@
+#ifndef MEDIAPROBEINDEX_H
+#define MEDIAPROBEINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QProcess>
+#include <QTimer>
+
+/**
+ * @brief 媒体元数据 (由 ffprobe 获取)
+ */
+struct MediaInfo {
+    bool valid = false;
+    double durationSecs = 0;          // 总时长 (秒)
+    QString formatName;               // 容器格式
+    QString videoCodec;               // 第一路视频编码 (纯音频为空)
+    QString audioCodec;               // 第一路音频编码
+    int audioChannels = 0;
+    int sampleRate = 0;
+    int videoStreams = 0;
+    int audioStreams = 0;
+    QString streamLayout;             // 流布局摘要，例如 "v:h264 a:aac(2ch)"
+    double keyframeIntervalSecs = 0;  // 平均关键帧间隔 (根据前 30 秒估算)
+};
+
+/**
+ * @brief 媒体元数据索引
+ *
+ * 入队时并发 (有上限) 调用 ffprobe 获取时长、音频编码、流布局和关键帧间隔，
+ * 结果以 路径 + 修改时间 + 文件大小 为键持久化到 JSON 文件，文件未变化时不再重复探测。
+ * 记录的文件信息是 ffprobe 启动前读取的；探测期间文件发生变化时结果不写入索引。
+ */
+class MediaProbeIndex : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数，加载已有索引
+     * @param indexPath 索引文件路径
+     * @param maxConcurrent 同时运行的 ffprobe 进程数上限
+     * @param parent 父对象
+     */
+    MediaProbeIndex(const QString &indexPath, int maxConcurrent, QObject *parent = nullptr);
+    ~MediaProbeIndex();
+
+    /**
+     * @brief 查询索引 (文件修改时间或大小变化时视为未命中)
+     * @param path 文件路径
+     * @param info 输出的元数据
+     * @return 是否命中
+     */
+    bool lookup(const QString &path, MediaInfo *info) const;
+
+    /**
+     * @brief 按调用方已读取的文件信息查询索引 (不访问文件系统，适合后台扫描送回的大量文件)
+     * @param path 文件路径
+     * @param size 文件大小
+     * @param mtime 修改时间 (毫秒时间戳)
+     * @param info 输出的元数据
+     * @return 是否命中
+     */
+    bool lookup(const QString &path, qint64 size, qint64 mtime, MediaInfo *info) const;
+
+    /**
+     * @brief 异步探测文件，完成后发出 probed 信号 (已在队列中的文件不会重复探测)
+     * 文件信息在启动 ffprobe 前读取
+     * @param path 文件路径
+     */
+    void probe(const QString &path);
+
+    /**
+     * @brief 按调用方已读取的文件信息异步探测 (例如后台扫描送回的文件，界面线程不再访问文件)
+     * @param path 文件路径
+     * @param size 文件大小
+     * @param mtime 修改时间 (毫秒时间戳)
+     */
+    void probe(const QString &path, qint64 size, qint64 mtime);
+
+    /**
+     * @brief 排队和正在运行的探测数量
+     */
+    int pendingCount() const;
+
+    /**
+     * @brief 立即写入索引文件 (不再存在的文件的记录一并移除)
+     */
+    void save();
+
+signals:
+    /**
+     * @brief 探测完成
+     * @param path 文件路径
+     * @param info 元数据 (失败时 valid 为 false)
+     */
+    void probed(const QString &path, const MediaInfo &info);
+
+private slots:
+    void onProbeFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProbeError(QProcess::ProcessError error);
+
+private:
+    struct Entry {
+        qint64 mtime = 0;
+        qint64 size = 0;
+        MediaInfo info;
+    };
+
+    // 排队或运行中的探测，size < 0 表示文件信息在启动前读取
+    struct Request {
+        QString path;
+        qint64 size = -1;
+        qint64 mtime = 0;
+    };
+
+    void load();
+    void startNext();
+    void finishProbe(QProcess *process, const MediaInfo &info);
+    static MediaInfo parseProbeOutput(const QByteArray &output);
+
+    QString indexPath;
+    int maxConcurrent;
+    QHash<QString, Entry> entries;
+    QQueue<Request> queue;
+    QHash<QProcess*, Request> running;
+    QSet<QString> inFlight; // 排队或运行中的路径，用于去重
+    QTimer saveTimer; // 合并频繁写入
+};
+
+#endif // MEDIAPROBEINDEX_H
@@ -0,0 +1,46 @@
+#include "ProcessControl.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <signal.h>
+#endif
+
+#ifdef Q_OS_WIN
+/**
+ * @brief 调用 ntdll 中未公开但稳定的 NtSuspendProcess/NtResumeProcess
+ */
+static bool callNtProcessFunction(const char *name, qint64 pid)
+{
+    typedef LONG (NTAPI *NtProcessFunction)(HANDLE);
+    static HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    NtProcessFunction function = ntdll ? reinterpret_cast<NtProcessFunction>(GetProcAddress(ntdll, name)) : nullptr;
+    if (!function) return false;
+
+    HANDLE process = OpenProcess(PROCESS_SUSPEND_RESUME, FALSE, DWORD(pid));
+    if (!process) return false;
+    LONG status = function(process);
+    CloseHandle(process);
+    return status >= 0;
+}
+#endif
+
+bool ProcessControl::suspend(qint64 pid)
+{
+    if (pid <= 0) return false;
+#ifdef Q_OS_WIN
+    return callNtProcessFunction("NtSuspendProcess", pid);
+#else
+    return ::kill(pid_t(pid), SIGSTOP) == 0;
+#endif
+}
+
+bool ProcessControl::resume(qint64 pid)
+{
+    if (pid <= 0) return false;
+#ifdef Q_OS_WIN
+    return callNtProcessFunction("NtResumeProcess", pid);
+#else
+    return ::kill(pid_t(pid), SIGCONT) == 0;
+#endif
+}
@@ -0,0 +1,30 @@
+#ifndef PROCESSCONTROL_H
+#define PROCESSCONTROL_H
+
+#include <QtGlobal>
+
+/**
+ * @brief 子进程挂起/恢复
+ *
+ * POSIX 下发送 SIGSTOP/SIGCONT，Windows 下调用 ntdll 的 NtSuspendProcess/NtResumeProcess。
+ * 挂起的进程保留全部内存和已完成的计算，恢复后从原处继续；挂起期间仍可直接终止。
+ */
+class ProcessControl
+{
+public:
+    /**
+     * @brief 挂起进程
+     * @param pid 进程 ID
+     * @return 是否成功
+     */
+    static bool suspend(qint64 pid);
+
+    /**
+     * @brief 恢复挂起的进程
+     * @param pid 进程 ID
+     * @return 是否成功
+     */
+    static bool resume(qint64 pid);
+};
+
+#endif // PROCESSCONTROL_H
@@ -0,0 +1,329 @@
+#include "RefinementQueue.h"
+#include "FileUtils.h"
+#include "ResourceGovernor.h"
+#include "WorkerFarm.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcessEnvironment>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * @brief 构造函数
+ */
+RefinementQueue::RefinementQueue(const QString &pythonProgram, const QString &scriptPath, QObject *parent)
+    : QObject(parent), pythonProgram(pythonProgram), scriptPath(scriptPath)
+{
+}
+
+RefinementQueue::~RefinementQueue()
+{
+    shutdown();
+}
+
+/**
+ * @brief 降低子进程优先级: Windows 下以 BELOW_NORMAL 优先级类创建，其他平台在子进程中调用 nice
+ */
+void RefinementQueue::lowerPriority(QProcess *process)
+{
+#ifdef Q_OS_WIN
+    process->setCreateProcessArgumentsModifier([](QProcess::CreateProcessArguments *args) {
+        args->flags |= BELOW_NORMAL_PRIORITY_CLASS;
+    });
+#else
+    process->setChildProcessModifier([]() {
+        (void)::nice(10);
+    });
+#endif
+}
+
+void RefinementQueue::enqueue(const RefinementJob &job)
+{
+    queue.enqueue(job);
+    emit logMessage(QString("已加入后台精修 (%1): %2").arg(job.model, QFileInfo(job.inputPath).fileName()));
+    startNext();
+}
+
+void RefinementQueue::setHeld(bool held)
+{
+    this->held = held;
+    if (!held) startNext();
+}
+
+void RefinementQueue::setGovernor(ResourceGovernor *governor)
+{
+    this->governor = governor;
+    connect(governor, &ResourceGovernor::capacityAvailable, this, &RefinementQueue::startNext);
+}
+
+void RefinementQueue::setWorkerFarm(WorkerFarm *farm)
+{
+    this->farm = farm;
+    connect(farm, &WorkerFarm::jobOutput, this, &RefinementQueue::onFarmJobOutput);
+    connect(farm, &WorkerFarm::jobFinished, this, &RefinementQueue::onFarmJobFinished);
+}
+
+void RefinementQueue::shutdown()
+{
+    if (farmJobId >= 0) {
+        // 先清除编号，排队中的任务在 cancel 内同步回调
+        int jobId = farmJobId;
+        farmJobId = -1;
+        farm->cancel(jobId);
+    }
+    if (process) {
+        process->disconnect(this);
+        connect(process, &QProcess::finished, process, &QObject::deleteLater);
+        process->kill();
+        process = nullptr;
+    }
+    if (step == StepTranscribe) {
+        QFile::remove(refinedSubtitlePath());
+        QFile::remove(refinedTranscriptPath());
+    }
+    delete renderDir;
+    renderDir = nullptr;
+    if (governor && leaseId) {
+        governor->release(leaseId);
+        leaseId = 0;
+    }
+    step = StepIdle;
+    queue.clear();
+}
+
+int RefinementQueue::pendingCount() const
+{
+    return queue.size() + (step != StepIdle ? 1 : 0);
+}
+
+// 临时文件与目标位于同一目录，保证替换是同一文件系统内的重命名
+QString RefinementQueue::refinedSubtitlePath() const
+{
+    QFileInfo info(current.subtitlePath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".refine.srt";
+}
+
+QString RefinementQueue::refinedTranscriptPath() const
+{
+    if (current.transcriptPath.isEmpty()) return QString();
+    QFileInfo info(current.transcriptPath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".refine.txt";
+}
+
+QString RefinementQueue::refinedVideoPath() const
+{
+    QFileInfo info(current.outputVideoPath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".refine." + info.suffix();
+}
+
+/**
+ * @brief 启动子进程 (低优先级)
+ */
+void RefinementQueue::runStep(Step nextStep, const QString &program, const QStringList &arguments, const QString &workDir)
+{
+    step = nextStep;
+    process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    process->setWorkingDirectory(workDir);
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("PYTHONUNBUFFERED", "1");
+    env.insert("PYTHONUTF8", "1");
+    process->setProcessEnvironment(env);
+    lowerPriority(process);
+    if (governor && leaseId) {
+        governor->attachProcess(leaseId, process);
+    }
+
+    connect(process, &QProcess::finished, this, &RefinementQueue::onProcessFinished);
+    connect(process, &QProcess::readyRead, this, &RefinementQueue::onReadyRead);
+    connect(process, &QProcess::errorOccurred, this, &RefinementQueue::onProcessError, Qt::QueuedConnection);
+    process->start(program, arguments);
+}
+
+/**
+ * @brief 开始下一个精修 (先转写)
+ */
+void RefinementQueue::startNext()
+{
+    if (held || step != StepIdle || queue.isEmpty()) return;
+
+    // 精修与主流程并发运行: 内存 (模型 + 音频，视频任务还有渲染) 和重新渲染的临时视频都需要准入；
+    // 常驻工作进程的模型按实测内存计入，不重复估算
+    bool useFarm = farm && farm->isAvailable();
+    if (governor) {
+        const RefinementJob &next = queue.head();
+        qint64 memory = ResourceGovernor::estimateTranscribeMemory("whisper", next.model, next.durationSecs, !useFarm);
+        qint64 scratch = 0;
+        if (!next.outputVideoPath.isEmpty()) {
+            memory = qMax(memory, ResourceGovernor::estimateRenderMemory());
+            // 重新渲染的视频写在草稿视频旁边，大小按源文件估算 (草稿视频可能尚未生成)
+            scratch = QFileInfo(next.inputPath).size();
+        }
+        leaseId = governor->tryAcquire("后台精修 " + QFileInfo(next.inputPath).fileName(), memory, scratch,
+                                       QFileInfo(next.outputVideoPath).absolutePath());
+        if (!leaseId) return; // 资源释放后 capacityAvailable 会再次调用
+    }
+    current = queue.dequeue();
+
+    QStringList args;
+    args << current.audioPath << refinedSubtitlePath()
+         << "--engine" << "whisper" << "--model" << current.model;
+    if (!current.transcriptPath.isEmpty()) {
+        args << "--txt" << refinedTranscriptPath();
+    }
+    if (current.durationSecs > 0) {
+        args << "--duration" << QString::number(current.durationSecs, 'f', 2);
+    }
+    if (current.allowDownload) {
+        args << "--allow-download";
+    }
+    emit logMessage("开始后台精修: " + QFileInfo(current.inputPath).fileName());
+    if (useFarm) {
+        step = StepTranscribe;
+        farmJobId = farm->submit(args);
+        return;
+    }
+    runStep(StepTranscribe, pythonProgram, QStringList() << scriptPath << args, QString());
+}
+
+/**
+ * @brief 精修在后台进行，只转发错误信息，避免进度刷屏
+ */
+void RefinementQueue::forwardOutputLine(const QString &line)
+{
+    if (line.startsWith("Error", Qt::CaseInsensitive) || line.contains("Traceback")) {
+        emit logMessage("精修: " + line);
+    }
+}
+
+void RefinementQueue::onReadyRead()
+{
+    while (process && process->canReadLine()) {
+        forwardOutputLine(QString::fromUtf8(process->readLine()).trimmed());
+    }
+}
+
+void RefinementQueue::onFarmJobOutput(int jobId, const QString &line)
+{
+    if (jobId != farmJobId) return;
+    forwardOutputLine(line);
+}
+
+void RefinementQueue::onFarmJobFinished(int jobId, int exitCode)
+{
+    if (jobId != farmJobId) return;
+    farmJobId = -1;
+    finishTranscribe(exitCode == 0);
+}
+
+void RefinementQueue::onProcessError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart || sender() != process) return;
+    emit logMessage("错误: 无法启动精修进程 " + process->program());
+    finishJob(false, QString());
+}
+
+void RefinementQueue::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (sender() != process) return;
+    bool ok = exitStatus == QProcess::NormalExit && exitCode == 0;
+
+    if (step == StepTranscribe) {
+        process->disconnect(this);
+        process->deleteLater();
+        process = nullptr;
+        finishTranscribe(ok);
+        return;
+    }
+
+    if (step == StepRender) {
+        if (ok && FileUtils::replaceFile(refinedVideoPath(), current.outputVideoPath)) {
+            finishJob(true, current.outputVideoPath);
+        } else {
+            QFile::remove(refinedVideoPath());
+            emit logMessage("后台精修: 视频渲染失败，保留草稿视频: " + current.outputVideoPath);
+            finishJob(false, QString());
+        }
+    }
+}
+
+/**
+ * @brief 转写结束 (单次进程或工作进程): 原子替换草稿字幕与文本稿，视频任务随后重新渲染
+ */
+void RefinementQueue::finishTranscribe(bool ok)
+{
+    QFileInfo refined(refinedSubtitlePath());
+    if (!ok || !refined.exists() || refined.size() == 0) {
+        emit logMessage("后台精修失败，保留草稿字幕: " + current.subtitlePath);
+        finishJob(false, QString());
+        return;
+    }
+    if (!FileUtils::replaceFile(refinedSubtitlePath(), current.subtitlePath)) {
+        emit logMessage("错误: 无法替换草稿字幕: " + current.subtitlePath);
+        finishJob(false, QString());
+        return;
+    }
+    if (!current.transcriptPath.isEmpty() && QFile::exists(refinedTranscriptPath())) {
+        FileUtils::replaceFile(refinedTranscriptPath(), current.transcriptPath);
+    }
+    if (current.outputVideoPath.isEmpty()) {
+        finishJob(true, current.subtitlePath);
+    } else {
+        startRender();
+    }
+}
+
+/**
+ * @brief 用精修后的字幕渲染最终硬字幕视频 (写入临时文件)
+ */
+void RefinementQueue::startRender()
+{
+    // 字幕复制到临时目录并用简单文件名引用，避免 subtitles 滤镜的路径转义问题
+    delete renderDir;
+    renderDir = new QTemporaryDir(QDir::temp().filePath("vsg_refine_XXXXXX"));
+    if (!renderDir->isValid() || !QFile::copy(current.subtitlePath, renderDir->filePath("refined.srt"))) {
+        emit logMessage("错误: 无法准备精修渲染目录");
+        finishJob(false, QString());
+        return;
+    }
+
+    QStringList args;
+    args << "-y" << "-v" << "error" << "-i" << QDir::toNativeSeparators(current.inputPath)
+         << "-vf" << "subtitles='refined.srt'" << current.encodeArgs << "-c:a" << "copy"
+         << QDir::toNativeSeparators(refinedVideoPath());
+    runStep(StepRender, "ffmpeg", args, renderDir->path());
+}
+
+/**
+ * @brief 结束当前精修: 按用户选项清理中间文件，然后开始下一个
+ */
+void RefinementQueue::finishJob(bool success, const QString &outputPath)
+{
+    if (process) {
+        process->disconnect(this);
+        process->deleteLater();
+        process = nullptr;
+    }
+    QFile::remove(refinedSubtitlePath());
+    if (!current.transcriptPath.isEmpty()) QFile::remove(refinedTranscriptPath());
+    delete renderDir;
+    renderDir = nullptr;
+    if (governor && leaseId) {
+        governor->release(leaseId);
+        leaseId = 0;
+    }
+
+    // 草稿阶段保留的中间文件 (仅转写任务的输入是源文件，字幕是最终产物，均不删除)
+    if (!current.outputVideoPath.isEmpty()) {
+        if (!current.keepAudio) QFile::remove(current.audioPath);
+        if (!current.keepSubtitle) QFile::remove(current.subtitlePath);
+    }
+
+    step = StepIdle;
+    emit jobFinished(current.inputPath, outputPath, success);
+    startNext();
+}
@@ -0,0 +1,135 @@
+#ifndef REFINEMENTQUEUE_H
+#define REFINEMENTQUEUE_H
+
+#include <QObject>
+#include <QProcess>
+#include <QQueue>
+#include <QStringList>
+#include <QTemporaryDir>
+
+class ResourceGovernor;
+class WorkerFarm;
+
+/**
+ * @brief 后台精修任务 (两级转写的第二级)
+ */
+struct RefinementJob {
+    QString inputPath;
+    QString audioPath;        // 转写输入 (中间 WAV，仅转写任务为源文件)
+    QString subtitlePath;     // 草稿字幕，精修后被替换
+    QString transcriptPath;   // 草稿文本稿 (仅转写任务)
+    QString outputVideoPath;  // 最终硬字幕视频 (仅转写任务为空)
+    QString model;            // 精修使用的 Whisper 模型
+    QStringList encodeArgs;   // 硬字幕渲染的视频编码参数
+    double durationSecs = 0;
+    bool keepAudio = false;     // 完成后保留中间 WAV
+    bool keepSubtitle = false;  // 完成后保留字幕 (视频任务)
+    bool allowDownload = false; // 本地模型仓库缺少模型时允许下载
+};
+
+/**
+ * @brief 后台精修队列
+ *
+ * 草稿输出后，用所选的大模型重新转写，逐个运行: 常驻工作进程池可用时提交给工作进程 (模型只加载一次)，
+ * 否则以较低的系统优先级启动单次转写进程。
+ * 结果先写入临时文件，完成后原子替换草稿字幕/文本稿；视频任务随后重新渲染硬字幕视频并原子替换草稿视频。
+ * 精修失败时保留草稿。
+ */
+class RefinementQueue : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数
+     * @param pythonProgram Python 解释器
+     * @param scriptPath transcribe.py 路径
+     * @param parent 父对象
+     */
+    RefinementQueue(const QString &pythonProgram, const QString &scriptPath, QObject *parent = nullptr);
+    ~RefinementQueue();
+
+    /**
+     * @brief 加入精修队列
+     */
+    void enqueue(const RefinementJob &job);
+
+    /**
+     * @brief 暂缓启动新的精修 (例如主流程正在占用 GPU 转写)，正在运行的精修不受影响
+     */
+    void setHeld(bool held);
+
+    /**
+     * @brief 设置资源调度器: 每个精修启动前申请内存与临时空间，不足时等待释放后重试
+     */
+    void setGovernor(ResourceGovernor *governor);
+
+    /**
+     * @brief 设置常驻工作进程池: 可用时转写提交给工作进程，不可用时回退到单次进程
+     */
+    void setWorkerFarm(WorkerFarm *farm);
+
+    /**
+     * @brief 终止当前精修并清空队列 (不等待)
+     */
+    void shutdown();
+
+    /**
+     * @brief 排队和运行中的精修数量
+     */
+    int pendingCount() const;
+
+    /**
+     * @brief 降低子进程的系统调度优先级 (需在 start 之前调用)
+     */
+    static void lowerPriority(QProcess *process);
+
+signals:
+    void logMessage(const QString &message);
+
+    /**
+     * @brief 精修结束
+     * @param inputPath 源文件
+     * @param outputPath 替换后的最终产物 (视频或字幕)
+     * @param success 是否成功 (失败时保留草稿)
+     */
+    void jobFinished(const QString &inputPath, const QString &outputPath, bool success);
+
+private slots:
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+    void onReadyRead();
+    void onFarmJobOutput(int jobId, const QString &line);
+    void onFarmJobFinished(int jobId, int exitCode);
+
+private:
+    enum Step {
+        StepIdle,
+        StepTranscribe,
+        StepRender
+    };
+
+    void startNext();
+    void finishTranscribe(bool ok);
+    void forwardOutputLine(const QString &line);
+    void startRender();
+    void finishJob(bool success, const QString &outputPath);
+    void runStep(Step nextStep, const QString &program, const QStringList &arguments, const QString &workDir);
+    QString refinedSubtitlePath() const;
+    QString refinedTranscriptPath() const;
+    QString refinedVideoPath() const;
+
+    QString pythonProgram;
+    QString scriptPath;
+    QQueue<RefinementJob> queue;
+    RefinementJob current;
+    Step step = StepIdle;
+    QProcess *process = nullptr;
+    QTemporaryDir *renderDir = nullptr;
+    bool held = false;
+    ResourceGovernor *governor = nullptr;
+    WorkerFarm *farm = nullptr;
+    int farmJobId = -1; // 提交给工作进程池的转写任务 (-1 表示无)
+    int leaseId = 0; // 当前精修的资源占用 (0 表示无)
+};
+
+#endif // REFINEMENTQUEUE_H
@@ -0,0 +1,277 @@
+#include "ResourceGovernor.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStorageInfo>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace {
+constexpr qint64 kMB = 1024 * 1024;
+
+// 各 Whisper 模型加载后的常驻内存 (CPU int8，含 Python 与推理库)，按 autotune/evaluate 实测取整
+qint64 whisperModelBytes(const QString &model)
+{
+    static const QHash<QString, qint64> sizes = {
+        {"tiny", 400 * kMB}, {"base", 550 * kMB}, {"small", 1100 * kMB},
+        {"medium", 2600 * kMB}, {"large", 4800 * kMB}
+    };
+    return sizes.value(model, 1100 * kMB);
+}
+}
+
+/**
+ * @brief 构造函数
+ */
+ResourceGovernor::ResourceGovernor(const QString &configPath, QObject *parent)
+    : QObject(parent)
+{
+    loadConfig(configPath);
+    sampleTimer.setInterval(kSampleIntervalMs);
+    connect(&sampleTimer, &QTimer::timeout, this, &ResourceGovernor::sample);
+}
+
+/**
+ * @brief 读取预算配置，不存在时写出默认值
+ * memoryMB 为 0 时取物理内存的 memoryFraction；scratchReserveMB 为中间文件写入后磁盘至少保留的空间
+ */
+void ResourceGovernor::loadConfig(const QString &path)
+{
+    QJsonObject root;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        root = QJsonDocument::fromJson(file.readAll()).object();
+    } else {
+        root["memoryMB"] = 0;
+        root["memoryFraction"] = 0.8;
+        root["scratchReserveMB"] = 1024;
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile out(path);
+        if (out.open(QIODevice::WriteOnly)) {
+            out.write(QJsonDocument(root).toJson());
+            out.commit();
+        }
+    }
+
+    budgetBytes = qint64(root["memoryMB"].toDouble()) * kMB;
+    if (budgetBytes <= 0) {
+        qint64 total = 0;
+        double fraction = qBound(0.1, root["memoryFraction"].toDouble(0.8), 1.0);
+        budgetBytes = systemMemory(&total, nullptr) ? qint64(total * fraction) : 0;
+    }
+    scratchReserveBytes = qMax<qint64>(0, qint64(root["scratchReserveMB"].toDouble(1024)) * kMB);
+}
+
+qint64 ResourceGovernor::estimateTranscribeMemory(const QString &engine, const QString &model, double audioSecs, bool includeModel)
+{
+    if (engine == "vosk") {
+        // Vosk 流式识别，内存与时长无关
+        return includeModel ? 350 * kMB : 50 * kMB;
+    }
+    // 整段音频以 float32 解码到内存 (64 KB/s)，VAD 与重试时另有一份副本
+    qint64 audioBytes = qint64(qMax(0.0, audioSecs) * 16000 * 4 * 2);
+    return (includeModel ? whisperModelBytes(model) : 0) + audioBytes;
+}
+
+qint64 ResourceGovernor::estimateRenderMemory()
+{
+    return 600 * kMB;
+}
+
+qint64 ResourceGovernor::estimateWavBytes(double audioSecs)
+{
+    return qint64(qMax(0.0, audioSecs) * 16000 * 2) + 44;
+}
+
+qint64 ResourceGovernor::memoryBudget() const
+{
+    return budgetBytes;
+}
+
+qint64 ResourceGovernor::effectiveMemory(const Lease &lease) const
+{
+    return qMax(lease.memoryBytes, lease.observedBytes);
+}
+
+qint64 ResourceGovernor::committedMemory() const
+{
+    qint64 total = residentBytes;
+    for (const Lease &lease : leases) {
+        total += effectiveMemory(lease);
+    }
+    return total;
+}
+
+/**
+ * @brief 已准入但尚未实际占用的内存 (估算 - 实测)，系统剩余内存中还要为它们留出空间
+ */
+qint64 ResourceGovernor::unrealizedMemory() const
+{
+    qint64 total = 0;
+    for (const Lease &lease : leases) {
+        total += qMax<qint64>(0, lease.memoryBytes - lease.observedBytes);
+    }
+    return total;
+}
+
+qint64 ResourceGovernor::reservedScratch(const QString &root) const
+{
+    qint64 total = 0;
+    for (const Lease &lease : leases) {
+        if (lease.scratchRoot == root) total += lease.scratchBytes;
+    }
+    return total;
+}
+
+bool ResourceGovernor::fits(qint64 memoryBytes, qint64 scratchBytes, const QString &scratchDir) const
+{
+    if (budgetBytes > 0 && committedMemory() + memoryBytes > budgetBytes) {
+        return false;
+    }
+    // 共享主机上其他进程也在使用内存: 新任务必须装得进系统当前剩余内存
+    qint64 available = 0;
+    if (systemMemory(nullptr, &available) && memoryBytes > available - unrealizedMemory()) {
+        return false;
+    }
+    if (scratchBytes > 0 && !scratchDir.isEmpty()) {
+        QStorageInfo storage(scratchDir);
+        if (storage.isValid()
+            && scratchBytes > storage.bytesAvailable() - reservedScratch(storage.rootPath()) - scratchReserveBytes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ResourceGovernor::tryAcquire(const QString &label, qint64 memoryBytes, qint64 scratchBytes, const QString &scratchDir)
+{
+    if (!leases.isEmpty() && !fits(memoryBytes, scratchBytes, scratchDir)) {
+        return 0;
+    }
+    if (leases.isEmpty() && !fits(memoryBytes, scratchBytes, scratchDir)) {
+        emit logMessage(QString("警告: %1 预计需要 %2 MB 内存 / %3 MB 临时空间，超出当前可用资源")
+                            .arg(label).arg(memoryBytes / kMB).arg(scratchBytes / kMB));
+    }
+
+    Lease lease;
+    lease.label = label;
+    lease.memoryBytes = memoryBytes;
+    lease.scratchBytes = scratchBytes;
+    if (scratchBytes > 0 && !scratchDir.isEmpty()) {
+        lease.scratchRoot = QStorageInfo(scratchDir).rootPath();
+    }
+    int id = nextLeaseId++;
+    leases.insert(id, lease);
+    if (!sampleTimer.isActive()) sampleTimer.start();
+    return id;
+}
+
+void ResourceGovernor::attachProcess(int leaseId, QProcess *process)
+{
+    auto it = leases.find(leaseId);
+    if (it == leases.end() || !process) return;
+    if (!it->processes.contains(process)) {
+        it->processes.append(process);
+    }
+}
+
+void ResourceGovernor::release(int leaseId)
+{
+    if (leases.remove(leaseId) == 0) return;
+    if (leases.isEmpty() && !residentProvider) sampleTimer.stop();
+    // 排队发出，调用方可以在释放后立即重新申请而不重入
+    QMetaObject::invokeMethod(this, &ResourceGovernor::capacityAvailable, Qt::QueuedConnection);
+}
+
+void ResourceGovernor::setResidentProcesses(std::function<QList<qint64>()> provider)
+{
+    residentProvider = std::move(provider);
+    if (residentProvider && !sampleTimer.isActive()) sampleTimer.start();
+}
+
+/**
+ * @brief 定时采样各占用关联进程的常驻内存
+ */
+void ResourceGovernor::sample()
+{
+    for (Lease &lease : leases) {
+        qint64 rss = 0;
+        for (const QPointer<QProcess> &process : lease.processes) {
+            if (process && process->state() == QProcess::Running) {
+                rss += qMax<qint64>(0, processRss(process->processId()));
+            }
+        }
+        lease.observedBytes = qMax(lease.observedBytes, rss);
+        if (!lease.overrunLogged && lease.observedBytes > lease.memoryBytes * 5 / 4) {
+            lease.overrunLogged = true;
+            emit logMessage(QString("资源: %1 实际内存 %2 MB 超出估算 %3 MB")
+                                .arg(lease.label).arg(lease.observedBytes / kMB).arg(lease.memoryBytes / kMB));
+        }
+    }
+
+    residentBytes = 0;
+    if (residentProvider) {
+        for (qint64 pid : residentProvider()) {
+            residentBytes += qMax<qint64>(0, processRss(pid));
+        }
+    }
+}
+
+qint64 ResourceGovernor::processRss(qint64 pid)
+{
+    if (pid <= 0) return -1;
+#ifdef Q_OS_WIN
+    HANDLE handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, DWORD(pid));
+    if (!handle) return -1;
+    PROCESS_MEMORY_COUNTERS counters;
+    qint64 rss = K32GetProcessMemoryInfo(handle, &counters, sizeof(counters)) ? qint64(counters.WorkingSetSize) : -1;
+    CloseHandle(handle);
+    return rss;
+#else
+    QFile file(QString("/proc/%1/status").arg(pid));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return -1;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    return -1;
+#endif
+}
+
+/**
+ * @brief 系统物理内存总量与当前可用量，无法获取时返回 false
+ */
+bool ResourceGovernor::systemMemory(qint64 *totalBytes, qint64 *availableBytes)
+{
+#ifdef Q_OS_WIN
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) return false;
+    if (totalBytes) *totalBytes = qint64(status.ullTotalPhys);
+    if (availableBytes) *availableBytes = qint64(status.ullAvailPhys);
+    return true;
+#else
+    QFile file("/proc/meminfo");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    qint64 total = -1, available = -1;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.startsWith("MemTotal:")) {
+            total = line.mid(9).trimmed().split(' ').first().toLongLong() * 1024;
+        } else if (line.startsWith("MemAvailable:")) {
+            available = line.mid(13).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    if (total < 0 || available < 0) return false;
+    if (totalBytes) *totalBytes = total;
+    if (availableBytes) *availableBytes = available;
+    return true;
+#endif
+}
@@ -0,0 +1,135 @@
+#ifndef RESOURCEGOVERNOR_H
+#define RESOURCEGOVERNOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QProcess>
+#include <QTimer>
+#include <functional>
+
+/**
+ * @brief 资源调度器 (内存与临时磁盘的准入控制)
+ *
+ * 每个并发工作 (主流程批次、后台精修等) 启动前按模型和媒体时长估算峰值内存与中间文件大小，
+ * 申请占用 (lease)；已占用量加上新申请不超过预算、且系统剩余内存和目标磁盘空间足够时才准入。
+ * 运行中定时读取子进程的实际常驻内存，每个占用按 max(估算, 实测) 计入，常驻工作进程按实测计入。
+ * 预算来自本机数据目录的 resource_budget.json (首次运行时写入默认值)。
+ * 没有任何占用时总是准入，避免超出预算的单个任务永远等待。
+ */
+class ResourceGovernor : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数，读取预算配置
+     * @param configPath resource_budget.json 路径
+     * @param parent 父对象
+     */
+    explicit ResourceGovernor(const QString &configPath, QObject *parent = nullptr);
+
+    /**
+     * @brief 转写任务的峰值内存估算 (字节)
+     * @param engine 引擎 (whisper / vosk)
+     * @param model Whisper 模型
+     * @param audioSecs 一次加载的音频总时长 (批量时为整批)
+     * @param includeModel 是否计入模型本身 (模型由常驻工作进程持有时不计入，按进程实测计入)
+     */
+    static qint64 estimateTranscribeMemory(const QString &engine, const QString &model, double audioSecs, bool includeModel = true);
+
+    /**
+     * @brief 硬字幕渲染 (ffmpeg + libx264) 的峰值内存估算 (字节)
+     */
+    static qint64 estimateRenderMemory();
+
+    /**
+     * @brief 提取的中间 WAV 大小 (16kHz 单声道 16 位)
+     */
+    static qint64 estimateWavBytes(double audioSecs);
+
+    /**
+     * @brief 申请占用
+     * @param label 名称 (用于日志)
+     * @param memoryBytes 峰值内存估算
+     * @param scratchBytes 中间文件大小估算
+     * @param scratchDir 中间文件所在目录 (用于检查磁盘空间)
+     * @return 占用 ID，资源不足时返回 0 (释放资源时发出 capacityAvailable，调用方重试)
+     */
+    int tryAcquire(const QString &label, qint64 memoryBytes, qint64 scratchBytes = 0, const QString &scratchDir = QString());
+
+    /**
+     * @brief 当前是否能准入 (不占用)
+     */
+    bool fits(qint64 memoryBytes, qint64 scratchBytes = 0, const QString &scratchDir = QString()) const;
+
+    /**
+     * @brief 把子进程关联到占用，定时统计其实际常驻内存
+     */
+    void attachProcess(int leaseId, QProcess *process);
+
+    /**
+     * @brief 释放占用
+     */
+    void release(int leaseId);
+
+    /**
+     * @brief 常驻进程 (例如工作进程池) 的 PID 来源，这些进程按实测内存计入
+     */
+    void setResidentProcesses(std::function<QList<qint64>()> provider);
+
+    /**
+     * @brief 内存预算 (字节)，0 表示不限
+     */
+    qint64 memoryBudget() const;
+
+    /**
+     * @brief 当前计入的内存 (字节)
+     */
+    qint64 committedMemory() const;
+
+    /**
+     * @brief 进程的常驻内存 (字节)，无法读取时返回 -1
+     */
+    static qint64 processRss(qint64 pid);
+
+signals:
+    /**
+     * @brief 有占用被释放，等待中的工作可以重试
+     */
+    void capacityAvailable();
+
+    void logMessage(const QString &message);
+
+private slots:
+    void sample();
+
+private:
+    struct Lease {
+        QString label;
+        qint64 memoryBytes = 0;
+        qint64 scratchBytes = 0;
+        QString scratchRoot;     // 中间文件所在卷的根路径
+        qint64 observedBytes = 0; // 关联进程的实测峰值
+        QList<QPointer<QProcess>> processes;
+        bool overrunLogged = false;
+    };
+
+    void loadConfig(const QString &path);
+    qint64 effectiveMemory(const Lease &lease) const;
+    qint64 unrealizedMemory() const;
+    qint64 reservedScratch(const QString &root) const;
+    static bool systemMemory(qint64 *totalBytes, qint64 *availableBytes);
+
+    QHash<int, Lease> leases;
+    int nextLeaseId = 1;
+    qint64 budgetBytes = 0;
+    qint64 scratchReserveBytes = 0;
+    qint64 residentBytes = 0;
+    std::function<QList<qint64>()> residentProvider;
+    QTimer sampleTimer;
+
+    static constexpr int kSampleIntervalMs = 2000;
+};
+
+#endif // RESOURCEGOVERNOR_H
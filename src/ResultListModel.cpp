@@ -0,0 +1,34 @@
+#include "ResultListModel.h"
+#include <QColor>
+
+ResultListModel::ResultListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int ResultListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : entries.size();
+}
+
+QVariant ResultListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= entries.size()) return QVariant();
+    const Entry &entry = entries[index.row()];
+
+    if (role == Qt::DisplayRole || role == Qt::ToolTipRole) {
+        return entry.text;
+    }
+    if (role == Qt::ForegroundRole) {
+        return entry.success ? QColor(Qt::darkGreen) : QColor(Qt::red);
+    }
+    return QVariant();
+}
+
+void ResultListModel::addResult(const QString &text, bool success)
+{
+    int row = entries.size();
+    beginInsertRows(QModelIndex(), row, row);
+    entries.append({text, success});
+    endInsertRows();
+}
@@ -0,0 +1,35 @@
+#ifndef RESULTLISTMODEL_H
+#define RESULTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief 处理结果列表的数据模型 (成功绿色，失败红色)
+ */
+class ResultListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit ResultListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief 追加一条结果
+     * @param text 显示文本
+     * @param success 是否成功
+     */
+    void addResult(const QString &text, bool success);
+
+private:
+    struct Entry {
+        QString text;
+        bool success;
+    };
+    QList<Entry> entries;
+};
+
+#endif // RESULTLISTMODEL_H
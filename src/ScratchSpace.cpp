@@ -0,0 +1,108 @@
+#include "ScratchSpace.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QStorageInfo>
+
+/**
+ * @brief 构造函数: 读取配置 (不存在时写出默认值)，清理遗留目录并创建本进程的临时目录
+ */
+ScratchSpace::ScratchSpace(const QString &configPath, QObject *parent)
+    : QObject(parent)
+{
+    QJsonObject config;
+    QFile file(configPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        config = QJsonDocument::fromJson(file.readAll()).object();
+    } else {
+        config["dir"] = "";        // 空表示自动选择 (Linux 下为 /dev/shm)
+        config["quotaMB"] = 2048;  // 0 表示不使用临时目录，中间文件写入输出目录
+        config["minFreeMB"] = 512; // 临时目录所在文件系统至少保留的空间
+        QDir().mkpath(QFileInfo(configPath).absolutePath());
+        QSaveFile out(configPath);
+        if (out.open(QIODevice::WriteOnly)) {
+            out.write(QJsonDocument(config).toJson());
+            out.commit();
+        }
+    }
+    quotaBytes = qint64(qMax(0.0, config["quotaMB"].toDouble(2048))) * 1024 * 1024;
+    minFreeBytes = qint64(qMax(0.0, config["minFreeMB"].toDouble(512))) * 1024 * 1024;
+    if (quotaBytes <= 0) return;
+
+    QString base = config["dir"].toString();
+    if (base.isEmpty()) {
+        QFileInfo shm("/dev/shm");
+        base = shm.isDir() && shm.isWritable() ? shm.absoluteFilePath() : QDir::tempPath();
+    }
+    if (!QDir().mkpath(base)) return;
+    removeStaleDirs(base);
+
+    QString dir = QDir(base).filePath(QString("vsg-scratch-%1").arg(QCoreApplication::applicationPid()));
+    lock = new QLockFile(dir + ".lock");
+    if (!lock->tryLock(0) || !QDir().mkpath(dir)) {
+        delete lock;
+        lock = nullptr;
+        return;
+    }
+    root = dir;
+    QByteArray type = QStorageInfo(dir).fileSystemType();
+    memoryBacked = type == "tmpfs" || type == "ramfs";
+}
+
+ScratchSpace::~ScratchSpace()
+{
+    if (!root.isEmpty()) {
+        QDir(root).removeRecursively();
+    }
+    delete lock; // 析构时删除 .lock
+}
+
+/**
+ * @brief 删除已退出进程遗留的临时目录 (.lock 能被获取说明持有者已不存在)
+ */
+void ScratchSpace::removeStaleDirs(const QString &base)
+{
+    const QFileInfoList locks = QDir(base).entryInfoList(QStringList() << "vsg-scratch-*.lock", QDir::Files);
+    for (const QFileInfo &info : locks) {
+        QLockFile stale(info.absoluteFilePath());
+        stale.setStaleLockTime(0); // 只按持有进程是否存在判断，运行中的其他实例不受影响
+        if (!stale.tryLock(0)) continue;
+        QString dir = info.absolutePath() + "/" + info.completeBaseName();
+        QDir(dir).removeRecursively();
+        stale.unlock();
+    }
+}
+
+bool ScratchSpace::fits(qint64 bytes) const
+{
+    if (root.isEmpty() || reservedTotal + bytes > quotaBytes) return false;
+    // 已分配的配额按尚未写入计算 (偏保守)
+    QStorageInfo storage(root);
+    return storage.bytesAvailable() - reservedTotal - bytes >= minFreeBytes;
+}
+
+QString ScratchSpace::allocate(qint64 bytes)
+{
+    if (!fits(bytes)) return QString();
+    QString dir = QDir(root).filePath(QString("task-%1").arg(nextId++));
+    if (!QDir().mkpath(dir)) return QString();
+    reserved.insert(dir, bytes);
+    reservedTotal += bytes;
+    return dir;
+}
+
+void ScratchSpace::release(const QString &dir)
+{
+    auto it = reserved.find(dir);
+    if (it == reserved.end()) return;
+    reservedTotal -= it.value();
+    reserved.erase(it);
+    if (!QDir(dir).removeRecursively()) {
+        emit logMessage("警告: 无法删除临时目录: " + dir);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef SCRATCHSPACE_H
+#define SCRATCHSPACE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+class QLockFile;
+
+/**
+ * @brief 中间文件的临时目录 (内存盘)
+ *
+ * 提取的 WAV、转写的 SRT 等中间文件放在本地临时目录 (Linux 下默认 /dev/shm，其他平台为系统临时目录)，
+ * 输出目录 (常为网络存储) 只写入最终产物和用户选择导出的文件。
+ * - 每个任务分配一个子目录，按预估大小占用配额，配额或剩余空间不足时返回空 (调用方回退为输出目录)；
+ * - 本进程的目录为 <dir>/vsg-scratch-<pid>，由同名 .lock 文件标记，启动时清理已退出进程遗留的目录；
+ * - 任务结束时释放子目录，退出时删除整个目录。
+ * 临时目录、配额和最小剩余空间来自 scratch.json (首次启动时写入默认值)。
+ */
+class ScratchSpace : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数
+     * @param configPath scratch.json 路径
+     * @param parent 父对象
+     */
+    explicit ScratchSpace(const QString &configPath, QObject *parent = nullptr);
+    ~ScratchSpace();
+
+    /**
+     * @brief 是否可用 (配额为 0 或目录无法创建时不可用)
+     */
+    bool isAvailable() const { return !root.isEmpty(); }
+
+    /**
+     * @brief 本进程的临时目录
+     */
+    QString path() const { return root; }
+
+    /**
+     * @brief 临时目录是否占用内存 (tmpfs/ramfs)，此时写入的文件应计入内存预算
+     */
+    bool isMemoryBacked() const { return memoryBacked; }
+
+    /**
+     * @brief 配额和剩余空间能否再容纳 bytes
+     */
+    bool fits(qint64 bytes) const;
+
+    /**
+     * @brief 分配任务子目录
+     * @param bytes 预估写入量，计入配额直到释放
+     * @return 子目录路径，不可用或放不下时为空
+     */
+    QString allocate(qint64 bytes);
+
+    /**
+     * @brief 删除子目录并归还配额
+     */
+    void release(const QString &dir);
+
+signals:
+    void logMessage(const QString &message);
+
+private:
+    void removeStaleDirs(const QString &base);
+
+    QString root;              // 本进程的临时目录，不可用时为空
+    QLockFile *lock = nullptr;
+    bool memoryBacked = false;
+    qint64 quotaBytes = 0;
+    qint64 minFreeBytes = 0;
+    QHash<QString, qint64> reserved; // 子目录 -> 预估大小
+    qint64 reservedTotal = 0;
+    int nextId = 1;
+};
+
+#endif // SCRATCHSPACE_H
@@ -0,0 +1,538 @@
+#include "SmartRenderer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <algorithm>
+
+/**
+ * @brief "00:01:02,345" -> 秒
+ */
+static double parseSrtTime(const QString &text)
+{
+    static const QRegularExpression re("(\\d+):(\\d+):(\\d+)[,.](\\d+)");
+    QRegularExpressionMatch match = re.match(text);
+    if (!match.hasMatch()) return -1;
+    return match.captured(1).toInt() * 3600 + match.captured(2).toInt() * 60
+        + match.captured(3).toInt() + match.captured(4).left(3).toInt() / 1000.0;
+}
+
+static QString formatSrtTime(double secs)
+{
+    qint64 ms = qMax<qint64>(0, qint64(secs * 1000 + 0.5));
+    return QString("%1:%2:%3,%4")
+        .arg(ms / 3600000, 2, 10, QChar('0'))
+        .arg((ms / 60000) % 60, 2, 10, QChar('0'))
+        .arg((ms / 1000) % 60, 2, 10, QChar('0'))
+        .arg(ms % 1000, 3, 10, QChar('0'));
+}
+
+SmartRenderer::SmartRenderer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SmartRenderer::~SmartRenderer()
+{
+    cancel();
+}
+
+/**
+ * @brief 解析 SRT (序号行 / 时间轴行 / 文本行，空行分隔)
+ */
+QList<SmartRenderer::Cue> SmartRenderer::parseSrt(const QString &path)
+{
+    QList<Cue> result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return result;
+
+    const QStringList blocks = QString::fromUtf8(file.readAll()).split(QRegularExpression("\\n\\s*\\n"), Qt::SkipEmptyParts);
+    for (const QString &block : blocks) {
+        QStringList lines = block.trimmed().split('\n');
+        int timeLine = -1;
+        for (int i = 0; i < lines.size() && i < 2; ++i) {
+            if (lines[i].contains("-->")) {
+                timeLine = i;
+                break;
+            }
+        }
+        if (timeLine < 0) continue;
+
+        QStringList times = lines[timeLine].split("-->");
+        Cue cue;
+        cue.start = parseSrtTime(times.value(0));
+        cue.end = parseSrtTime(times.value(1));
+        if (cue.start < 0 || cue.end <= cue.start) continue;
+        cue.text = lines.mid(timeLine + 1).join('\n').trimmed();
+        result.append(cue);
+    }
+    return result;
+}
+
+/**
+ * @brief 按关键帧规划片段
+ */
+QList<SmartRenderer::Segment> SmartRenderer::plan(const QList<double> &keyframes, double durationSecs, const QList<Cue> &cues, double minCopySecs)
+{
+    QList<Segment> result;
+    if (keyframes.isEmpty() || durationSecs <= 0) return result;
+
+    // 合并重叠的字幕区间，保证区间单调，便于与 GOP 双指针比较
+    QList<QPair<double, double>> spans;
+    for (const Cue &cue : cues) spans.append(qMakePair(cue.start, cue.end));
+    std::sort(spans.begin(), spans.end());
+    QList<QPair<double, double>> merged;
+    for (const auto &span : spans) {
+        if (!merged.isEmpty() && span.first <= merged.last().second) {
+            merged.last().second = qMax(merged.last().second, span.second);
+        } else {
+            merged.append(span);
+        }
+    }
+
+    // GOP i = [keyframes[i], keyframes[i+1])，第一个 GOP 从 0 开始
+    int c = 0;
+    for (int i = 0; i < keyframes.size(); ++i) {
+        double start = (i == 0) ? 0.0 : keyframes[i];
+        double end = (i + 1 < keyframes.size()) ? keyframes[i + 1] : durationSecs;
+        if (end <= start) continue;
+
+        while (c < merged.size() && merged[c].second <= start) c++;
+        bool dirty = c < merged.size() && merged[c].first < end;
+
+        if (!result.isEmpty() && result.last().reencode == dirty) {
+            result.last().end = end;
+        } else {
+            result.append({start, end, dirty});
+        }
+    }
+
+    // 两段重新编码之间过短的复制片段并入，减少切分和进程数
+    for (int i = 1; i + 1 < result.size(); ++i) {
+        if (!result[i].reencode && result[i].end - result[i].start < minCopySecs) {
+            result[i].reencode = true;
+        }
+    }
+    QList<Segment> coalesced;
+    for (const Segment &segment : result) {
+        if (!coalesced.isEmpty() && coalesced.last().reencode == segment.reencode) {
+            coalesced.last().end = segment.end;
+        } else {
+            coalesced.append(segment);
+        }
+    }
+    return coalesced;
+}
+
+qint64 SmartRenderer::estimateWorkBytes(qint64 sourceBytes)
+{
+    // 重新编码的比例不超过 kMaxReencodeRatio (超过时放弃)，另留字幕和清单的余量
+    return qint64(sourceBytes * (1.0 + kMaxReencodeRatio)) + 16 * 1024 * 1024;
+}
+
+/**
+ * @brief 开始渲染: 第一步读取视频流编码和关键帧
+ */
+void SmartRenderer::start(const QString &inputPath, const QString &subtitlePath, const QString &outputPath, const QStringList &encodeArgs,
+                          const QString &workParent)
+{
+    cancel();
+    this->inputPath = inputPath;
+    this->subtitlePath = subtitlePath;
+    this->outputPath = outputPath;
+    this->encodeArgs = encodeArgs;
+
+    workDir = new QTemporaryDir(QDir(workParent).filePath("vsg_smart_XXXXXX"));
+    if (!workDir->isValid()) {
+        fail("无法创建临时目录");
+        return;
+    }
+
+    cues = parseSrt(subtitlePath);
+    if (cues.isEmpty()) {
+        fail("字幕为空");
+        return;
+    }
+
+    // 只读取包信息 (不解码)，带 K 标记的即关键帧；包按解码顺序输出，用于区分 IDR 和开放 GOP 的 I 帧
+    QStringList args;
+    args << "-v" << "error" << "-select_streams" << "v:0"
+         << "-show_entries" << "stream=codec_name,pix_fmt,profile,level,refs,has_b_frames:format=duration,start_time:packet=pts_time,flags"
+         << "-of" << "compact" << QDir::toNativeSeparators(inputPath);
+    runStep(StepProbe, "ffprobe", args);
+}
+
+void SmartRenderer::cancel()
+{
+    if (process) {
+        process->disconnect(this);
+        connect(process, &QProcess::finished, process, &QObject::deleteLater);
+        process->kill();
+        process = nullptr;
+    }
+    reset();
+}
+
+void SmartRenderer::reset()
+{
+    step = StepIdle;
+    delete workDir; // 自动删除临时目录
+    workDir = nullptr;
+    keyframes.clear();
+    cues.clear();
+    segments.clear();
+    videoCodec.clear();
+    pixelFormat.clear();
+    profile.clear();
+    level = 0;
+    refs = 0;
+    hasBFrames = -1;
+    durationSecs = 0;
+    encodeIndex = 0;
+    reencodeSecs = 0;
+    encodedSecs = 0;
+}
+
+void SmartRenderer::fail(const QString &reason)
+{
+    if (process) {
+        process->disconnect(this);
+        process->deleteLater();
+        process = nullptr;
+    }
+    reset();
+    emit finished(false, reason);
+}
+
+/**
+ * @brief 启动一个步骤的子进程 (在临时目录中运行，字幕滤镜只需使用简单的相对文件名)
+ */
+void SmartRenderer::runStep(Step nextStep, const QString &program, const QStringList &arguments)
+{
+    step = nextStep;
+    if (!process) {
+        process = new QProcess(this);
+        connect(process, &QProcess::finished, this, &SmartRenderer::onProcessFinished);
+        connect(process, &QProcess::errorOccurred, this, &SmartRenderer::onProcessError, Qt::QueuedConnection);
+    }
+    // 探测输出较大 (每个视频包一行)，其余步骤只需要错误信息
+    if (nextStep == StepProbe) {
+        process->setProcessChannelMode(QProcess::SeparateChannels);
+    } else {
+        process->setProcessChannelMode(QProcess::MergedChannels);
+    }
+    process->setWorkingDirectory(workDir->path());
+    process->start(program, arguments);
+}
+
+void SmartRenderer::onProcessError(QProcess::ProcessError error)
+{
+    // 其他错误会伴随 finished 信号
+    if (error != QProcess::FailedToStart || sender() != process) return;
+    fail("无法启动 " + process->program());
+}
+
+void SmartRenderer::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (sender() != process) return;
+
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        QString output = QString::fromUtf8(process->readAllStandardError() + process->readAll()).trimmed();
+        fail(QString("%1 失败: %2").arg(process->program(), output.right(300)));
+        return;
+    }
+
+    switch (step) {
+    case StepProbe:
+        onProbeDone(process->readAllStandardOutput());
+        break;
+    case StepSplit:
+        emit progress(0.1);
+        encodeIndex = 0;
+        startNextEncode();
+        break;
+    case StepEncode:
+        encodedSecs += segments[encodeIndex].end - segments[encodeIndex].start;
+        if (reencodeSecs > 0) emit progress(0.1 + 0.8 * encodedSecs / reencodeSecs);
+        encodeIndex++;
+        startNextEncode();
+        break;
+    case StepConcat:
+        emit progress(0.92);
+        startVerify();
+        break;
+    case StepVerify: {
+        // -v error 下任何输出都说明有片段解码出错 (如参数集冲突、缺少参考帧)
+        QString errors = QString::fromUtf8(process->readAll()).trimmed();
+        if (!errors.isEmpty()) {
+            fail("拼接结果校验失败: " + errors.left(300));
+            return;
+        }
+        emit progress(1.0);
+        reset();
+        emit finished(true, QString());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 解析探测结果并规划片段
+ */
+void SmartRenderer::onProbeDone(const QByteArray &output)
+{
+    // compact 格式: "packet|pts_time=1.001000|flags=K__"、"stream|codec_name=h264|pix_fmt=yuv420p|..."
+    double startTime = 0;
+    QList<QPair<double, bool>> packets; // 解码顺序的 (显示时间, 是否带 K 标记)
+    const QList<QByteArray> lines = output.split('\n');
+    for (const QByteArray &rawLine : lines) {
+        QString line = QString::fromUtf8(rawLine).trimmed();
+        QStringList fields = line.split('|');
+        if (fields.isEmpty()) continue;
+
+        QHash<QString, QString> values;
+        for (int i = 1; i < fields.size(); ++i) {
+            int eq = fields[i].indexOf('=');
+            if (eq > 0) values.insert(fields[i].left(eq), fields[i].mid(eq + 1));
+        }
+
+        if (fields[0] == "packet") {
+            bool ok;
+            double t = values.value("pts_time").toDouble(&ok);
+            if (ok) packets.append(qMakePair(t, values.value("flags").contains('K')));
+        } else if (fields[0] == "stream") {
+            videoCodec = values.value("codec_name");
+            pixelFormat = values.value("pix_fmt");
+            profile = values.value("profile");
+            level = values.value("level").toInt();
+            refs = values.value("refs").toInt();
+            hasBFrames = values.value("has_b_frames", "-1").toInt();
+        } else if (fields[0] == "format") {
+            durationSecs = values.value("duration").toDouble();
+            startTime = values.value("start_time").toDouble();
+        }
+    }
+    // 只在 IDR 处切分: MKV/TS 中开放 GOP 的 I 帧同样带 K 标记，但按解码顺序其后还有显示时间更早的前导帧，
+    // 这些帧参考上一个 GOP，单独复制出来无法解码。IDR 之后的帧不会显示在它之前。
+    for (int i = 0; i < packets.size(); ++i) {
+        if (!packets[i].second) continue;
+        bool leading = false;
+        for (int j = i + 1; j < packets.size() && !packets[j].second; ++j) {
+            if (packets[j].first < packets[i].first) {
+                leading = true;
+                break;
+            }
+        }
+        if (!leading) keyframes.append(packets[i].first);
+    }
+
+    // 切分和字幕都以 0 起始的时间轴为准，关键帧时间减去容器起始时间
+    for (double &t : keyframes) t -= startTime;
+    std::sort(keyframes.begin(), keyframes.end());
+    keyframes.erase(std::unique(keyframes.begin(), keyframes.end()), keyframes.end());
+
+    // 复制片段与重新编码片段需要能直接拼接，只支持与编码器一致的 H.264 源
+    if (videoCodec != "h264") {
+        fail(QString("源视频编码为 %1，仅支持 H.264").arg(videoCodec.isEmpty() ? QString("未知") : videoCodec));
+        return;
+    }
+    if (keyframes.size() < 2 || durationSecs <= 0) {
+        fail("无法读取关键帧");
+        return;
+    }
+
+    segments = plan(keyframes, durationSecs, cues, kMinCopySecs);
+    reencodeSecs = 0;
+    for (const Segment &segment : segments) {
+        if (segment.reencode) reencodeSecs += segment.end - segment.start;
+    }
+    double ratio = reencodeSecs / durationSecs;
+    emit logMessage(QString("智能渲染: %1 个片段，重新编码 %2 秒 / 共 %3 秒 (%4%)")
+        .arg(segments.size()).arg(reencodeSecs, 0, 'f', 1).arg(durationSecs, 0, 'f', 1).arg(int(ratio * 100)));
+
+    if (ratio > kMaxReencodeRatio) {
+        fail(QString("字幕覆盖 %1% 的画面，完整渲染更快").arg(int(ratio * 100)));
+        return;
+    }
+    if (segments.size() > kMaxSegments) {
+        fail(QString("片段过多 (%1)").arg(segments.size()));
+        return;
+    }
+    startSplit();
+}
+
+/**
+ * @brief 按片段边界一次性切分视频流 (流复制，边界均为关键帧)
+ */
+void SmartRenderer::startSplit()
+{
+    QStringList times;
+    for (int i = 1; i < segments.size(); ++i) {
+        times << QString::number(segments[i].start, 'f', 6);
+    }
+
+    QStringList args;
+    args << "-y" << "-v" << "error" << "-i" << QDir::toNativeSeparators(inputPath)
+         << "-map" << "0:v:0" << "-c" << "copy" << "-bsf:v" << "h264_mp4toannexb"
+         << "-f" << "segment" << "-segment_format" << "mpegts" << "-reset_timestamps" << "1";
+    if (!times.isEmpty()) {
+        args << "-segment_times" << times.join(',');
+    }
+    args << "part_%05d.ts";
+    runStep(StepSplit, "ffmpeg", args);
+}
+
+QString SmartRenderer::partName(int index) const
+{
+    return QString("part_%1.ts").arg(index, 5, 10, QChar('0'));
+}
+
+QString SmartRenderer::encodedName(int index) const
+{
+    return QString("enc_%1.ts").arg(index, 5, 10, QChar('0'));
+}
+
+/**
+ * @brief 写出片段内的字幕 (时间平移到片段起点)
+ */
+bool SmartRenderer::writeSegmentSubtitles(int index) const
+{
+    const Segment &segment = segments[index];
+    QFile file(QDir(workDir->path()).filePath(QString("sub_%1.srt").arg(index, 5, 10, QChar('0'))));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf8);
+    int count = 1;
+    for (const Cue &cue : cues) {
+        if (cue.end <= segment.start || cue.start >= segment.end) continue;
+        double start = qMax(cue.start, segment.start) - segment.start;
+        double end = qMin(cue.end, segment.end) - segment.start;
+        out << count++ << "\n" << formatSrtTime(start) << " --> " << formatSrtTime(end) << "\n" << cue.text << "\n\n";
+    }
+    return true;
+}
+
+/**
+ * @brief 重新编码下一个需要字幕的片段，全部完成后拼接
+ */
+void SmartRenderer::startNextEncode()
+{
+    if (encodeIndex == 0) {
+        // 切分结果必须与规划一一对应，否则时间轴会错位
+        for (int i = 0; i < segments.size(); ++i) {
+            if (!QFile::exists(QDir(workDir->path()).filePath(partName(i)))) {
+                fail(QString("切分结果与规划不一致 (缺少片段 %1)").arg(i));
+                return;
+            }
+        }
+        if (QFile::exists(QDir(workDir->path()).filePath(partName(segments.size())))) {
+            fail("切分结果与规划不一致 (片段过多)");
+            return;
+        }
+    }
+
+    while (encodeIndex < segments.size() && !segments[encodeIndex].reencode) {
+        encodeIndex++;
+    }
+    if (encodeIndex >= segments.size()) {
+        startConcat();
+        return;
+    }
+
+    if (!writeSegmentSubtitles(encodeIndex)) {
+        fail("无法写入片段字幕");
+        return;
+    }
+
+    // 直接解码切分出的片段，帧集合与复制片段严格互补
+    QStringList args;
+    args << "-y" << "-v" << "error" << "-i" << partName(encodeIndex)
+         << "-vf" << QString("subtitles='sub_%1.srt'").arg(encodeIndex, 5, 10, QChar('0'))
+         << encodeArgs << sourceMatchArgs();
+    if (!pixelFormat.isEmpty()) {
+        args << "-pix_fmt" << pixelFormat;
+    }
+    args << "-fps_mode" << "passthrough" << "-an" << "-f" << "mpegts" << encodedName(encodeIndex);
+    runStep(StepEncode, "ffmpeg", args);
+}
+
+/**
+ * @brief 拼接全部片段并混入原音频
+ */
+void SmartRenderer::startConcat()
+{
+    QFile list(QDir(workDir->path()).filePath("concat.txt"));
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        fail("无法写入拼接列表");
+        return;
+    }
+    for (int i = 0; i < segments.size(); ++i) {
+        list.write(QString("file '%1'\n").arg(segments[i].reencode ? encodedName(i) : partName(i)).toUtf8());
+    }
+    list.close();
+
+    QStringList args;
+    args << "-y" << "-v" << "error" << "-f" << "concat" << "-safe" << "0" << "-i" << "concat.txt"
+         << "-i" << QDir::toNativeSeparators(inputPath)
+         << "-map" << "0:v:0" << "-map" << "1:a:0?" << "-c" << "copy";
+    // MP4/MOV 只有一份 avcC，重新编码片段的 SPS/PPS 与源视频不同；
+    // 标记为 avc3 后播放器以码流中的参数集为准 (每个片段的 IDR 前都有)
+    static const QStringList isoSuffixes = {"mp4", "m4v", "mov"};
+    if (isoSuffixes.contains(QFileInfo(outputPath).suffix().toLower())) {
+        args << "-tag:v" << "avc3";
+    }
+    args << QDir::toNativeSeparators(outputPath);
+    runStep(StepConcat, "ffmpeg", args);
+}
+
+/**
+ * @brief 完整解码一遍拼接结果 (不编码，耗时远小于渲染)，确认复制片段与重新编码片段衔接处可以正常解码
+ */
+void SmartRenderer::startVerify()
+{
+    QStringList args;
+    args << "-v" << "error" << "-xerror" << "-i" << QDir::toNativeSeparators(outputPath)
+         << "-map" << "0:v:0" << "-f" << "null" << "-";
+    runStep(StepVerify, "ffmpeg", args);
+}
+
+/**
+ * @brief 使重新编码片段与源视频的流参数一致的编码选项
+ *
+ * 各片段的参数集在码流中 (MP4/MOV 以 avc3 封装，见 startConcat)，每个 IDR 前重复参数集，
+ * 切换到重新编码片段时解码器能立即拿到新的参数集；profile、level 和参考帧数与源视频一致，
+ * 按第一份参数集分配解码缓冲的播放器也够用。
+ */
+QStringList SmartRenderer::sourceMatchArgs() const
+{
+    QStringList args;
+    if (!encodeArgs.contains("libx264")) return args;
+
+    static const QHash<QString, QString> profiles = {
+        {"Constrained Baseline", "baseline"}, {"Baseline", "baseline"}, {"Main", "main"},
+        {"High", "high"}, {"High 10", "high10"}, {"High 4:2:2", "high422"}, {"High 4:4:4 Predictive", "high444"}
+    };
+    QString x264Profile = profiles.value(profile);
+    if (!x264Profile.isEmpty()) {
+        args << "-profile:v" << x264Profile;
+    }
+    if (level > 0) {
+        args << "-level" << QString("%1.%2").arg(level / 10).arg(level % 10);
+    }
+
+    QStringList params;
+    params << "repeat-headers=1";
+    if (refs > 0) {
+        params << QString("ref=%1").arg(refs);
+    }
+    if (hasBFrames == 0) {
+        params << "bframes=0";
+    }
+    args << "-x264-params" << params.join(':');
+    return args;
+}
@@ -0,0 +1,158 @@
+#ifndef SMARTRENDERER_H
+#define SMARTRENDERER_H
+
+#include <QObject>
+#include <QList>
+#include <QProcess>
+#include <QStringList>
+#include <QTemporaryDir>
+
+/**
+ * @brief 智能渲染 (硬字幕)
+ *
+ * 把字幕时间段映射到源视频的关键帧 (GOP) 结构上: 只有与字幕重叠的 GOP 解码并重新编码叠加字幕，
+ * 其余 GOP 直接流复制，最后拼接并混入原音频。对白稀疏的视频可以省去大部分编码开销。
+ *
+ * 流程 (全部异步):
+ * 1. ffprobe 读取视频流编码参数和全部关键帧时间 (只在 IDR 处切分，开放 GOP 的 I 帧不作为边界)
+ * 2. 规划片段 (重新编码 / 复制)
+ * 3. ffmpeg segment 复用器按片段边界一次性切分 (流复制)
+ * 4. 逐个重新编码需要字幕的片段 (每个片段使用平移后的 SRT，profile/level/参考帧数与源视频一致)
+ * 5. concat 拼接，混入原音频
+ * 6. 完整解码一遍拼接结果，有解码错误时放弃
+ *
+ * 任一步失败或不适合 (非 H.264、字幕覆盖过多等) 时发出 finished(false)，由调用方回退为完整渲染。
+ */
+class SmartRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Cue {
+        double start;
+        double end;
+        QString text;
+    };
+
+    struct Segment {
+        double start;
+        double end;
+        bool reencode; // 与字幕重叠，需要重新编码
+    };
+
+    explicit SmartRenderer(QObject *parent = nullptr);
+    ~SmartRenderer();
+
+    /**
+     * @brief 开始渲染
+     * @param inputPath 源视频
+     * @param subtitlePath 字幕 (SRT)
+     * @param outputPath 输出视频
+     * @param encodeArgs 视频编码参数 (如 -c:v libx264 -preset fast)，需与完整渲染一致
+     * @param workParent 中间文件 (切分的片段、重新编码的片段、拼接清单) 所在目录，在其中创建临时子目录
+     */
+    void start(const QString &inputPath, const QString &subtitlePath, const QString &outputPath, const QStringList &encodeArgs,
+               const QString &workParent);
+
+    /**
+     * @brief 中间文件的最大占用: 流复制切分出的全部片段 (约等于源文件) 加上重新编码的片段
+     * @param sourceBytes 源文件大小
+     */
+    static qint64 estimateWorkBytes(qint64 sourceBytes);
+
+    /**
+     * @brief 终止当前渲染 (不发出 finished)
+     */
+    void cancel();
+
+    bool isRunning() const { return step != StepIdle; }
+
+    /**
+     * @brief 当前步骤的 FFmpeg 进程 PID (用于挂起/恢复)，没有运行中的进程时返回 0
+     */
+    qint64 processId() const { return process && process->state() == QProcess::Running ? process->processId() : 0; }
+
+    /**
+     * @brief 解析 SRT 字幕
+     */
+    static QList<Cue> parseSrt(const QString &path);
+
+    /**
+     * @brief 按关键帧规划片段
+     * @param keyframes 关键帧时间 (升序)
+     * @param durationSecs 视频时长
+     * @param cues 字幕
+     * @param minCopySecs 短于此时长的复制片段并入相邻的重新编码片段 (减少切分数)
+     */
+    static QList<Segment> plan(const QList<double> &keyframes, double durationSecs, const QList<Cue> &cues, double minCopySecs);
+
+signals:
+    /**
+     * @brief 渲染进度
+     * @param fraction 完成比例 (0~1)
+     */
+    void progress(double fraction);
+
+    void logMessage(const QString &message);
+
+    /**
+     * @brief 渲染结束
+     * @param success 是否成功
+     * @param reason 失败或放弃的原因
+     */
+    void finished(bool success, const QString &reason);
+
+private slots:
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onProcessError(QProcess::ProcessError error);
+
+private:
+    enum Step {
+        StepIdle,
+        StepProbe,
+        StepSplit,
+        StepEncode,
+        StepConcat,
+        StepVerify
+    };
+
+    void runStep(Step nextStep, const QString &program, const QStringList &arguments);
+    void onProbeDone(const QByteArray &output);
+    void startSplit();
+    void startNextEncode();
+    void startConcat();
+    void startVerify();
+    QStringList sourceMatchArgs() const;
+    void fail(const QString &reason);
+    void reset();
+    bool writeSegmentSubtitles(int index) const;
+    QString partName(int index) const;
+    QString encodedName(int index) const;
+
+    Step step = StepIdle;
+    QProcess *process = nullptr;
+    QTemporaryDir *workDir = nullptr;
+    QString inputPath;
+    QString subtitlePath;
+    QString outputPath;
+    QStringList encodeArgs;
+
+    QString videoCodec;
+    QString pixelFormat;
+    QString profile;     // 源视频的 H.264 profile (ffprobe 名称，如 "High")
+    int level = 0;       // 源视频的 level x 10 (如 40 表示 4.0)
+    int refs = 0;        // 源视频的参考帧数
+    int hasBFrames = -1; // 源视频的重排序深度 (0 表示没有 B 帧)
+    double durationSecs = 0;
+    QList<double> keyframes;
+    QList<Cue> cues;
+    QList<Segment> segments;
+    int encodeIndex = 0;
+    double reencodeSecs = 0;
+    double encodedSecs = 0;
+
+    static constexpr double kMaxReencodeRatio = 0.6; // 需要重新编码的比例超过此值时直接完整渲染
+    static constexpr double kMinCopySecs = 2.0;
+    static constexpr int kMaxSegments = 500;
+};
+
+#endif // SMARTRENDERER_H
@@ -0,0 +1,238 @@
+#include "TaskStore.h"
+#include <QColor>
+#include <QSet>
+#include <algorithm>
+
+TaskStore::TaskStore(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int TaskStore::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : tasks.size();
+}
+
+QVariant TaskStore::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= tasks.size()) return QVariant();
+    const TaskInfo &task = tasks[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole: {
+        QString text = task.priority > 0 ? "[优先] " + task.inputPath : task.inputPath;
+        if (task.status == "Processing") return text + " (处理中...)";
+        if (task.status == "Paused") return text + " (已暂停)";
+        return text;
+    }
+    case Qt::BackgroundRole:
+        if (task.status == "Processing") return QColor("#e6f7ff"); // 浅蓝色背景
+        if (task.status == "Paused") return QColor("#f0f0f0");
+        return QVariant();
+    case Qt::ToolTipRole:
+    case InputPathRole:
+        return task.inputPath;
+    case TaskIdRole:
+        return task.id;
+    default:
+        return QVariant();
+    }
+}
+
+/**
+ * @brief 批量追加任务
+ */
+QList<int> TaskStore::append(const QList<TaskInfo> &newTasks)
+{
+    QList<TaskInfo> accepted;
+    accepted.reserve(newTasks.size());
+    QList<int> ids;
+    for (TaskInfo task : newTasks) {
+        if (idByPath.contains(task.inputPath)) continue;
+        task.id = nextId++;
+        idByPath.insert(task.inputPath, task.id);
+        ids.append(task.id);
+        accepted.append(std::move(task));
+    }
+    if (accepted.isEmpty()) return ids;
+
+    int first = tasks.size();
+    beginInsertRows(QModelIndex(), first, first + accepted.size() - 1);
+    tasks.append(std::move(accepted));
+    for (int row = first; row < tasks.size(); ++row) {
+        if (!rowIndexDirty) positionById.insert(tasks[row].id, row + headOffset);
+        addToGroup(tasks[row]);
+    }
+    endInsertRows();
+    return ids;
+}
+
+void TaskStore::remove(int id)
+{
+    remove(QList<int>() << id);
+}
+
+/**
+ * @brief 移除任务，连续的行合并为一次删除通知
+ */
+void TaskStore::remove(const QList<int> &ids)
+{
+    QList<int> rows;
+    for (int id : ids) {
+        int row = rowOf(id);
+        if (row >= 0) rows.append(row);
+    }
+    if (rows.isEmpty()) return;
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    // 从后往前删除，前面的行号保持有效
+    int end = rows.size() - 1;
+    while (end >= 0) {
+        int start = end;
+        while (start > 0 && rows[start - 1] == rows[start] - 1) start--;
+        int firstRow = rows[start];
+        int lastRow = rows[end];
+
+        beginRemoveRows(QModelIndex(), firstRow, lastRow);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            idByPath.remove(tasks[row].inputPath);
+            positionById.remove(tasks[row].id);
+            removeFromGroup(tasks[row].id);
+        }
+        tasks.remove(firstRow, lastRow - firstRow + 1);
+        if (firstRow == 0 && lastRow == rows.last()) {
+            // 只移除了队首连续的行: 其余行整体前移
+            headOffset += lastRow + 1;
+        } else {
+            rowIndexDirty = true;
+        }
+        endRemoveRows();
+
+        end = start - 1;
+    }
+}
+
+/**
+ * @brief 移到队首，视图中的选中项等持久索引随之更新
+ */
+void TaskStore::moveToFront(const QList<int> &ids)
+{
+    QSet<int> moving(ids.begin(), ids.end());
+    emit layoutAboutToBeChanged();
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QList<int> oldIds;
+    for (const QModelIndex &idx : oldIndexes) {
+        oldIds << tasks[idx.row()].id;
+    }
+
+    std::stable_partition(tasks.begin(), tasks.end(), [&moving](const TaskInfo &task) {
+        return moving.contains(task.id);
+    });
+    rebuildRowIndex();
+
+    QModelIndexList newIndexes;
+    for (int id : oldIds) {
+        newIndexes << index(rowOf(id));
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged();
+}
+
+bool TaskStore::containsPath(const QString &path) const
+{
+    return idByPath.contains(path);
+}
+
+int TaskStore::idForPath(const QString &path) const
+{
+    return idByPath.value(path, -1);
+}
+
+TaskInfo *TaskStore::find(int id)
+{
+    int row = rowOf(id);
+    return row >= 0 ? &tasks[row] : nullptr;
+}
+
+const TaskInfo *TaskStore::find(int id) const
+{
+    int row = rowOf(id);
+    return row >= 0 ? &tasks[row] : nullptr;
+}
+
+int TaskStore::rowOf(int id) const
+{
+    if (rowIndexDirty) rebuildRowIndex();
+    auto it = positionById.constFind(id);
+    return it == positionById.constEnd() ? -1 : *it - headOffset;
+}
+
+void TaskStore::notifyChanged(int id)
+{
+    int row = rowOf(id);
+    if (row < 0) return;
+    removeFromGroup(id);
+    addToGroup(tasks[row]);
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx);
+}
+
+void TaskStore::setGroupKey(std::function<QString(const TaskInfo &)> keyOf)
+{
+    groupKeyOf = std::move(keyOf);
+    groups.clear();
+    groupOf.clear();
+    for (const TaskInfo &task : tasks) {
+        addToGroup(task);
+    }
+}
+
+void TaskStore::addToGroup(const TaskInfo &task)
+{
+    if (!groupKeyOf) return;
+    QString key = groupKeyOf(task);
+    if (key.isEmpty()) return;
+
+    GroupTotal &group = groups[key];
+    if (group.knownCount + group.unknownCount == 0) {
+        group.sample = task;
+        group.sample.id = -1;
+    }
+    if (task.durationSecs > 0) {
+        group.knownSecs += task.durationSecs;
+        group.knownCount++;
+    } else {
+        group.unknownCount++;
+    }
+    groupOf.insert(task.id, qMakePair(key, task.durationSecs));
+}
+
+void TaskStore::removeFromGroup(int id)
+{
+    auto it = groupOf.find(id);
+    if (it == groupOf.end()) return;
+    auto group = groups.find(it->first);
+    if (it->second > 0) {
+        group->knownSecs -= it->second;
+        group->knownCount--;
+        if (group->knownCount == 0) group->knownSecs = 0; // 不累积浮点误差
+    } else {
+        group->unknownCount--;
+    }
+    if (group->knownCount + group->unknownCount == 0) {
+        groups.erase(group);
+    }
+    groupOf.erase(it);
+}
+
+void TaskStore::rebuildRowIndex() const
+{
+    positionById.clear();
+    positionById.reserve(tasks.size());
+    for (int row = 0; row < tasks.size(); ++row) {
+        positionById.insert(tasks[row].id, row);
+    }
+    headOffset = 0;
+    rowIndexDirty = false;
+}
@@ -0,0 +1,159 @@
+#ifndef TASKSTORE_H
+#define TASKSTORE_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <functional>
+
+/**
+ * @brief 任务信息结构体
+ */
+struct TaskInfo {
+    int id = -1;          // 任务 ID (入队时由 TaskStore 分配，之后不变)
+    QString inputPath;
+    QString outputDir;
+    QString status; // "Pending", "Processing", "Paused", "Completed", "Failed"
+    QString outputVideoPath;
+    QString audioPath;    // 提取出的中间音频 (WAV)；仅转写任务为源文件本身，不可删除
+    QString subtitlePath; // 转录生成的字幕 (SRT)
+    QString transcriptPath; // 纯文本稿 (TXT，仅转写任务)
+    QString scratchDir;   // 中间文件所在的临时目录，空表示中间文件直接放在输出目录 (Extra)
+    double durationSecs = 0; // 媒体时长 (秒)，探测完成前为 0
+    bool transcriptOnly = false; // 仅转写: 直接从源文件解码，跳过音频提取和字幕合成，只输出 SRT/TXT
+    QString refineModel;  // 两级转写: 草稿用 tiny 模型，之后在后台用该模型精修 (空表示标准模式)
+    bool draftVideo = false; // 两级转写: 草稿阶段先输出软字幕视频 (只封装不重新编码)
+    QString engine;       // 转写引擎 (监视文件夹的配置)，空表示使用界面当前选项
+    QString model;        // Whisper 模型，空表示使用界面当前选项
+    int priority = 0;     // 优先级，数值大的先处理 (标记为优先处理的任务为 1)
+    bool held = false;    // 已暂停: 不参与调度，恢复后按原顺序处理
+    bool audioReady = false;    // 已提取音频 (被抢占后继续时跳过提取)
+    bool subtitleReady = false; // 已生成字幕 (被抢占后继续时跳过转写)
+    bool checkpointed = false;  // 转写被中断，检查点保留在字幕旁 (继续时从中断处开始)
+
+    /**
+     * @brief 被抢占后回到队列、留有中间产物的任务 (沿用原路径和临时目录，单独处理)
+     */
+    bool resumed() const { return audioReady || subtitleReady || checkpointed; }
+};
+
+/**
+ * @brief 待处理任务存储 (同时作为队列视图的数据模型)
+ *
+ * 按队列顺序保存任务，并维护 ID -> 行号、路径 -> ID 两个哈希索引:
+ * 入队去重和状态更新都不需要遍历列表或比较显示文本。
+ * 任务通常从队首完成，队首移除时行号索引只需整体偏移，其他位置移除时延迟重建。
+ */
+class TaskStore : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        TaskIdRole = Qt::UserRole + 1,
+        InputPathRole
+    };
+
+    /**
+     * @brief 同一分组任务的时长汇总
+     */
+    struct GroupTotal {
+        TaskInfo sample;      // 分组的代表任务 (只有决定分组键的字段有意义，id 为 -1)
+        double knownSecs = 0; // 时长已知任务的总时长
+        int knownCount = 0;
+        int unknownCount = 0; // 时长未知的任务数
+    };
+
+    explicit TaskStore(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief 批量追加任务 (一次插入通知)，分配 ID 并跳过重复路径
+     * @param newTasks 新任务
+     * @return 实际加入的任务 ID
+     */
+    QList<int> append(const QList<TaskInfo> &newTasks);
+
+    /**
+     * @brief 移除任务
+     * @param ids 任务 ID 列表 (不存在的 ID 被忽略)
+     */
+    void remove(const QList<int> &ids);
+    void remove(int id);
+
+    /**
+     * @brief 路径是否已在队列中
+     */
+    bool containsPath(const QString &path) const;
+
+    /**
+     * @brief 把任务移到队首 (保持它们之间以及其余任务的相对顺序)
+     */
+    void moveToFront(const QList<int> &ids);
+
+    /**
+     * @brief 按路径查找任务 ID，不存在时返回 -1
+     */
+    int idForPath(const QString &path) const;
+
+    /**
+     * @brief 按 ID 查找任务 (指针在下一次增删前有效)，修改显示相关字段后需调用 notifyChanged
+     */
+    TaskInfo *find(int id);
+    const TaskInfo *find(int id) const;
+
+    /**
+     * @brief 任务所在行，不存在时返回 -1
+     */
+    int rowOf(int id) const;
+
+    /**
+     * @brief 按行访问 (不可修改 inputPath，路径索引依赖它)
+     */
+    TaskInfo &at(int row) { return tasks[row]; }
+    const TaskInfo &at(int row) const { return tasks[row]; }
+    int count() const { return tasks.size(); }
+    bool isEmpty() const { return tasks.isEmpty(); }
+
+    /**
+     * @brief 队列顺序的全部任务
+     */
+    const QList<TaskInfo> &all() const { return tasks; }
+
+    /**
+     * @brief 通知视图该任务的显示内容已变化 (同时更新分组汇总)
+     */
+    void notifyChanged(int id);
+
+    /**
+     * @brief 设置分组键 (剩余时间等按分组汇总计算，不必遍历全部任务)
+     * 键只能依赖任务自身的字段，返回空字符串的任务不计入。修改相关字段后需调用 notifyChanged。
+     */
+    void setGroupKey(std::function<QString(const TaskInfo &)> keyOf);
+
+    /**
+     * @brief 按分组键汇总的任务时长，随增删和 notifyChanged 增量更新
+     */
+    const QHash<QString, GroupTotal> &groupTotals() const { return groups; }
+
+private:
+    void rebuildRowIndex() const;
+    void addToGroup(const TaskInfo &task);
+    void removeFromGroup(int id);
+
+    QList<TaskInfo> tasks;
+    QHash<QString, int> idByPath;
+    // 行号索引保存 "行号 + headOffset"，从队首移除时只需增大 headOffset
+    mutable QHash<int, int> positionById;
+    mutable int headOffset = 0;
+    mutable bool rowIndexDirty = false;
+    int nextId = 1;
+
+    std::function<QString(const TaskInfo &)> groupKeyOf;
+    QHash<QString, GroupTotal> groups;
+    QHash<int, QPair<QString, double>> groupOf; // 任务 ID -> (分组键, 计入的时长)
+};
+
+#endif // TASKSTORE_H
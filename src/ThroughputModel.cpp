@@ -0,0 +1,118 @@
+#include "ThroughputModel.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+/**
+ * @brief 构造函数
+ */
+ThroughputModel::ThroughputModel(const QString &path)
+    : path(path)
+{
+    load();
+}
+
+QString ThroughputModel::key(const QString &stage, const QString &engine, const QString &model)
+{
+    return stage + "|" + engine + "|" + model;
+}
+
+/**
+ * @brief 内置默认实时率 (CPU 上的保守估计)，采集到本机样本后即被替换
+ */
+double ThroughputModel::defaultFactor(const QString &stage, const QString &engine, const QString &model)
+{
+    if (stage == "extract") return 0.02;
+    if (stage == "embed") return engine == "softsub" ? 0.02 : 0.5; // 软字幕只封装，不重新编码
+    if (stage == "transcribe") {
+        if (engine == "vosk") return 0.3;
+        if (model == "tiny") return 0.1;
+        if (model == "base") return 0.15;
+        if (model == "small") return 0.3;
+        if (model == "medium") return 0.7;
+        if (model == "large") return 1.2;
+        return 0.3;
+    }
+    return 0.1;
+}
+
+double ThroughputModel::realtimeFactor(const QString &stage, const QString &engine, const QString &model) const
+{
+    auto it = stats.constFind(key(stage, engine, model));
+    if (it != stats.constEnd() && it->samples > 0) {
+        return it->realtimeFactor;
+    }
+    return defaultFactor(stage, engine, model);
+}
+
+double ThroughputModel::estimateSecs(const QString &stage, const QString &engine, const QString &model, double mediaSecs) const
+{
+    return realtimeFactor(stage, engine, model) * qMax(0.0, mediaSecs);
+}
+
+bool ThroughputModel::hasSamples(const QString &stage, const QString &engine, const QString &model) const
+{
+    auto it = stats.constFind(key(stage, engine, model));
+    return it != stats.constEnd() && it->samples > 0;
+}
+
+/**
+ * @brief 记录实测，第一个样本直接采用，之后按指数滑动平均平滑
+ */
+void ThroughputModel::record(const QString &stage, const QString &engine, const QString &model, double mediaSecs, double elapsedSecs)
+{
+    // 过短的媒体受固定开销影响太大，不计入
+    if (mediaSecs < 1.0 || elapsedSecs <= 0) return;
+
+    double factor = elapsedSecs / mediaSecs;
+    Stat &stat = stats[key(stage, engine, model)];
+    if (stat.samples == 0) {
+        stat.realtimeFactor = factor;
+    } else {
+        stat.realtimeFactor = kSmoothing * factor + (1.0 - kSmoothing) * stat.realtimeFactor;
+    }
+    stat.samples++;
+    save();
+}
+
+void ThroughputModel::load()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    QJsonObject items = root["stats"].toObject();
+    for (auto it = items.begin(); it != items.end(); ++it) {
+        QJsonObject obj = it.value().toObject();
+        Stat stat;
+        stat.realtimeFactor = obj["rtf"].toDouble();
+        stat.samples = obj["samples"].toInt();
+        if (stat.realtimeFactor > 0) {
+            stats.insert(it.key(), stat);
+        }
+    }
+}
+
+void ThroughputModel::save() const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QJsonObject items;
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        QJsonObject obj;
+        obj["rtf"] = it->realtimeFactor;
+        obj["samples"] = it->samples;
+        items[it.key()] = obj;
+    }
+    QJsonObject root;
+    root["version"] = 1;
+    root["stats"] = items;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(root).toJson());
+    file.commit();
+}
@@ -0,0 +1,65 @@
+#ifndef THROUGHPUTMODEL_H
+#define THROUGHPUTMODEL_H
+
+#include <QHash>
+#include <QString>
+
+/**
+ * @brief 吞吐量模型
+ *
+ * 按 阶段 + 引擎 + 模型 记录本机的实时率 (阶段耗时 / 媒体时长)，用指数滑动平均更新并持久化。
+ * 结合已知媒体时长即可估算各阶段耗时，用于进度权重和剩余时间预测。
+ */
+class ThroughputModel
+{
+public:
+    /**
+     * @brief 构造函数，加载已有统计
+     * @param path 持久化文件路径
+     */
+    explicit ThroughputModel(const QString &path);
+
+    /**
+     * @brief 获取实时率，没有本机样本时返回内置的保守默认值
+     * @param stage 阶段名 ("extract", "transcribe", "embed")
+     * @param engine 引擎 (与阶段无关时为空)
+     * @param model 模型 (与阶段无关时为空)
+     */
+    double realtimeFactor(const QString &stage, const QString &engine = QString(), const QString &model = QString()) const;
+
+    /**
+     * @brief 估算阶段耗时 (秒)
+     * @param mediaSecs 媒体时长 (秒)
+     */
+    double estimateSecs(const QString &stage, const QString &engine, const QString &model, double mediaSecs) const;
+
+    /**
+     * @brief 记录一次阶段实测并写入文件
+     * @param mediaSecs 处理的媒体时长 (秒)
+     * @param elapsedSecs 实际耗时 (秒)
+     */
+    void record(const QString &stage, const QString &engine, const QString &model, double mediaSecs, double elapsedSecs);
+
+    /**
+     * @brief 该组合是否已有本机样本
+     */
+    bool hasSamples(const QString &stage, const QString &engine = QString(), const QString &model = QString()) const;
+
+private:
+    struct Stat {
+        double realtimeFactor = 0;
+        int samples = 0;
+    };
+
+    static QString key(const QString &stage, const QString &engine, const QString &model);
+    static double defaultFactor(const QString &stage, const QString &engine, const QString &model);
+    void load();
+    void save() const;
+
+    QString path;
+    QHash<QString, Stat> stats;
+
+    static constexpr double kSmoothing = 0.3; // 新样本权重
+};
+
+#endif // THROUGHPUTMODEL_H
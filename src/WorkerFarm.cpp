@@ -0,0 +1,333 @@
+#include "WorkerFarm.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcessEnvironment>
+#include <QSaveFile>
+#include <QTimer>
+
+/**
+ * @brief 构造函数，只记录配置，调用 start() 后才启动进程
+ */
+WorkerFarm::WorkerFarm(const QString &program, const QStringList &arguments, int poolSize, QObject *parent)
+    : QObject(parent), program(program), arguments(arguments), poolSize(qMax(1, poolSize)),
+      shuttingDown(false), nextJobId(1), consecutiveSpawnFailures(0), totalSpawnLatencyMs(0), spawnCount(0)
+{
+}
+
+WorkerFarm::~WorkerFarm()
+{
+    shutdown();
+}
+
+/**
+ * @brief 异步预启动工作进程
+ */
+void WorkerFarm::start()
+{
+    shuttingDown = false;
+    for (int i = workers.size(); i < poolSize; ++i) {
+        spawnWorker();
+    }
+}
+
+void WorkerFarm::setPoolSize(int size)
+{
+    poolSize = qMax(1, size);
+    if (shuttingDown || !isAvailable()) return;
+    for (int i = workers.size(); i < poolSize; ++i) {
+        spawnWorker();
+    }
+    trimIdleWorkers();
+}
+
+int WorkerFarm::loadPoolSize(const QString &configPath)
+{
+    QFile file(configPath);
+    if (file.open(QIODevice::ReadOnly)) {
+        return qMax(1, QJsonDocument::fromJson(file.readAll()).object()["poolSize"].toInt(1));
+    }
+    QJsonObject config;
+    config["poolSize"] = 1; // 两级转写时至少为 2 (后台精修占用一个进程)
+    QDir().mkpath(QFileInfo(configPath).absolutePath());
+    QSaveFile out(configPath);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(QJsonDocument(config).toJson());
+        out.commit();
+    }
+    return 1;
+}
+
+/**
+ * @brief 终止所有工作进程
+ */
+void WorkerFarm::shutdown()
+{
+    shuttingDown = true;
+    pendingJobs.clear();
+    for (Worker *worker : workers) {
+        worker->process->disconnect(this);
+        if (worker->process->state() != QProcess::NotRunning) {
+            worker->process->kill(); // 只发送终止信号，进程对象随事件循环回收
+        }
+        worker->process->deleteLater();
+        delete worker;
+    }
+    workers.clear();
+}
+
+/**
+ * @brief 提交任务
+ */
+int WorkerFarm::submit(const QStringList &jobArgs)
+{
+    int jobId = nextJobId++;
+    pendingJobs.enqueue(qMakePair(jobId, jobArgs));
+    dispatch();
+    return jobId;
+}
+
+void WorkerFarm::cancel(int jobId)
+{
+    for (int i = 0; i < pendingJobs.size(); ++i) {
+        if (pendingJobs[i].first == jobId) {
+            pendingJobs.removeAt(i);
+            emit jobFinished(jobId, -1);
+            return;
+        }
+    }
+    // --serve 进程在段落边界检查取消请求，结束任务后输出 JOB_DONE，已加载的模型保留；
+    // 进程没有响应 (例如卡在模型加载中) 时终止，finished 信号中回收并补充新进程
+    for (Worker *worker : workers) {
+        if (worker->jobId == jobId) {
+            QJsonObject request;
+            request["cancel"] = jobId;
+            worker->process->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+            QProcess *process = worker->process;
+            QTimer::singleShot(kCancelGraceMs, process, [this, process, jobId]() {
+                Worker *current = findWorker(process);
+                if (current && current->jobId == jobId) {
+                    emit logMessage("工作进程未响应取消请求，终止进程");
+                    process->kill();
+                }
+            });
+            return;
+        }
+    }
+}
+
+qint64 WorkerFarm::processIdForJob(int jobId) const
+{
+    for (const Worker *worker : workers) {
+        if (worker->jobId == jobId && worker->process->state() == QProcess::Running) {
+            return worker->process->processId();
+        }
+    }
+    return 0;
+}
+
+bool WorkerFarm::isAvailable() const
+{
+    return consecutiveSpawnFailures < kMaxSpawnFailures;
+}
+
+double WorkerFarm::averageSpawnLatencyMs() const
+{
+    return spawnCount > 0 ? double(totalSpawnLatencyMs) / spawnCount : 0.0;
+}
+
+QList<qint64> WorkerFarm::processIds() const
+{
+    QList<qint64> pids;
+    for (const Worker *worker : workers) {
+        if (worker->process->state() == QProcess::Running) {
+            pids << worker->process->processId();
+        }
+    }
+    return pids;
+}
+
+/**
+ * @brief 启动一个工作进程 (不等待启动完成)
+ */
+void WorkerFarm::spawnWorker()
+{
+    Worker *worker = new Worker;
+    worker->process = new QProcess(this);
+    // 合并 stdout/stderr，Python 异常堆栈与进度输出按顺序转发
+    worker->process->setProcessChannelMode(QProcess::MergedChannels);
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("PYTHONUNBUFFERED", "1");
+    env.insert("PYTHONUTF8", "1");
+    worker->process->setProcessEnvironment(env);
+
+    connect(worker->process, &QProcess::readyReadStandardOutput, this, &WorkerFarm::onWorkerReadyRead);
+    connect(worker->process, &QProcess::finished, this, &WorkerFarm::onWorkerFinished);
+    // 启动失败可能在 start() 内同步发出，排队处理避免重入
+    connect(worker->process, &QProcess::errorOccurred, this, &WorkerFarm::onWorkerError, Qt::QueuedConnection);
+
+    workers.append(worker);
+    worker->spawnTimer.start();
+    worker->process->start(program, arguments);
+}
+
+/**
+ * @brief 按顺序把排队的任务分配给空闲且已就绪的进程，优先选择已缓存同一模型的进程
+ */
+void WorkerFarm::dispatch()
+{
+    while (!pendingJobs.isEmpty()) {
+        const QStringList &jobArgs = pendingJobs.head().second;
+        int modelIndex = jobArgs.indexOf("--model");
+        QString model = modelIndex >= 0 && modelIndex + 1 < jobArgs.size() ? jobArgs[modelIndex + 1] : QString();
+
+        Worker *target = nullptr;
+        for (Worker *worker : workers) {
+            if (!worker->ready || worker->jobId >= 0) continue;
+            if (!target || (worker->model == model && target->model != model)) {
+                target = worker;
+            }
+        }
+        if (!target) return;
+
+        QPair<int, QStringList> job = pendingJobs.dequeue();
+        QJsonObject request;
+        request["id"] = job.first;
+        request["args"] = QJsonArray::fromStringList(job.second);
+
+        target->jobId = job.first;
+        target->model = model;
+        target->process->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+    }
+}
+
+/**
+ * @brief 读取工作进程输出: 就绪标记、任务完成标记和普通输出
+ */
+void WorkerFarm::onWorkerReadyRead()
+{
+    Worker *worker = findWorker(sender());
+    if (!worker) return;
+
+    while (worker->process->canReadLine()) {
+        QString line = QString::fromUtf8(worker->process->readLine()).trimmed();
+        if (line.isEmpty()) continue;
+
+        if (!worker->ready) {
+            if (line == "WORKER_READY") {
+                worker->ready = true;
+                consecutiveSpawnFailures = 0;
+                qint64 latency = worker->spawnTimer.elapsed();
+                totalSpawnLatencyMs += latency;
+                spawnCount++;
+                emit workerReady(latency);
+                dispatch();
+            } else {
+                emit logMessage("Worker: " + line);
+            }
+            continue;
+        }
+
+        // JOB_DONE: <id> <exit_code>
+        if (line.startsWith("JOB_DONE:")) {
+            QStringList parts = line.mid(9).trimmed().split(' ', Qt::SkipEmptyParts);
+            int jobId = worker->jobId;
+            int exitCode = parts.size() >= 2 ? parts[1].toInt() : 1;
+            worker->jobId = -1;
+            emit jobFinished(jobId, exitCode);
+            dispatch();
+            trimIdleWorkers();
+            if (!workers.contains(worker)) return;
+            continue;
+        }
+
+        if (worker->jobId >= 0) {
+            emit jobOutput(worker->jobId, line);
+        }
+    }
+}
+
+/**
+ * @brief 工作进程退出 (崩溃或被杀)，补充一个新进程
+ */
+void WorkerFarm::onWorkerFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    Worker *worker = findWorker(sender());
+    if (!worker) return;
+
+    emit logMessage(QString("工作进程退出 (Exit Code: %1)").arg(exitCode));
+    retireWorker(worker, exitStatus == QProcess::NormalExit ? exitCode : -1);
+}
+
+/**
+ * @brief 工作进程启动失败 (其他错误会伴随 finished 信号，在那里处理)
+ */
+void WorkerFarm::onWorkerError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart) return;
+    Worker *worker = findWorker(sender());
+    if (!worker) return;
+
+    emit logMessage("错误: 无法启动工作进程 " + program);
+    retireWorker(worker, -1);
+}
+
+/**
+ * @brief 移除工作进程，未完成的任务以失败结束，并按需补充新进程
+ */
+void WorkerFarm::retireWorker(Worker *worker, int exitCode)
+{
+    workers.removeOne(worker);
+    worker->process->disconnect(this);
+    worker->process->deleteLater();
+
+    int jobId = worker->jobId;
+    if (!worker->ready) {
+        consecutiveSpawnFailures++;
+    }
+    delete worker;
+
+    if (jobId >= 0) {
+        emit jobFinished(jobId, exitCode == 0 ? 1 : exitCode);
+    }
+    if (shuttingDown) return;
+
+    if (!isAvailable()) {
+        emit logMessage("错误: 工作进程连续启动失败，停用常驻进程池");
+        while (!pendingJobs.isEmpty()) {
+            emit jobFinished(pendingJobs.dequeue().first, -1);
+        }
+        return;
+    }
+    if (workers.size() < poolSize) {
+        spawnWorker();
+    }
+}
+
+/**
+ * @brief 进程数量超过配置时退出多余的空闲进程
+ */
+void WorkerFarm::trimIdleWorkers()
+{
+    for (int i = workers.size() - 1; i >= 0 && workers.size() > poolSize; --i) {
+        Worker *worker = workers[i];
+        if (worker->jobId >= 0) continue;
+        workers.removeAt(i);
+        worker->process->disconnect(this);
+        worker->process->kill();
+        worker->process->deleteLater();
+        delete worker;
+    }
+}
+
+WorkerFarm::Worker *WorkerFarm::findWorker(QObject *process) const
+{
+    for (Worker *worker : workers) {
+        if (worker->process == process) return worker;
+    }
+    return nullptr;
+}
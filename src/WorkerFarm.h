@@ -0,0 +1,146 @@
+#ifndef WORKERFARM_H
+#define WORKERFARM_H
+
+#include <QObject>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QPair>
+#include <QStringList>
+
+/**
+ * @brief 常驻工作进程池
+ *
+ * 预先启动若干个 transcribe.py --serve 进程，导入库和加载模型的开销只付一次。
+ * 任务以 JSON 行的形式写入空闲进程的 stdin，全程异步，不在 UI 线程等待进程启动或退出。
+ * 空闲进程中优先选择上一个任务使用同一模型的进程 (每个进程只缓存一个模型)。
+ * 取消执行中的任务时先请求进程在段落边界结束该任务 (进程和模型保留)，超时未结束才终止进程。
+ */
+class WorkerFarm : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief 构造函数
+     * @param program 解释器 (如 python)
+     * @param arguments 启动参数 (脚本路径及 --serve)
+     * @param poolSize 常驻进程数量
+     * @param parent 父对象
+     */
+    WorkerFarm(const QString &program, const QStringList &arguments, int poolSize, QObject *parent = nullptr);
+    ~WorkerFarm();
+
+    /**
+     * @brief 异步预启动所有工作进程
+     */
+    void start();
+
+    /**
+     * @brief 调整常驻进程数量: 增加时立即启动，减少时退出多余的空闲进程 (执行中的进程在任务结束后退出)
+     */
+    void setPoolSize(int size);
+
+    /**
+     * @brief 读取进程数量配置，文件不存在时写入默认值 (1)
+     * @param configPath worker_farm.json 路径
+     */
+    static int loadPoolSize(const QString &configPath);
+
+    /**
+     * @brief 终止所有工作进程 (不等待)
+     */
+    void shutdown();
+
+    /**
+     * @brief 提交任务，没有空闲进程时排队
+     * @param jobArgs 与 transcribe.py 命令行相同的参数 (不含脚本路径)
+     * @return 任务 ID
+     */
+    int submit(const QStringList &jobArgs);
+
+    /**
+     * @brief 取消任务: 排队中的直接移除；执行中的通知工作进程结束该任务，kCancelGraceMs 内未结束则终止进程 (随后补充新进程)
+     * 两种情况都以非零退出码发出 jobFinished
+     */
+    void cancel(int jobId);
+
+    /**
+     * @brief 执行该任务的工作进程 PID，任务未在执行时返回 0
+     */
+    qint64 processIdForJob(int jobId) const;
+
+    /**
+     * @brief 工作进程池是否可用 (连续启动失败后不可用，调用方应回退为一次性进程)
+     */
+    bool isAvailable() const;
+
+    /**
+     * @brief 工作进程平均启动耗时 (从 start 到 WORKER_READY)
+     */
+    double averageSpawnLatencyMs() const;
+
+    /**
+     * @brief 正在运行的工作进程 PID (资源调度按实测内存计入)
+     */
+    QList<qint64> processIds() const;
+
+signals:
+    /**
+     * @brief 任务的一行输出 (stdout/stderr 合并)
+     */
+    void jobOutput(int jobId, const QString &line);
+
+    /**
+     * @brief 任务完成
+     * @param exitCode 0 表示成功，工作进程崩溃时为非零
+     */
+    void jobFinished(int jobId, int exitCode);
+
+    /**
+     * @brief 一个工作进程启动就绪
+     * @param latencyMs 启动耗时 (毫秒)
+     */
+    void workerReady(qint64 latencyMs);
+
+    /**
+     * @brief 日志信息
+     */
+    void logMessage(const QString &message);
+
+private slots:
+    void onWorkerReadyRead();
+    void onWorkerFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onWorkerError(QProcess::ProcessError error);
+
+private:
+    struct Worker {
+        QProcess *process = nullptr;
+        QElapsedTimer spawnTimer;
+        bool ready = false;
+        int jobId = -1; // 正在执行的任务，-1 表示空闲
+        QString model;  // 最近一个任务的 --model (进程中缓存的模型)
+    };
+
+    void spawnWorker();
+    void dispatch();
+    void retireWorker(Worker *worker, int exitCode);
+    void trimIdleWorkers();
+    Worker *findWorker(QObject *process) const;
+
+    QString program;
+    QStringList arguments;
+    int poolSize;
+    bool shuttingDown;
+    int nextJobId;
+    int consecutiveSpawnFailures;
+    qint64 totalSpawnLatencyMs;
+    int spawnCount;
+
+    QList<Worker*> workers;
+    QQueue<QPair<int, QStringList>> pendingJobs;
+
+    static constexpr int kMaxSpawnFailures = 3;
+    static constexpr int kCancelGraceMs = 5000; // 转写在段落边界检查取消，一个段落的解码通常在此时间内完成
+};
+
+#endif // WORKERFARM_H
@@ -9,6 +9,7 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    a.setApplicationName("VideoSubtitleGenerator"); // 决定本机数据目录位置
     MainWindow w;
     w.show();
     return a.exec();